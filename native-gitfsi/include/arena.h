@@ -0,0 +1,108 @@
+#ifndef _GIT_FSI_ARENA_
+#define _GIT_FSI_ARENA_
+
+#include "define.h"
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace gitter_kid {
+namespace fsi {
+
+class arena {
+private:
+    std::vector<void *> _blocks;
+    byte *_cursor;
+    size_t _remain;
+    size_t _block_size;
+    size_t _allocated;
+public:
+    arena(size_t block_size = 64 * 1024);
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+    ~arena();
+
+    void *allocate(size_t size, size_t align);
+    void release();
+    size_t allocated() const;
+
+    static arena *&current();
+};
+
+// installs an arena as current thread's arena while in scope
+class arena_scope {
+private:
+    arena *_previous;
+public:
+    arena_scope(arena &scoped);
+    arena_scope(const arena_scope &) = delete;
+    arena_scope &operator=(const arena_scope &) = delete;
+    ~arena_scope();
+};
+
+/**
+ * allocate from the arena given when the allocator was made, or from the
+ * heap (the default). Only object parsers bind arena::current(), anything
+ * built elsewhere under an arena_scope (pack indexes loaded by a refresh)
+ * stays on the heap. Memory taken from an arena is given back only when
+ * the arena is released, copies of containers always go to the heap so
+ * nothing copied outlives the arena by accident
+ */
+template <typename _T_Value>
+class arena_allocator {
+private:
+    arena *_arena;
+
+    template <typename _T_Other> friend class arena_allocator;
+public:
+    typedef _T_Value value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    arena_allocator()
+        : _arena(nullptr) {}
+
+    arena_allocator(arena *source)
+        : _arena(source) {}
+
+    template <typename _T_Other>
+    arena_allocator(const arena_allocator<_T_Other> &other)
+        : _arena(other._arena) {}
+
+    _T_Value *allocate(size_t n) {
+        if (this->_arena != nullptr) {
+            return static_cast<_T_Value *>(this->_arena->allocate(n * sizeof(_T_Value),
+                                                                 alignof(_T_Value)));
+        }
+        return static_cast<_T_Value *>(::operator new(n * sizeof(_T_Value)));
+    }
+
+    void deallocate(_T_Value *ptr, size_t) {
+        if (this->_arena == nullptr) {
+            ::operator delete(ptr);
+        }
+    }
+
+    arena_allocator select_on_container_copy_construction() const {
+        return arena_allocator(nullptr);
+    }
+
+    template <typename _T_Other>
+    bool operator== (const arena_allocator<_T_Other> &other) const {
+        return this->_arena == other._arena;
+    }
+
+    template <typename _T_Other>
+    bool operator!= (const arena_allocator<_T_Other> &other) const {
+        return this->_arena != other._arena;
+    }
+};
+
+typedef std::basic_string<byte, std::char_traits<byte>, arena_allocator<byte>> arena_bytes;
+
+}
+}
+
+#endif
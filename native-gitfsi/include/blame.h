@@ -0,0 +1,57 @@
+#ifndef _GIT_FSI_BLAME_
+#define _GIT_FSI_BLAME_
+
+#include "repository.h"
+#include "commit.h"
+#include "line_diff.h"
+#include "sign.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace gitter_kid {
+namespace fsi {
+
+class blame_entry {
+private:
+    sign_t _commit;
+    size_t _final_start;
+    size_t _orig_start;
+    size_t _count;
+    commit_metadata _author;
+public:
+    blame_entry(sign_t commit,
+                size_t final_start,
+                size_t orig_start,
+                size_t count,
+                commit_metadata author);
+
+    sign_t &commit();
+    size_t &final_start();
+    size_t &orig_start();
+    size_t &count();
+    commit_metadata &author();
+};
+
+class blame {
+private:
+    repository &_repo;
+    diff_algorithm _algorithm;
+    std::vector<blame_entry> _entries;
+    size_t _lines;
+public:
+    blame(repository &repo);
+
+    diff_algorithm &algorithm();
+
+    std::vector<blame_entry> &run(sign_t commit_sign,
+                                  const std::string &path,
+                                  std::function<void (blame_entry &)> callback = nullptr);
+    std::vector<blame_entry> &entries();
+    size_t lines() const;
+};
+
+}
+}
+
+#endif
@@ -8,12 +8,24 @@
 namespace gitter_kid {
 namespace fsi {
 
+enum blob_class {
+    blob_class_unknow,
+    blob_class_text,
+    blob_class_binary
+};
+
+// only this many leading bytes are sniffed (same as git's FIRST_FEW_BYTES)
+const size_t BLOB_SNIFF_LEN = 8000;
+
+blob_class classify_content(const byte *begin, const byte *end);
+
 class blob : public content {
 private:
     std::basic_string<byte> _body;
 public:
     virtual gitter_kid::fsi::obj_type type() const override;
     blob(std::basic_string<byte> &body);
+    blob(std::basic_string<byte> &&body);
     std::basic_string<byte> &body();
 };
 
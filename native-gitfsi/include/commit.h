@@ -3,6 +3,7 @@
 
 #include "content.h"
 #include "sign.h"
+#include "arena.h"
 #include <cstdint>
 
 namespace gitter_kid {
@@ -29,9 +30,11 @@ public:
     std::string &timezone();
 };
     
+typedef std::vector<sign_t, arena_allocator<sign_t>> commit_parents;
+
 class commit_body {
 private:
-    std::vector<sign_t> _parents;
+    commit_parents _parents;
     std::string _tree_sign;
     std::string _message;
     gitter_kid::fsi::commit_metadata _author;
@@ -39,7 +42,7 @@ private:
 public:
     commit_body();
 
-    std::vector<sign_t> &parents();
+    commit_parents &parents();
     std::string &tree_sign();
     std::string &message();
     commit_metadata &author();
@@ -49,11 +52,10 @@ public:
 
 class commit : public content {
 private:
-    gitter_kid::fsi::commit_body &_body;
+    gitter_kid::fsi::commit_body _body;
 
 public:
-    commit(gitter_kid::fsi::commit_body &body,
-           std::basic_string<byte>::iterator spliter,
+    commit(std::basic_string<byte>::iterator spliter,
            std::basic_string<byte>::iterator end);
     virtual obj_type type() const override;
     commit_body &body();
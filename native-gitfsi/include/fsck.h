@@ -0,0 +1,90 @@
+#ifndef _GIT_FSI_FSCK_
+#define _GIT_FSI_FSCK_
+
+#include "repository.h"
+#include "sign.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace gitter_kid {
+namespace fsi {
+
+// loose objects checked per job, and pack objects a worker checks between
+// two progress reports
+const size_t FSCK_CHUNK_LEN = 2048;
+
+enum fsck_issue_kind {
+    // pack or idx checksum mismatch, idx not matching its pack
+    fsck_issue_checksum,
+    // object unreadable or its content doesn't hash to its id
+    fsck_issue_corrupt,
+    // tree, commit or tag that doesn't parse as one
+    fsck_issue_malformed,
+    // object referenced by a ref or another object isn't in the repository
+    fsck_issue_missing
+};
+
+struct fsck_issue {
+    fsck_issue_kind kind;
+    // object concerned, empty for pack checksums
+    sign_t sign;
+    std::string detail;
+};
+
+struct fsck_progress {
+    const char *stage;
+    size_t done;
+    size_t total;
+    // compressed bytes read so far
+    uint64_t bytes;
+    double seconds;
+};
+
+struct fsck_report {
+    size_t packs;
+    size_t objects;
+    size_t loose;
+    size_t reachable;
+    size_t unreachable;
+    uint64_t bytes;
+    double seconds;
+    // false for SHA-256 repositories, only structure and connectivity are
+    // checked there
+    bool hashes_checked;
+    std::vector<fsck_issue> issues;
+};
+
+/**
+ * integrity check of a repository: pack and idx checksums, every object's
+ * id, trees', commits' and tags' structure and connectivity from refs.
+ * Pack objects are read with pack::for_each, so every base is inflated once
+ */
+class fsck {
+private:
+    repository &_repo;
+    unsigned _threads;
+    bool _connectivity;
+    std::function<void(const fsck_progress &)> _progress;
+public:
+    fsck(repository &repo);
+
+    /**
+     * threads count (0 for hardware concurrency)
+     */
+    unsigned &threads();
+    bool &connectivity();
+    /**
+     * invoked after each job, one call at a time
+     */
+    std::function<void(const fsck_progress &)> &progress();
+
+    fsck_report check();
+};
+
+}
+}
+
+#endif
@@ -8,7 +8,11 @@
 namespace gitter_kid {
 namespace fsi {
 
+std::basic_string<byte> __inflate(const byte *deflate_bytes,
+                                  size_t deflate_bytes_len,
+                                  size_t inflate_bytes_len);
 std::basic_string<byte> __inflate(std::basic_string<byte> &, size_t inflate_buf_len);
+std::basic_string<byte> __inflate_prefix(std::basic_string<byte> &, size_t limit);
 
 }
 }
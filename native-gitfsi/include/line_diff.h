@@ -0,0 +1,124 @@
+#ifndef _GIT_FSI_LINE_DIFF_
+#define _GIT_FSI_LINE_DIFF_
+
+#include "define.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace gitter_kid {
+namespace fsi {
+
+enum diff_algorithm {
+    diff_algorithm_myers,
+    diff_algorithm_histogram
+};
+
+enum diff_line_type {
+    diff_line_context,
+    diff_line_deleted,
+    diff_line_added
+};
+
+struct line_span_s {
+    size_t off;
+    size_t len; // including '\n'
+};
+
+// old [old_begin, old_end) replaced by new [new_begin, new_end), line numbers are 0-based
+struct diff_range_s {
+    size_t old_begin;
+    size_t old_end;
+    size_t new_begin;
+    size_t new_end;
+};
+
+std::vector<line_span_s> split_lines(const std::basic_string<byte> &content);
+
+std::vector<diff_range_s> diff_sequences(const std::vector<uint32_t> &a,
+                                         const std::vector<uint32_t> &b,
+                                         diff_algorithm algorithm);
+
+class line_interner {
+private:
+    struct __line_s {
+        const byte *ptr;
+        size_t len;
+    };
+
+    std::vector<__line_s> _lines;
+    std::unordered_multimap<uint64_t, uint32_t> _ids;
+public:
+    uint32_t intern(const byte *ptr, size_t len);
+    std::vector<uint32_t> intern(const std::basic_string<byte> &content,
+                                 const std::vector<line_span_s> &lines);
+    size_t size() const;
+};
+
+class diff_line {
+private:
+    diff_line_type _type;
+    size_t _old_no;
+    size_t _new_no;
+    const byte *_begin;
+    size_t _len;
+public:
+    diff_line(diff_line_type type,
+              size_t old_no,
+              size_t new_no,
+              const byte *begin,
+              size_t len);
+
+    diff_line_type &type();
+    size_t &old_no();
+    size_t &new_no();
+    std::string content() const;
+    bool eol() const;
+};
+
+class diff_hunk {
+private:
+    size_t _old_start;
+    size_t _old_count;
+    size_t _new_start;
+    size_t _new_count;
+    std::vector<diff_line> _lines;
+public:
+    diff_hunk();
+
+    size_t &old_start();
+    size_t &old_count();
+    size_t &new_start();
+    size_t &new_count();
+    std::vector<diff_line> &lines();
+    std::string header() const;
+};
+
+class line_diff {
+private:
+    diff_algorithm _algorithm;
+    size_t _context;
+    bool _old_binary;
+    bool _new_binary;
+    bool _binary;
+    std::vector<diff_hunk> _hunks;
+public:
+    line_diff();
+
+    diff_algorithm &algorithm();
+    size_t &context();
+    bool &old_binary();
+    bool &new_binary();
+
+    std::vector<diff_hunk> &diff(const std::basic_string<byte> &old_content,
+                                 const std::basic_string<byte> &new_content);
+    bool binary() const;
+    std::vector<diff_hunk> &hunks();
+    std::string unified();
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _GIT_FSI_METRICS_
+#define _GIT_FSI_METRICS_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+enum metric_counter {
+    metric_counter_lookups_loose,
+    metric_counter_lookups_packed,
+    metric_counter_lookups_missing,
+    metric_counter_inflated_bytes,
+    metric_counter_delta_bases_hits,
+    metric_counter_delta_bases_misses,
+    metric_counter_loose_dirs_hits,
+    metric_counter_loose_dirs_misses,
+    metric_counter_blob_classes_hits,
+    metric_counter_blob_classes_misses,
+    metric_counter_pool_hits,
+    metric_counter_pool_misses,
+    metric_counter_pack_opens,
+    metric_counter_verify_failures,
+    metric_counter_count
+};
+
+enum metric_histogram {
+    metric_histogram_get_ns,
+    metric_histogram_inflate_ns,
+    metric_histogram_index_load_ns,
+    metric_histogram_delta_depth,
+    metric_histogram_count
+};
+
+// histogram bucket i counts values in [2^(i-1), 2^i), bucket 0 counts 0
+const size_t METRICS_BUCKETS = 65;
+
+struct metrics_histogram {
+    uint64_t buckets[METRICS_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+};
+
+struct metrics_snapshot {
+    uint64_t counters[metric_counter_count];
+    metrics_histogram histograms[metric_histogram_count];
+};
+
+/**
+ * process-wide counters and histograms. Every thread updates its own
+ * block (no shared cache line, no lock), a snapshot sums all blocks and
+ * the ones of exited threads
+ */
+class metrics {
+public:
+    static void add(metric_counter counter, uint64_t value);
+    static void observe(metric_histogram histogram, uint64_t value);
+    static uint64_t now();
+
+    static metrics_snapshot snapshot();
+    static std::string prometheus();
+};
+
+}
+}
+
+// instrumentation sites compile to nothing unless built with GITFSI_METRICS
+#ifdef GITFSI_METRICS
+#define GITFSI_METRICS_ADD(counter, value) \
+    ::gitter_kid::fsi::metrics::add(::gitter_kid::fsi::counter, (value))
+#define GITFSI_METRICS_OBSERVE(histogram, value) \
+    ::gitter_kid::fsi::metrics::observe(::gitter_kid::fsi::histogram, (value))
+#define GITFSI_METRICS_START(name) \
+    uint64_t name = ::gitter_kid::fsi::metrics::now()
+#define GITFSI_METRICS_ELAPSED(histogram, name) \
+    ::gitter_kid::fsi::metrics::observe(::gitter_kid::fsi::histogram, \
+                                        ::gitter_kid::fsi::metrics::now() - (name))
+#else
+#define GITFSI_METRICS_ADD(counter, value) ((void)0)
+#define GITFSI_METRICS_OBSERVE(histogram, value) ((void)0)
+#define GITFSI_METRICS_START(name) ((void)0)
+#define GITFSI_METRICS_ELAPSED(histogram, name) ((void)0)
+#endif
+
+#endif
@@ -3,6 +3,11 @@
 
 #include "define.h"
 #include "content.h"
+#include "blob.h"
+#include "tree.h"
+#include "commit.h"
+#include "tag.h"
+#include <cassert>
 #include <string>
 #include <vector>
 
@@ -11,21 +16,55 @@ namespace fsi {
 
 class object {
 private:
-    void*_body_buffer; //lazy
-    content *_body;
     obj_type _type;
+    // body is stored in place, the active member is given by _type
+    union {
+        blob _blob;
+        tree _tree;
+        commit _commit;
+        tag _tag;
+    };
+
     obj_type analysis_type(std::basic_string<byte>& store,
                   std::basic_string<byte>::iterator& spliter);
+    void __construct(std::basic_string<byte> &&buffer, size_t off, obj_type type, size_t sign_len);
+    void __move(object &other);
+    void __destroy();
 public:
     object();
-    object(std::basic_string<byte> &buffer);
-    object(std::basic_string<byte> &buffer, obj_type type);
-    virtual ~object();
+    object(std::basic_string<byte> &buffer, size_t sign_len = SIGN_SHA1_LEN);
+    object(std::basic_string<byte> &&buffer, size_t sign_len = SIGN_SHA1_LEN);
+    object(std::basic_string<byte> &buffer, obj_type type, size_t sign_len = SIGN_SHA1_LEN);
+    object(std::basic_string<byte> &&buffer, obj_type type, size_t sign_len = SIGN_SHA1_LEN);
+    object(object &&other);
+    object(const object &) = delete;
+    ~object();
+
+    object &operator=(object &&other);
+    object &operator=(const object &) = delete;
 
     obj_type type() const;
-    template<class T> T &get() { return *dynamic_cast<T *>(this->_body); }
+    template<class T> T &get();
 };
 
+// only the member of the object's type is alive, check before get
+template<> inline blob &object::get<blob>() {
+    assert(this->_type == obj_type::obj_type_blob);
+    return this->_blob;
+}
+template<> inline tree &object::get<tree>() {
+    assert(this->_type == obj_type::obj_type_tree);
+    return this->_tree;
+}
+template<> inline commit &object::get<commit>() {
+    assert(this->_type == obj_type::obj_type_commit);
+    return this->_commit;
+}
+template<> inline tag &object::get<tag>() {
+    assert(this->_type == obj_type::obj_type_tag);
+    return this->_tag;
+}
+
 }
 }
 
@@ -9,6 +9,8 @@
 #include <map>
 #include <fstream>
 #include <vector>
+#include <memory>
+#include <functional>
 
 namespace gitter_kid {
 namespace fsi {
@@ -36,10 +38,43 @@ struct __pack_item_s {
     size_t origin_len;
 };
 
+// one item of a whole-pack scan, read from its header only
+struct __pack_node_s {
+    // pack type: 1-4 for commit, tree, blob, tag, 6/7 for ofs/ref deltas
+    uint8_t type;
+    // inflated size, for deltas the delta's own size unless scanned with
+    // delta_sizes (then the undeltified object's)
+    size_t size;
+    // base's position in offset order, PACK_NODE_ROOT if the item isn't a
+    // delta or its base isn't in this pack
+    size_t base;
+};
+
+const size_t PACK_NODE_ROOT = size_t(-1);
+
+// pack::for_each's type filter, bit (1 << obj_type_x) selects obj_type_x
+const unsigned PACK_TYPES_ALL = ~0u;
+
+class pack;
+
+// repository's packs, packs are shared so a retired one lives until its
+// last reader is done
+typedef std::vector<std::shared_ptr<pack>> pack_list;
+
+// state shared by one batch read: resolved delta bases
+struct __pack_batch_s {
+    std::map<std::pair<const pack *, size_t>, __pack_item_s> bases;
+    size_t bases_len;
+};
+
 class pack {
 private:
     std::string _pack_path;
     std::string _idx_path;
+    // opened by idx_init, kept so a pack removed from disk stays readable
+    int _pack_fd;
+    // id width, SIGN_SHA1_LEN or SIGN_SHA256_LEN
+    size_t _sign_len;
 
     std::vector<__pack_idx_s> _indexes;
     std::map<sign_t, __pack_idx_s> _sign_indexes;
@@ -50,29 +85,68 @@ private:
                      size_t pack_size);
     void __build_rdtree_indexes();
     size_t __pack_size() const;
-    std::basic_string<byte> __delta_patch(std::basic_string<byte> &base,
-                                          __pack_item_s delta);
+    std::basic_string<byte> __delta_patch(const std::basic_string<byte> &base,
+                                          const __pack_item_s &delta);
     size_t __indexes_findlen(pack &_pack, size_t off);
-    __pack_item_s __refdelta_patch(std::vector<pack> &pack_collection,
-                                   const __pack_item_s &packitem);
-    __pack_item_s __ofsdelta_patch(std::vector<pack> &pack_collection,
+    __pack_item_s __refdelta_patch(const pack_list &pack_collection,
+                                   const __pack_item_s &packitem,
+                                   __pack_batch_s *batch = nullptr,
+                                   size_t depth = 0);
+    __pack_item_s __ofsdelta_patch(const pack_list &pack_collection,
                                    pack &_pack,
-                                   const __pack_item_s &packitem);
-    __pack_segment_s __get_segment(std::ifstream &pack_file, size_t off, size_t len);
+                                   const __pack_item_s &packitem,
+                                   __pack_batch_s *batch = nullptr,
+                                   size_t depth = 0);
+    __pack_item_s __delta_base(const pack_list &pack_collection,
+                               pack &_pack,
+                               size_t off,
+                               size_t len,
+                               __pack_batch_s *batch,
+                               size_t depth);
+    __pack_segment_s __get_segment(size_t off, size_t len);
     __pack_item_s __get_item(__pack_segment_s &seg);
-    object __get(std::vector<pack> &repo, const __pack_idx_s &index);
+    __pack_item_s __resolve(const pack_list &pack_collection,
+                            __pack_item_s packitem,
+                            __pack_batch_s *batch = nullptr);
+    void __readahead(std::vector<__pack_idx_s> &indexes);
+    object __get(const pack_list &pack_collection, const __pack_idx_s &index, bool verify);
 public:
-    pack(std::string pack_path, std::string sign);
+    pack(std::string pack_path, std::string sign, size_t sign_len = SIGN_SHA1_LEN);
+    pack(const pack &) = delete;
+    pack &operator=(const pack &) = delete;
+    ~pack();
 
-    void idx_init();
+    bool idx_init();
 
     std::string &pack_path();
     std::string &idx_path();
+    size_t sign_len() const;
 
     std::map<sign_t, __pack_idx_s> &sign_index();
     std::vector<__pack_idx_s> &off_index();
+    size_t memory_usage() const;
 
-    object get(std::vector<pack> &pack_collection, sign_t sign);
+    object get(const pack_list &pack_collection, sign_t sign, bool verify = false);
+    void scan(std::vector<__pack_node_s> &nodes, bool delta_sizes = false);
+    void for_each(const pack_list &pack_collection,
+                  std::function<void(unsigned, sign_t &, object &)> callback,
+                  unsigned threads = 0,
+                  bool verify = false,
+                  unsigned types = PACK_TYPES_ALL);
+    void get_many(const pack_list &pack_collection,
+                  std::vector<__pack_idx_s> &indexes,
+                  __pack_batch_s &batch,
+                  std::function<void(sign_t &, object &)> callback,
+                  bool verify = false);
+    std::basic_string<byte> raw(const pack_list &pack_collection,
+                                sign_t sign,
+                                obj_type &type,
+                                bool verify = false);
+    std::basic_string<byte> prefix(const pack_list &pack_collection,
+                                   sign_t sign,
+                                   size_t limit,
+                                   obj_type &type);
+    size_t header(const pack_list &pack_collection, sign_t sign, obj_type &type);
 };
 
 }
@@ -0,0 +1,176 @@
+#ifndef _GIT_FSI_PARALLEL_
+#define _GIT_FSI_PARALLEL_
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <cstddef>
+
+namespace gitter_kid {
+namespace fsi {
+
+/**
+ * threads count to use, 0 stands for hardware concurrency
+ */
+inline unsigned __parallel_threads(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return threads == 0 ? 1 : threads;
+}
+
+/**
+ * run fn(i) for i in [0, n) on up to `threads` threads
+ * Args:
+ *      size_t n: jobs count
+ *      unsigned threads: threads count (0 for hardware concurrency)
+ *      _T_Fn fn: job, invoked as fn(size_t)
+ */
+template <typename _T_Fn>
+void __parallel_for(size_t n, unsigned threads, _T_Fn fn) {
+    threads = __parallel_threads(threads);
+    if (threads > n) {
+        threads = unsigned(n);
+    }
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&] () -> void {
+        for (size_t i = next++; i < n; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for (auto itr = workers.begin(); itr != workers.end(); itr++) {
+        itr->join();
+    }
+}
+
+/**
+ * work-stealing pool for tasks that spawn tasks. A worker pushes and pops
+ * at the back of its own deque (depth-first), an idle worker steals from
+ * the front of another's (the oldest, usually largest, subtree) and sleeps
+ * if there's nothing to steal
+ */
+template <typename _T_Task>
+class __steal_pool {
+private:
+    struct __queue_s {
+        std::mutex mutex;
+        std::deque<_T_Task> tasks;
+    };
+    std::vector<__queue_s> _queues;
+    // pushed and not yet finished, workers leave once it drops to 0
+    std::atomic<size_t> _pending;
+    // idle workers sleep until a push (counted in _pushes) or the end
+    std::mutex _idle_mutex;
+    std::condition_variable _idle;
+    std::atomic<size_t> _pushes;
+
+    bool __pop(unsigned worker, _T_Task &task) {
+        for (unsigned i = 0; i < this->_queues.size(); i++) {
+            __queue_s &queue = this->_queues[(worker + i) % this->_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+public:
+    /**
+     * Args:
+     *      unsigned threads: workers count (0 for hardware concurrency)
+     */
+    __steal_pool(unsigned threads)
+        : _queues(__parallel_threads(threads))
+        , _pending(0)
+        , _pushes(0) {}
+    __steal_pool(const __steal_pool &) = delete;
+    __steal_pool &operator=(const __steal_pool &) = delete;
+
+    unsigned size() const {
+        return unsigned(this->_queues.size());
+    }
+
+    /**
+     * queue a task on a worker's deque, before run() or from a running task
+     */
+    void push(unsigned worker, _T_Task &&task) {
+        this->_pending++;
+        {
+            std::lock_guard<std::mutex> lock(this->_queues[worker].mutex);
+            this->_queues[worker].tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->_idle_mutex);
+            this->_pushes++;
+        }
+        this->_idle.notify_one();
+    }
+
+    /**
+     * run tasks until none is left
+     * Args:
+     *      _T_Fn fn: invoked as fn(unsigned worker, _T_Task &task)
+     */
+    template <typename _T_Fn>
+    void run(_T_Fn fn) {
+        auto worker = [&] (unsigned id) -> void {
+            while (this->_pending > 0) {
+                // taken before looking, a push after it isn't slept through
+                size_t pushes = this->_pushes;
+                _T_Task task;
+                if (!this->__pop(id, task)) {
+                    // e.g. while another worker walks one long delta chain
+                    std::unique_lock<std::mutex> lock(this->_idle_mutex);
+                    this->_idle.wait(lock, [&] () -> bool {
+                        return this->_pushes != pushes || this->_pending == 0;
+                    });
+                    continue;
+                }
+                fn(id, task);
+                if (--this->_pending == 0) {
+                    std::lock_guard<std::mutex> lock(this->_idle_mutex);
+                    this->_idle.notify_all();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < this->_queues.size(); i++) {
+            workers.push_back(std::thread(worker, i));
+        }
+        worker(0);
+        for (auto itr = workers.begin(); itr != workers.end(); itr++) {
+            itr->join();
+        }
+    }
+};
+
+}
+}
+
+#endif
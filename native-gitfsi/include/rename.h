@@ -0,0 +1,58 @@
+#ifndef _GIT_FSI_RENAME_
+#define _GIT_FSI_RENAME_
+
+#include "repository.h"
+#include "tree_diff.h"
+#include "define.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace gitter_kid {
+namespace fsi {
+
+class similarity_fingerprint {
+private:
+    // (chunk hash, bytes) sorted by chunk hash
+    std::vector<std::pair<uint32_t, uint32_t>> _chunks;
+    size_t _size;
+public:
+    similarity_fingerprint();
+    similarity_fingerprint(const std::basic_string<byte> &content);
+
+    size_t size() const;
+    int score(const similarity_fingerprint &other) const;
+};
+
+class rename_detector {
+private:
+    repository &_repo;
+    size_t _rename_limit;
+    int _min_score;
+    bool _find_copies;
+    unsigned _threads;
+
+    void __exact(std::vector<tree_diff_item> &items,
+                 std::vector<size_t> &sources,
+                 std::vector<size_t> &destinations,
+                 std::vector<bool> &consumed);
+    void __inexact(std::vector<tree_diff_item> &items,
+                   std::vector<size_t> &sources,
+                   std::vector<size_t> &destinations,
+                   std::vector<bool> &consumed);
+public:
+    rename_detector(repository &repo);
+
+    size_t &rename_limit();
+    int &min_score();
+    bool &find_copies();
+    unsigned &threads();
+
+    void detect(std::vector<tree_diff_item> &items);
+};
+
+}
+}
+
+#endif
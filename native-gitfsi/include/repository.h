@@ -4,23 +4,129 @@
 #include "pack.h"
 #include "object.h"
 #include "sign.h"
+#include "blob.h"
+#include "tree.h"
+#include "arena.h"
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <utility>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <ctime>
 
 namespace gitter_kid {
 namespace fsi {
 
+// abbreviated ids shorter than this aren't resolved
+const size_t ABBREV_MIN_LEN = 4;
+// abbreviations are never shorter than this by default
+const size_t ABBREV_DEFAULT_LEN = 7;
+
+enum abbrev_status {
+    abbrev_status_found,
+    abbrev_status_missing,
+    abbrev_status_ambiguous,
+    abbrev_status_invalid
+};
+
+// loose objects' ids in one objects/xx directory, never changed once shared
+struct __loose_names_s {
+    timespec mtime;
+    std::set<arena_bytes> signs;
+};
+
+// one objects/xx directory: readers take a snapshot (std::atomic_load),
+// rereading it swaps in a new one under its own mutex
+struct __loose_dir_s {
+    std::shared_ptr<const __loose_names_s> names;
+    std::mutex mutex;
+};
+
 class repository {
 private:
     const std::string _path;
-    std::vector<pack> _packs;
+    // readers take a snapshot (std::atomic_load), refreshing swaps in a
+    // new list under _packs_mutex
+    std::shared_ptr<const pack_list> _packs;
+    std::mutex _packs_mutex;
+    timespec _packs_mtime;
+
+    std::thread _watcher;
+    int _watcher_stop;
+
+    // indexed by id's first byte, filled by one readdir on first use
+    std::vector<__loose_dir_s> _loose_dirs;
+
+    // packed-refs' content, reread when the file's mtime changes
+    std::map<std::string, sign_t> _packed_refs;
+    timespec _packed_refs_mtime;
+    std::mutex _packed_refs_mutex;
+
+    std::map<sign_t, blob_class> _blob_classes;
+    std::mutex _blob_classes_mutex;
+
+    // hash what's read and compare with the id (set before sharing)
+    bool _verify;
+    // id width, from the config's extensions.objectFormat
+    const size_t _sign_len;
+
+    std::basic_string<byte> __looseobj_content(std::string &looseobj_path);
+    std::shared_ptr<const __loose_names_s> __load_loose_dir(byte dir_byte, const std::string &dir_path);
+    std::basic_string<byte> __loose_content(sign_t &sign, bool revalidate);
+    std::shared_ptr<pack> __locate(sign_t &sign,
+                                   std::shared_ptr<const pack_list> &packs,
+                                   std::basic_string<byte> &loose_content);
+    std::shared_ptr<const __loose_names_s> __loose_dir(byte dir_byte, bool revalidate);
+    void __abbrev_matches(const std::string &hex_prefix, std::vector<sign_t> &matches);
+    std::string __abbrev(sign_t &sign, const pack_list &packs, size_t min_len);
+    void __load_packed_refs();
+    bool __packed_ref(const std::string &name, sign_t &sign);
+    std::vector<std::string> __scan_packs();
+    bool __packs_changed();
+    std::shared_ptr<pack> __find_pack(sign_t &sign, std::shared_ptr<const pack_list> &packs);
+    void __watch(int inotify_fd, int stop_fd);
+    bool __verifying() const;
 public:
     repository(std::string path);
+    repository(const repository &) = delete;
+    repository &operator=(const repository &) = delete;
+    ~repository();
+
     const std::string &path();
     std::string looseobj_path(sign_t sign);
     void initialize_packs();
+    void refresh_packs();
+    bool revalidate_packs();
+    bool watch_packs();
+    std::shared_ptr<const pack_list> packs();
+    size_t pack_count();
+    size_t memory_usage();
+    bool &verify();
+    size_t sign_len() const;
+
+    std::vector<sign_t> loose_objects();
 
     object get(sign_t sign);
+    object get(sign_t sign, arena &request_arena);
+    void get_many(const std::vector<sign_t> &signs,
+                  std::function<void(sign_t &, object &)> callback);
+    std::basic_string<byte> raw(sign_t sign, obj_type &type);
+    size_t header(sign_t sign, obj_type &type);
+    abbrev_status resolve_abbrev(const std::string &hex_prefix, sign_t &sign);
+    std::string abbrev(sign_t sign, size_t min_len = ABBREV_DEFAULT_LEN);
+    std::vector<std::string> abbrev_many(const std::vector<sign_t> &signs,
+                                         size_t min_len = ABBREV_DEFAULT_LEN);
+    sign_t lookup(sign_t tree_sign, const std::string &path, obj_type &type);
+    sign_t resolve_ref(const std::string &name);
+    std::map<std::string, sign_t> refs();
+
+    blob_class classify(sign_t sign);
+    std::vector<std::pair<tree_item, blob_class>> classify_tree(sign_t tree_sign,
+                                                                unsigned threads = 0);
 };
 
 }
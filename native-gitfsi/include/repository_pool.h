@@ -0,0 +1,61 @@
+#ifndef _GIT_FSI_REPOSITORY_POOL_
+#define _GIT_FSI_REPOSITORY_POOL_
+
+#include "repository.h"
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+struct __pool_entry_s {
+    std::shared_ptr<repository> repo;
+    std::list<std::string>::iterator lru;
+    size_t memory;
+    size_t packs;
+};
+
+/**
+ * process-wide cache of opened repositories keyed by path. The least
+ * recently used ones are dropped when the pool exceeds its repositories,
+ * memory or packs (each pack may hold a file open while read) budget;
+ * handles given out stay valid after eviction
+ */
+class repository_pool {
+private:
+    std::map<std::string, __pool_entry_s> _entries;
+    std::list<std::string> _lru;
+    std::mutex _mutex;
+
+    size_t _max_repositories;
+    size_t _max_memory;
+    size_t _max_packs;
+    size_t _memory;
+    size_t _packs;
+
+    void __account(__pool_entry_s &entry);
+    void __evict(const std::string &keep);
+public:
+    repository_pool(size_t max_repositories = 256,
+                    size_t max_memory = 1024 * 1024 * 1024,
+                    size_t max_packs = 1024);
+
+    size_t &max_repositories();
+    size_t &max_memory();
+    size_t &max_packs();
+
+    std::shared_ptr<repository> get(const std::string &path);
+    void remove(const std::string &path);
+    size_t size();
+    size_t memory();
+
+    static repository_pool &global();
+};
+
+}
+}
+
+#endif
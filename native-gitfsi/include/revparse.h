@@ -0,0 +1,46 @@
+#ifndef _GIT_FSI_REVPARSE_
+#define _GIT_FSI_REVPARSE_
+
+#include "repository.h"
+#include "object.h"
+#include "sign.h"
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+/**
+ * resolves a subset of git's revision syntax:
+ *      <id>, <abbreviated id>      4 to 40 (64 for SHA-256) hex digits
+ *      <ref>                       main, v1.0, origin/main, refs/..., HEAD
+ *      <rev>~<n>, <rev>^<n>        n-th first parent ancestor, n-th parent
+ *      <rev>^{commit|tree|tag|blob}, <rev>^{}    peel tags (and commits)
+ *      <rev>:<path>                entry at path in rev's tree
+ * refs are looked up in git's order: <ref>, refs/<ref>, refs/tags/<ref>,
+ * refs/heads/<ref>, refs/remotes/<ref>, refs/remotes/<ref>/HEAD, then as
+ * an abbreviated id. Objects are only read when the expression needs them
+ */
+class revparse {
+private:
+    repository &_repo;
+
+    sign_t _sign;
+    obj_type _type;
+    object _obj;
+    bool _loaded;
+
+    bool __base(const std::string &name);
+    bool __load(obj_type expected = obj_type::obj_type_unknow);
+    void __set(sign_t sign, obj_type type);
+    bool __peel(obj_type target);
+    bool __parent(size_t nth);
+public:
+    revparse(repository &repo);
+
+    sign_t resolve(const std::string &rev, obj_type &type);
+};
+
+}
+}
+
+#endif
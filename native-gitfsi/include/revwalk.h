@@ -0,0 +1,45 @@
+#ifndef _GIT_FSI_REVWALK_
+#define _GIT_FSI_REVWALK_
+
+#include "repository.h"
+#include "commit.h"
+#include "sign.h"
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gitter_kid {
+namespace fsi {
+
+class revwalk {
+private:
+    repository &_repo;
+    std::vector<std::string> _path;
+
+    std::priority_queue<std::pair<uint64_t, sign_t>> _queue;
+    std::set<sign_t> _seen;
+    std::map<sign_t, commit_body> _pending;
+    // (depth, tree sign) -> sign of path's component in that tree
+    std::map<std::pair<size_t, sign_t>, sign_t> _components;
+
+    bool __load(sign_t &sign, commit_body &body);
+    void __enqueue(sign_t &sign, commit_body &body);
+    sign_t __component(size_t depth, sign_t &tree_sign);
+    bool __treesame(commit_body &a, commit_body &b);
+    bool __path_exists(commit_body &body);
+public:
+    revwalk(repository &repo);
+
+    void path(const std::string &path);
+    void push(sign_t sign);
+    bool next(sign_t &sign, commit_body &body);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _GIT_FSI_SERVER_
+#define _GIT_FSI_SERVER_
+
+#include "repository.h"
+#include "define.h"
+#include <string>
+#include <map>
+#include <memory>
+
+namespace gitter_kid {
+namespace fsi {
+
+// requests longer than this close the connection
+const size_t SERVER_REQUEST_MAX = 64 * 1024;
+
+/**
+ * answers batch requests against warm repositories. Every request and
+ * response is a frame: 4 bytes big-endian payload length, then payload.
+ *
+ * request payload: "[@<repo> ]<command> <argument>"
+ *      info <rev>              "ok <id> <type> <size>\n"
+ *      contents <rev>          "ok <id> <type> <size>\n" + content
+ *      tree <rev>              "ok <id> tree <count>\n" + "<type> <id>\t<name>\n" per item
+ *      resolve <rev>           "ok <id> <type>\n"
+ * <rev> is a full id or a revision expression (see revparse). Failures
+ * answer "missing <argument>\n" or "error <reason>\n". Requests may be
+ * pipelined, responses come back in request order
+ */
+class server {
+private:
+    std::map<std::string, std::unique_ptr<repository>> _repositories;
+    std::string _default_repository;
+
+    repository *__repository(const std::string &name);
+    std::string __info(repository &repo, const std::string &argument, bool with_content);
+    std::string __tree(repository &repo, const std::string &argument);
+    std::string __resolve(repository &repo, const std::string &argument);
+public:
+    void add(const std::string &name, const std::string &path);
+
+    std::string handle(const std::string &request);
+    void serve(int in_fd, int out_fd);
+    int listen(const std::string &socket_path);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _GIT_FSI_SHA1_
+#define _GIT_FSI_SHA1_
+
+#include "define.h"
+#include "content.h"
+#include "sign.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+const size_t SHA1_LEN = 20;
+
+/**
+ * streaming SHA-1. Blocks are compressed with the x86 SHA extensions when
+ * the CPU has them, portable code otherwise. Built with GITFSI_SHA1DC,
+ * hashing goes through sha1dc, which detects collision attacks
+ */
+class sha1 {
+private:
+    uint32_t _state[5];
+    uint64_t _len;
+    byte _block[64];
+    size_t _block_len;
+    // sha1dc's context (GITFSI_SHA1DC builds), nullptr otherwise
+    void *_dc;
+public:
+    sha1();
+    sha1(const sha1 &) = delete;
+    sha1 &operator=(const sha1 &) = delete;
+    ~sha1();
+
+    void update(const byte *data, size_t len);
+    void update(const std::string &data);
+    /**
+     * finish hashing, the hasher can't be updated afterwards
+     * Args:
+     *      byte *digest: SHA1_LEN bytes (output)
+     * Returns:
+     *      false if a collision attack was detected
+     */
+    bool final(byte *digest);
+    bool final(sign_t &sign);
+
+    /**
+     * whether blocks are compressed with the SHA extensions
+     */
+    static bool accelerated();
+};
+
+// block compressors, __sha1_impl_auto picks one from the CPU
+enum __sha1_impl {
+    __sha1_impl_auto,
+    __sha1_impl_portable,
+    __sha1_impl_shani
+};
+
+/**
+ * force a block compressor, for tests checking each one (not thread-safe
+ * against hashing in progress)
+ * Args:
+ *      __sha1_impl impl: compressor, __sha1_impl_auto undoes forcing
+ * Returns:
+ *      false if it isn't available on this CPU or build, nothing changes
+ */
+bool __sha1_force(__sha1_impl impl);
+
+/**
+ * id of a git object: SHA-1 over "<type> <size>\0<content>"
+ * Args:
+ *      obj_type type: object's type
+ *      const byte *content: object's content
+ *      size_t len: content's length
+ *      sign_t &sign: object's id (output)
+ * Returns:
+ *      false if type isn't an object type or a collision attack was detected
+ */
+bool hash_object(obj_type type, const byte *content, size_t len, sign_t &sign);
+
+}
+}
+
+#endif
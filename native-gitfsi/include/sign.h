@@ -2,12 +2,16 @@
 #define _GIT_FSI_SIGN_
 
 #include "content.h"
+#include "arena.h"
 #include <string>
-#include <sstream>
 
 namespace gitter_kid {
 namespace fsi {
 
+// id widths in bytes, SHA-256 repositories set extensions.objectFormat
+const size_t SIGN_SHA1_LEN = 20;
+const size_t SIGN_SHA256_LEN = 32;
+
 template <char _T_Base_Chr,
          char _T_Base_Starter,
          char _T_Left_Mover,
@@ -37,34 +41,36 @@ template <typename _T_Base_Ptr> byte __to_byte(_T_Base_Ptr &base) {
 
 class sign_t {
 private:
+    // hex string is formatted on first str(), so parsing an id costs no
+    // formatting (first str() call on a shared sign isn't thread-safe)
     std::string _sign_str;
-    std::basic_string<byte> _sign_bytes;
+    arena_bytes _sign_bytes;
 public:
     sign_t();
     sign_t(std::string sign);
     sign_t(char *sign);
+    explicit sign_t(arena *bytes_arena);
     template<typename _T_Iter> void str_assign(_T_Iter begin, _T_Iter end) {
         this->_sign_str.assign(begin, end);
+        this->_sign_bytes.clear();
+        // a trailing odd nibble is dropped
         auto itr = begin;
-        while (itr != end) {
+        while (end - itr >= 2) {
             this->_sign_bytes.push_back(__to_byte(itr));
             itr += 2;
         }
     }
     template<typename _T_Iter> void bytes_assign(_T_Iter begin, _T_Iter end) {
         this->_sign_bytes.assign(begin, end);
-        this->_sign_str.resize(40);
-
-        std::stringstream sign_stream;
-        sign_stream.rdbuf()->pubsetbuf(const_cast<char *>(this->_sign_str.data()), 40);
-        for (auto itr = begin; itr != end; itr++) {
-            sign_stream << std::hex << uint16_t((*itr & 0xF0) >> 4) << uint16_t((*itr & 0x0F));
-        }
+        this->_sign_str.clear();
     }
     std::string &str();
-    std::basic_string<byte> &bytes();
+    arena_bytes &bytes();
+    const arena_bytes &bytes() const;
 
     bool operator< (const sign_t &other_sign) const;
+    bool operator== (const sign_t &other_sign) const;
+    bool operator!= (const sign_t &other_sign) const;
 };
 
 }
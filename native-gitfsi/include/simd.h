@@ -0,0 +1,139 @@
+#ifndef _GIT_FSI_SIMD_
+#define _GIT_FSI_SIMD_
+
+#include "define.h"
+#include <cstring>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace gitter_kid {
+namespace fsi {
+
+/**
+ * find first byte equals to target
+ * Args:
+ *      const byte *begin: scan begin
+ *      const byte *end: scan end
+ *      byte target: byte to find
+ * Returns:
+ *      pointer to found byte, end if not found
+ */
+inline const byte *__find_byte(const byte *begin, const byte *end, byte target) {
+    const void *result = std::memchr(begin, target, end - begin);
+    return result == nullptr ? end : reinterpret_cast<const byte *>(result);
+}
+
+/**
+ * call fn(off) for every offset (relative to begin) of byte equals to target,
+ * in increasing order. 32 (AVX2) or 16 (SSE2) bytes are compared at once
+ * and every hit in the block is visited through the compare mask
+ * Args:
+ *      const byte *begin: scan begin
+ *      const byte *end: scan end
+ *      byte target: byte to find
+ *      _T_Fn fn: visitor, invoked as fn(size_t)
+ */
+template <typename _T_Fn>
+void __for_each_byte(const byte *begin, const byte *end, byte target, _T_Fn fn) {
+    const byte *itr = begin;
+
+#if defined(__AVX2__)
+    const __m256i needle = _mm256_set1_epi8(char(target));
+    for (; end - itr >= 32; itr += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(itr));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        while (mask) {
+            fn(size_t(itr - begin) + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(char(target));
+    for (; end - itr >= 16; itr += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(itr));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        while (mask) {
+            fn(size_t(itr - begin) + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; itr != end; itr++) {
+        if (*itr == target) {
+            fn(size_t(itr - begin));
+        }
+    }
+}
+
+/**
+ * is byte non-printable, BS/HT/LF/FF/CR/ESC are printable (same as git's
+ * gather_stats)
+ */
+inline bool __is_control_byte(byte b) {
+    return (b < 0x20 && b != '\b' && b != '\t' && b != '\n' && b != '\f' && b != '\r' && b != 0x1B)
+        || b == 0x7F;
+}
+
+/**
+ * count non-printable bytes, 16 bytes are classified at once
+ * Args:
+ *      const byte *begin: scan begin
+ *      const byte *end: scan end
+ *      bool &has_nul: set if a NUL byte is found (scan stops at once)
+ * Returns:
+ *      non-printable bytes count
+ */
+inline size_t __count_control_bytes(const byte *begin, const byte *end, bool &has_nul) {
+    const byte *itr = begin;
+    size_t count = 0;
+    has_nul = false;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i printable[] = {
+        _mm_set1_epi8('\b'),
+        _mm_set1_epi8('\t'),
+        _mm_set1_epi8('\n'),
+        _mm_set1_epi8('\f'),
+        _mm_set1_epi8('\r'),
+        _mm_set1_epi8(0x1B)
+    };
+    for (; end - itr >= 16; itr += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(itr));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero))) {
+            has_nul = true;
+            return count;
+        }
+
+        // unsigned block <= 0x1F
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(block, control_max), block);
+        for (size_t i = 0; i < sizeof(printable) / sizeof(printable[0]); i++) {
+            control = _mm_andnot_si128(_mm_cmpeq_epi8(block, printable[i]), control);
+        }
+        control = _mm_or_si128(control, _mm_cmpeq_epi8(block, del));
+        count += __builtin_popcount(unsigned(_mm_movemask_epi8(control)));
+    }
+#endif
+
+    for (; itr != end; itr++) {
+        if (*itr == 0) {
+            has_nul = true;
+            return count;
+        }
+        if (__is_control_byte(*itr)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+}
+}
+
+#endif
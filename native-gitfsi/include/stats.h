@@ -0,0 +1,77 @@
+#ifndef _GIT_FSI_STATS_
+#define _GIT_FSI_STATS_
+
+#include "repository.h"
+#include "sign.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gitter_kid {
+namespace fsi {
+
+// largest blobs and trees kept in a report
+const size_t STATS_LARGEST_LEN = 10;
+
+struct stats_type {
+    size_t count;
+    // undeltified sizes
+    uint64_t size;
+    // bytes taken in packs (compressed, maybe deltified) or loose files
+    uint64_t disk_size;
+};
+
+struct stats_object {
+    sign_t sign;
+    uint64_t size;
+};
+
+struct stats_report {
+    stats_type commits;
+    stats_type trees;
+    stats_type blobs;
+    stats_type tags;
+    // largest first
+    std::vector<stats_object> largest_blobs;
+    std::vector<stats_object> largest_trees;
+    // objects by delta chain length, [0] counts undeltified objects
+    std::vector<size_t> delta_depths;
+    // size is the entries count
+    stats_object widest_tree;
+    // directories and file of the deepest path, e.g. 3 for a/b/c.txt, and
+    // its directories ("a/b")
+    size_t max_path_depth;
+    std::string deepest_path;
+    // commits on the longest parent chain, and the chain's tip
+    size_t history_length;
+    sign_t history_tip;
+    double seconds;
+};
+
+/**
+ * repository shape report. Counts, sizes and delta chains come from pack
+ * headers (deltas' first bytes give their size), blobs are never inflated;
+ * trees and commits are read with pack::for_each for the path depth,
+ * widest tree and history length. An object in several packs is counted
+ * once per copy
+ */
+class stats {
+private:
+    repository &_repo;
+    unsigned _threads;
+public:
+    stats(repository &repo);
+
+    /**
+     * threads count (0 for hardware concurrency)
+     */
+    unsigned &threads();
+
+    stats_report collect();
+};
+
+}
+}
+
+#endif
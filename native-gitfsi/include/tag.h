@@ -18,6 +18,8 @@ private:
     commit_metadata _tagger;
     std::string _message;
 public:
+    tag_body();
+
     std::string &obj_sign();
     obj_type &type();
     std::string &name();
@@ -27,11 +29,10 @@ public:
 
 class tag : public content {
 private:
-    gitter_kid::fsi::tag_body &_body;
+    gitter_kid::fsi::tag_body _body;
 public:
     virtual obj_type type() const override;
-    tag(gitter_kid::fsi::tag_body &body,
-        std::basic_string<byte>::iterator spliter,
+    tag(std::basic_string<byte>::iterator spliter,
         std::basic_string<byte>::iterator end);
     tag_body &get();
 };
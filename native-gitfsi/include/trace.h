@@ -0,0 +1,88 @@
+#ifndef _GIT_FSI_TRACE_
+#define _GIT_FSI_TRACE_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+// spans kept per thread, older ones are overwritten
+const size_t TRACE_RING_LEN = 8192;
+
+struct trace_event {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t tid;
+    // depth 0 is the outermost span (e.g. repository::get)
+    uint32_t depth;
+    // JSON object members, e.g. "off":12,"pack":"..."
+    std::string args;
+};
+
+/**
+ * opt-in span tracing. The outermost span on a thread starts a trace;
+ * spans nested in it are buffered and kept (moved to the thread's ring)
+ * only if the trace is sampled and took at least the slow threshold.
+ * Spans of unsampled traces don't read the clock
+ */
+class trace {
+public:
+    /**
+     * start tracing
+     * Args:
+     *      size_t sample_every: trace one outermost span out of sample_every
+     *      uint64_t slow_ns: keep traces that took at least slow_ns
+     */
+    static void enable(size_t sample_every = 1, uint64_t slow_ns = 0);
+    static void disable();
+    static bool enabled();
+
+    static void clear();
+    /**
+     * kept spans in Chrome's trace event format (chrome://tracing, Perfetto)
+     */
+    static std::string chrome_json();
+};
+
+/**
+ * RAII span, recorded when it goes out of scope
+ */
+class trace_span {
+private:
+    const char *_name;
+    uint64_t _start;
+    // counted in the thread's nesting depth
+    bool _entered;
+    bool _active;
+    std::string _args;
+public:
+    trace_span(const char *name);
+    ~trace_span();
+    trace_span(const trace_span &) = delete;
+    trace_span &operator=(const trace_span &) = delete;
+
+    /**
+     * whether the span belongs to a sampled trace (args are worth building)
+     */
+    bool active() const;
+    void arg(const char *key, const std::string &value);
+    void arg(const char *key, uint64_t value);
+};
+
+}
+}
+
+// spans compile to nothing unless built with GITFSI_TRACE
+#ifdef GITFSI_TRACE
+#define GITFSI_TRACE_SPAN(span, name) ::gitter_kid::fsi::trace_span span(name)
+#define GITFSI_TRACE_ARG(span, key, value) \
+    do { if ((span).active()) { (span).arg((key), (value)); } } while (0)
+#else
+#define GITFSI_TRACE_SPAN(span, name) ((void)0)
+#define GITFSI_TRACE_ARG(span, key, value) ((void)0)
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include "define.h"
 #include "content.h"
 #include "sign.h"
+#include "arena.h"
 #include <vector>
 #include <string>
 
@@ -16,21 +17,26 @@ private:
     std::string _name;
     gitter_kid::fsi::obj_type _type;
 public:
-    tree_item(sign_t sign, std::string name, obj_type type);
+    tree_item(sign_t &&sign, std::string &&name, obj_type type);
     sign_t &sign();
     std::string &name();
     obj_type &type();
 };
 
+typedef std::vector<tree_item, arena_allocator<tree_item>> tree_items;
+
 class tree : public content {
 private:
-    std::vector<tree_item> &_items;
+    tree_items _items;
+
+    template<size_t _T_Sign_Len> void __parse(std::basic_string<byte>::iterator spliter,
+                                              std::basic_string<byte>::iterator end);
 public:
     virtual obj_type type() const override;
-    tree(std::vector<tree_item> &items,
-         std::basic_string<byte>::iterator spliter,
-         std::basic_string<byte>::iterator end);
-    std::vector<tree_item> &items();
+    tree(std::basic_string<byte>::iterator spliter,
+         std::basic_string<byte>::iterator end,
+         size_t sign_len = SIGN_SHA1_LEN);
+    tree_items &items();
 };
 
 }
@@ -0,0 +1,61 @@
+#ifndef _GIT_FSI_TREE_DIFF_
+#define _GIT_FSI_TREE_DIFF_
+
+#include "repository.h"
+#include "tree.h"
+#include "sign.h"
+#include <string>
+#include <vector>
+
+namespace gitter_kid {
+namespace fsi {
+
+enum diff_status {
+    diff_status_added,
+    diff_status_deleted,
+    diff_status_modified,
+    diff_status_renamed,
+    diff_status_copied
+};
+
+class tree_diff_item {
+private:
+    diff_status _status;
+    std::string _old_path;
+    std::string _new_path;
+    sign_t _old_sign;
+    sign_t _new_sign;
+    int _similarity;
+public:
+    tree_diff_item(diff_status status,
+                   std::string old_path,
+                   std::string new_path,
+                   sign_t old_sign,
+                   sign_t new_sign);
+
+    diff_status &status();
+    std::string &old_path();
+    std::string &new_path();
+    sign_t &old_sign();
+    sign_t &new_sign();
+    int &similarity();
+};
+
+class tree_diff {
+private:
+    repository &_repo;
+    std::vector<tree_diff_item> _items;
+
+    tree_items __tree_items(sign_t &sign);
+    void __expand(sign_t &sign, const std::string &path, diff_status status);
+    void __diff(sign_t &old_tree, sign_t &new_tree, const std::string &prefix);
+public:
+    tree_diff(repository &repo, sign_t old_tree, sign_t new_tree);
+
+    std::vector<tree_diff_item> &items();
+};
+
+}
+}
+
+#endif
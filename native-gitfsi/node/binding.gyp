@@ -0,0 +1,21 @@
+{
+    "targets": [
+        {
+            "target_name": "gitfsi",
+            "sources": [
+                "gitfsi.cc",
+                "<!@(ls -1 ../src/*.cc)"
+            ],
+            "include_dirs": [
+                "../include"
+            ],
+            "libraries": [
+                "-lz",
+                "-lpthread"
+            ],
+            "cflags_cc!": [
+                "-fno-exceptions"
+            ]
+        }
+    ]
+}
@@ -0,0 +1,544 @@
+#define NAPI_VERSION 6
+#include <node_api.h>
+#include "repository.h"
+#include "revwalk.h"
+#include "object.h"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+namespace gitter_kid {
+namespace fsi {
+
+/**
+ * a job run on libuv's thread pool: execute must not touch JS values,
+ * complete builds the result back on the main thread
+ */
+struct __napi_job_s {
+    napi_async_work work;
+    napi_deferred deferred;
+    napi_ref self;
+    std::function<void()> execute;
+    std::function<napi_value(napi_env)> complete;
+    std::string error;
+};
+
+struct __napi_addon_s {
+    napi_ref repository_constructor;
+};
+
+inline napi_value __inl_string(napi_env env, const std::string &str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.data(), str.size(), &result);
+    return result;
+}
+
+inline void __inl_set(napi_env env, napi_value obj, const char *name, napi_value value) {
+    napi_set_named_property(env, obj, name, value);
+}
+
+inline const char *__inl_type_name(obj_type type) {
+    switch (type) {
+    case obj_type::obj_type_blob:
+        return "blob";
+    case obj_type::obj_type_tree:
+        return "tree";
+    case obj_type::obj_type_commit:
+        return "commit";
+    case obj_type::obj_type_tag:
+        return "tag";
+    default:
+        return "unknow";
+    }
+}
+
+/**
+ * read a string argument
+ * Args:
+ *      napi_env env: environment
+ *      napi_value value: argument
+ *      std::string &result: argument's content (output)
+ * Returns:
+ *      false if it isn't a string
+ */
+bool __napi_string_arg(napi_env env, napi_value value, std::string &result) {
+    size_t len;
+    if (napi_get_value_string_utf8(env, value, nullptr, 0, &len) != napi_ok) {
+        return false;
+    }
+    result.resize(len + 1);
+    napi_get_value_string_utf8(env, value, &result[0], result.size(), &len);
+    result.resize(len);
+    return true;
+}
+
+/**
+ * read an object id argument (40 or 64 lowercase hex)
+ */
+bool __napi_sign_arg(napi_env env, napi_value value, sign_t &sign) {
+    std::string hex;
+    if (!__napi_string_arg(env, value, hex) || (hex.size() != 2 * SIGN_SHA1_LEN && hex.size() != 2 * SIGN_SHA256_LEN)) {
+        return false;
+    }
+    for (auto itr = hex.begin(); itr != hex.end(); itr++) {
+        if (!(('0' <= *itr && *itr <= '9') || ('a' <= *itr && *itr <= 'f'))) {
+            return false;
+        }
+    }
+    sign.str_assign(hex.begin(), hex.end());
+    return true;
+}
+
+void __napi_job_execute(napi_env, void *data) {
+    __napi_job_s *job = static_cast<__napi_job_s *>(data);
+    try {
+        job->execute();
+    }
+    catch (const std::exception &e) {
+        job->error = e.what();
+    }
+}
+
+void __napi_job_complete(napi_env env, napi_status status, void *data) {
+    __napi_job_s *job = static_cast<__napi_job_s *>(data);
+
+    if (status == napi_ok && job->error.empty()) {
+        napi_resolve_deferred(env, job->deferred, job->complete(env));
+    }
+    else {
+        napi_value message = __inl_string(env, job->error.empty() ? "cancelled" : job->error);
+        napi_value error;
+        napi_create_error(env, nullptr, message, &error);
+        napi_reject_deferred(env, job->deferred, error);
+    }
+
+    if (job->self != nullptr) {
+        napi_delete_reference(env, job->self);
+    }
+    napi_delete_async_work(env, job->work);
+    delete job;
+}
+
+/**
+ * queue a job on the thread pool
+ * Args:
+ *      napi_env env: environment
+ *      napi_value self: JS object kept alive until the job completes (may be nullptr)
+ *      std::function<void()> execute: work off the main thread
+ *      std::function<napi_value(napi_env)> complete: result's builder
+ * Returns:
+ *      promise of complete's result
+ */
+napi_value __napi_queue(napi_env env,
+                        napi_value self,
+                        std::function<void()> execute,
+                        std::function<napi_value(napi_env)> complete) {
+    __napi_job_s *job = new __napi_job_s();
+    job->self = nullptr;
+    job->execute = std::move(execute);
+    job->complete = std::move(complete);
+
+    napi_value promise;
+    napi_create_promise(env, &job->deferred, &promise);
+    if (self != nullptr) {
+        napi_create_reference(env, self, 1, &job->self);
+    }
+
+    napi_create_async_work(env,
+                           nullptr,
+                           __inl_string(env, "gitfsi"),
+                           __napi_job_execute,
+                           __napi_job_complete,
+                           job,
+                           &job->work);
+    napi_queue_async_work(env, job->work);
+    return promise;
+}
+
+/**
+ * get `this` and its repository, throws TypeError on bad arguments
+ * Returns:
+ *      false if a JS exception is pending
+ */
+bool __napi_this(napi_env env,
+                 napi_callback_info info,
+                 size_t argc_min,
+                 std::vector<napi_value> &args,
+                 napi_value &self,
+                 repository *&repo) {
+    size_t argc = args.size();
+    napi_get_cb_info(env, info, &argc, args.data(), &self, nullptr);
+    if (argc < argc_min) {
+        napi_throw_type_error(env, nullptr, "missing argument");
+        return false;
+    }
+    if (napi_unwrap(env, self, reinterpret_cast<void **>(&repo)) != napi_ok) {
+        napi_throw_type_error(env, nullptr, "not a Repository");
+        return false;
+    }
+    return true;
+}
+
+napi_value __napi_metadata(napi_env env, commit_metadata &metadata) {
+    napi_value result;
+    napi_value timestamp;
+    napi_create_object(env, &result);
+    napi_create_double(env, double(metadata.timestamp()), &timestamp);
+
+    __inl_set(env, result, "name", __inl_string(env, metadata.name()));
+    __inl_set(env, result, "mail", __inl_string(env, metadata.mail()));
+    __inl_set(env, result, "timestamp", timestamp);
+    __inl_set(env, result, "timezone", __inl_string(env, metadata.timezone()));
+    return result;
+}
+
+napi_value __napi_commit(napi_env env, sign_t &sign, commit_body &body) {
+    napi_value result;
+    napi_value parents;
+    napi_create_object(env, &result);
+    napi_create_array_with_length(env, body.parents().size(), &parents);
+    for (size_t i = 0; i < body.parents().size(); i++) {
+        napi_set_element(env, parents, i, __inl_string(env, body.parents()[i].str()));
+    }
+
+    __inl_set(env, result, "id", __inl_string(env, sign.str()));
+    __inl_set(env, result, "tree", __inl_string(env, body.tree_sign()));
+    __inl_set(env, result, "parents", parents);
+    __inl_set(env, result, "author", __napi_metadata(env, body.author()));
+    __inl_set(env, result, "committer", __napi_metadata(env, body.committer()));
+    __inl_set(env, result, "message", __inl_string(env, body.message()));
+    return result;
+}
+
+napi_value __napi_tree(napi_env env, tree_items &items) {
+    napi_value result;
+    napi_create_array_with_length(env, items.size(), &result);
+    for (size_t i = 0; i < items.size(); i++) {
+        napi_value item;
+        napi_create_object(env, &item);
+        __inl_set(env, item, "name", __inl_string(env, items[i].name()));
+        __inl_set(env, item, "id", __inl_string(env, items[i].sign().str()));
+        __inl_set(env, item, "type", __inl_string(env, __inl_type_name(items[i].type())));
+        napi_set_element(env, result, i, item);
+    }
+    return result;
+}
+
+/**
+ * hand blob's content to JS without copying, the buffer is freed when the
+ * ArrayBuffer is collected
+ */
+napi_value __napi_blob(napi_env env, std::basic_string<byte> &&body) {
+    std::basic_string<byte> *owned = new std::basic_string<byte>(std::move(body));
+    napi_value result;
+    napi_status status = napi_create_external_arraybuffer(
+        env,
+        const_cast<byte *>(owned->data()),
+        owned->size(),
+        [] (napi_env, void *, void *hint) -> void {
+            delete static_cast<std::basic_string<byte> *>(hint);
+        },
+        owned,
+        &result);
+    if (status == napi_ok) {
+        return result;
+    }
+
+    // runtimes without external buffers get a copy
+    void *data;
+    napi_create_arraybuffer(env, owned->size(), &data, &result);
+    std::copy(owned->begin(), owned->end(), static_cast<byte *>(data));
+    delete owned;
+    return result;
+}
+
+/**
+ * repository.get(id): { type, data } for blobs, { type, items } for trees,
+ * commit's fields for commits
+ */
+napi_value __napi_repository_get(napi_env env, napi_callback_info info) {
+    std::vector<napi_value> args(1);
+    napi_value self;
+    repository *repo;
+    if (!__napi_this(env, info, 1, args, self, repo)) {
+        return nullptr;
+    }
+    std::shared_ptr<sign_t> sign(new sign_t());
+    if (!__napi_sign_arg(env, args[0], *sign)) {
+        napi_throw_type_error(env, nullptr, "bad object id");
+        return nullptr;
+    }
+
+    std::shared_ptr<object> obj(new object());
+    return __napi_queue(env,
+                        self,
+                        [repo, sign, obj] () -> void {
+                            *obj = repo->get(*sign);
+                            if (obj->type() == obj_type::obj_type_unknow) {
+                                throw std::runtime_error("object not found");
+                            }
+                        },
+                        [sign, obj] (napi_env env) -> napi_value {
+                            napi_value result;
+                            switch (obj->type()) {
+                            case obj_type::obj_type_blob:
+                                napi_create_object(env, &result);
+                                __inl_set(env, result, "data",
+                                          __napi_blob(env, std::move(obj->get<blob>().body())));
+                                break;
+                            case obj_type::obj_type_tree:
+                                napi_create_object(env, &result);
+                                __inl_set(env, result, "items",
+                                          __napi_tree(env, obj->get<tree>().items()));
+                                break;
+                            case obj_type::obj_type_commit:
+                                result = __napi_commit(env, *sign, obj->get<commit>().body());
+                                break;
+                            default:
+                                napi_create_object(env, &result);
+                                break;
+                            }
+                            __inl_set(env, result, "type", __inl_string(env, __inl_type_name(obj->type())));
+                            return result;
+                        });
+}
+
+/**
+ * repository.tree(id): [{ name, id, type }]
+ */
+napi_value __napi_repository_tree(napi_env env, napi_callback_info info) {
+    std::vector<napi_value> args(1);
+    napi_value self;
+    repository *repo;
+    if (!__napi_this(env, info, 1, args, self, repo)) {
+        return nullptr;
+    }
+    std::shared_ptr<sign_t> sign(new sign_t());
+    if (!__napi_sign_arg(env, args[0], *sign)) {
+        napi_throw_type_error(env, nullptr, "bad object id");
+        return nullptr;
+    }
+
+    std::shared_ptr<object> obj(new object());
+    return __napi_queue(env,
+                        self,
+                        [repo, sign, obj] () -> void {
+                            *obj = repo->get(*sign);
+                            if (obj->type() != obj_type::obj_type_tree) {
+                                throw std::runtime_error("tree not found");
+                            }
+                        },
+                        [obj] (napi_env env) -> napi_value {
+                            return __napi_tree(env, obj->get<tree>().items());
+                        });
+}
+
+/**
+ * repository.commit(id): { id, tree, parents, author, committer, message }
+ */
+napi_value __napi_repository_commit(napi_env env, napi_callback_info info) {
+    std::vector<napi_value> args(1);
+    napi_value self;
+    repository *repo;
+    if (!__napi_this(env, info, 1, args, self, repo)) {
+        return nullptr;
+    }
+    std::shared_ptr<sign_t> sign(new sign_t());
+    if (!__napi_sign_arg(env, args[0], *sign)) {
+        napi_throw_type_error(env, nullptr, "bad object id");
+        return nullptr;
+    }
+
+    std::shared_ptr<commit_body> body(new commit_body());
+    return __napi_queue(env,
+                        self,
+                        [repo, sign, body] () -> void {
+                            object obj = repo->get(*sign);
+                            if (obj.type() != obj_type::obj_type_commit) {
+                                throw std::runtime_error("commit not found");
+                            }
+                            *body = obj.get<commit>().body();
+                        },
+                        [sign, body] (napi_env env) -> napi_value {
+                            return __napi_commit(env, *sign, *body);
+                        });
+}
+
+/**
+ * repository.log(id, { path, limit }): commits from newest, optionally
+ * limited to those changing path
+ */
+napi_value __napi_repository_log(napi_env env, napi_callback_info info) {
+    std::vector<napi_value> args(2);
+    napi_value self;
+    repository *repo;
+    if (!__napi_this(env, info, 1, args, self, repo)) {
+        return nullptr;
+    }
+    sign_t start;
+    if (!__napi_sign_arg(env, args[0], start)) {
+        napi_throw_type_error(env, nullptr, "bad object id");
+        return nullptr;
+    }
+
+    std::string path;
+    uint32_t limit = 0;
+    napi_valuetype options_type = napi_undefined;
+    if (args[1] != nullptr) {
+        napi_typeof(env, args[1], &options_type);
+    }
+    if (options_type == napi_object) {
+        bool has;
+        napi_value value;
+        napi_has_named_property(env, args[1], "path", &has);
+        if (has) {
+            napi_get_named_property(env, args[1], "path", &value);
+            __napi_string_arg(env, value, path);
+        }
+        napi_has_named_property(env, args[1], "limit", &has);
+        if (has) {
+            napi_get_named_property(env, args[1], "limit", &value);
+            napi_get_value_uint32(env, value, &limit);
+        }
+    }
+
+    typedef std::vector<std::pair<sign_t, commit_body>> commits_t;
+    std::shared_ptr<commits_t> commits(new commits_t());
+    return __napi_queue(env,
+                        self,
+                        [repo, start, path, limit, commits] () -> void {
+                            revwalk walk(*repo);
+                            walk.path(path);
+                            walk.push(start);
+
+                            sign_t sign;
+                            commit_body body;
+                            while ((limit == 0 || commits->size() < limit) && walk.next(sign, body)) {
+                                commits->push_back(std::make_pair(sign, body));
+                            }
+                        },
+                        [commits] (napi_env env) -> napi_value {
+                            napi_value result;
+                            napi_create_array_with_length(env, commits->size(), &result);
+                            for (size_t i = 0; i < commits->size(); i++) {
+                                napi_set_element(env, result, i,
+                                                 __napi_commit(env, (*commits)[i].first, (*commits)[i].second));
+                            }
+                            return result;
+                        });
+}
+
+/**
+ * Repository's constructor only accepts the handle made by open()
+ */
+napi_value __napi_repository_new(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value arg;
+    napi_value self;
+    napi_get_cb_info(env, info, &argc, &arg, &self, nullptr);
+
+    napi_valuetype type = napi_undefined;
+    if (argc == 1) {
+        napi_typeof(env, arg, &type);
+    }
+    if (type != napi_external) {
+        napi_throw_type_error(env, nullptr, "use gitfsi.open(path)");
+        return nullptr;
+    }
+
+    void *repo;
+    napi_get_value_external(env, arg, &repo);
+    napi_wrap(env,
+              self,
+              repo,
+              [] (napi_env, void *data, void *) -> void {
+                  delete static_cast<repository *>(data);
+              },
+              nullptr,
+              nullptr);
+    return self;
+}
+
+/**
+ * open(path): promise of a Repository, pack indexes are loaded off the
+ * main thread
+ */
+napi_value __napi_open(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value arg;
+    napi_get_cb_info(env, info, &argc, &arg, nullptr, nullptr);
+
+    std::string path;
+    if (argc < 1 || !__napi_string_arg(env, arg, path)) {
+        napi_throw_type_error(env, nullptr, "path must be a string");
+        return nullptr;
+    }
+
+    std::shared_ptr<repository *> repo(new repository *(nullptr));
+    return __napi_queue(env,
+                        nullptr,
+                        [path, repo] () -> void {
+                            if (access((path + "/objects/pack").c_str(), R_OK) == -1) {
+                                throw std::runtime_error("not a repository: " + path);
+                            }
+                            *repo = new repository(path);
+                            (*repo)->initialize_packs();
+                        },
+                        [repo] (napi_env env) -> napi_value {
+                            __napi_addon_s *addon;
+                            napi_get_instance_data(env, reinterpret_cast<void **>(&addon));
+
+                            napi_value constructor;
+                            napi_value handle;
+                            napi_value result;
+                            napi_get_reference_value(env, addon->repository_constructor, &constructor);
+                            napi_create_external(env, *repo, nullptr, nullptr, &handle);
+                            napi_new_instance(env, constructor, 1, &handle, &result);
+                            return result;
+                        });
+}
+
+}
+}
+
+using namespace gitter_kid::fsi;
+
+NAPI_MODULE_INIT() {
+    napi_property_descriptor methods[] = {
+        { "get", nullptr, __napi_repository_get, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "tree", nullptr, __napi_repository_tree, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "commit", nullptr, __napi_repository_commit, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "log", nullptr, __napi_repository_log, nullptr, nullptr, nullptr, napi_default, nullptr }
+    };
+
+    napi_value constructor;
+    napi_define_class(env,
+                      "Repository",
+                      NAPI_AUTO_LENGTH,
+                      __napi_repository_new,
+                      nullptr,
+                      sizeof(methods) / sizeof(methods[0]),
+                      methods,
+                      &constructor);
+
+    __napi_addon_s *addon = new __napi_addon_s();
+    napi_create_reference(env, constructor, 1, &addon->repository_constructor);
+    napi_set_instance_data(env,
+                           addon,
+                           [] (napi_env env, void *data, void *) -> void {
+                               __napi_addon_s *addon = static_cast<__napi_addon_s *>(data);
+                               napi_delete_reference(env, addon->repository_constructor);
+                               delete addon;
+                           },
+                           nullptr);
+
+    napi_value open;
+    napi_create_function(env, "open", NAPI_AUTO_LENGTH, __napi_open, nullptr, &open);
+    __inl_set(env, exports, "open", open);
+    __inl_set(env, exports, "Repository", constructor);
+    return exports;
+}
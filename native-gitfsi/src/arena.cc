@@ -0,0 +1,85 @@
+#include "arena.h"
+#include <cstdint>
+
+namespace gitter_kid {
+namespace fsi {
+
+arena::arena(size_t block_size)
+    : _cursor(nullptr)
+    , _remain(0)
+    , _block_size(block_size)
+    , _allocated(0) {}
+
+arena::~arena() {
+    this->release();
+}
+
+/**
+ * allocate from current block, a new block is taken when it's exhausted
+ * (large requests get a block of their own)
+ * Args:
+ *      size_t size: bytes count
+ *      size_t align: alignment
+ * Returns:
+ *      allocated memory
+ */
+void *arena::allocate(size_t size, size_t align) {
+    size_t padding = (align - (reinterpret_cast<uintptr_t>(this->_cursor) & (align - 1))) & (align - 1);
+
+    if (this->_cursor == nullptr || padding + size > this->_remain) {
+        if (size > this->_block_size / 4) {
+            void *block = ::operator new(size);
+            this->_blocks.push_back(block);
+            this->_allocated += size;
+            return block;
+        }
+
+        this->_blocks.push_back(::operator new(this->_block_size));
+        this->_cursor = static_cast<byte *>(this->_blocks.back());
+        this->_remain = this->_block_size;
+        this->_allocated += this->_block_size;
+        padding = 0;
+    }
+
+    void *result = this->_cursor + padding;
+    this->_cursor += padding + size;
+    this->_remain -= padding + size;
+    return result;
+}
+
+/**
+ * free every allocation at once
+ */
+void arena::release() {
+    for (auto itr = this->_blocks.begin(); itr != this->_blocks.end(); itr++) {
+        ::operator delete(*itr);
+    }
+    this->_blocks.clear();
+    this->_cursor = nullptr;
+    this->_remain = 0;
+    this->_allocated = 0;
+}
+
+size_t arena::allocated() const {
+    return this->_allocated;
+}
+
+/**
+ * getter/setter current thread's arena (nullptr for heap)
+ */
+arena *&arena::current() {
+    static thread_local arena *current_arena = nullptr;
+    return current_arena;
+}
+
+arena_scope::arena_scope(arena &scoped)
+    : _previous(arena::current()) {
+    arena::current() = &scoped;
+}
+
+arena_scope::~arena_scope() {
+    arena::current() = this->_previous;
+}
+
+}
+}
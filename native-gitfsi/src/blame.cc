@@ -0,0 +1,287 @@
+#include "blame.h"
+#include "blob.h"
+#include "tree.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace gitter_kid {
+namespace fsi {
+
+blame_entry::blame_entry(sign_t commit,
+                         size_t final_start,
+                         size_t orig_start,
+                         size_t count,
+                         commit_metadata author)
+    : _commit(commit)
+    , _final_start(final_start)
+    , _orig_start(orig_start)
+    , _count(count)
+    , _author(author) {}
+
+sign_t &blame_entry::commit() {
+    return this->_commit;
+}
+
+size_t &blame_entry::final_start() {
+    return this->_final_start;
+}
+
+size_t &blame_entry::orig_start() {
+    return this->_orig_start;
+}
+
+size_t &blame_entry::count() {
+    return this->_count;
+}
+
+commit_metadata &blame_entry::author() {
+    return this->_author;
+}
+
+// lines [final_start, final_start + count) of the blamed file are lines
+// [suspect_start, suspect_start + count) of the suspect's blob (0-based)
+struct __blame_chunk_s {
+    size_t final_start;
+    size_t suspect_start;
+    size_t count;
+};
+
+struct __blame_suspect_s {
+    commit_body body;
+    sign_t blob;
+    std::vector<__blame_chunk_s> chunks;
+};
+
+// parsed blob, shared by every pending suspect referring it
+struct __blame_blob_s {
+    std::basic_string<byte> content;
+    std::vector<line_span_s> lines;
+    size_t refs;
+};
+
+struct __blame_parent_s {
+    sign_t sign;
+    commit_body body;
+    sign_t blob;
+};
+
+blame::blame(repository &repo)
+    : _repo(repo)
+    , _algorithm(diff_algorithm::diff_algorithm_myers)
+    , _lines(0) {}
+
+diff_algorithm &blame::algorithm() {
+    return this->_algorithm;
+}
+
+std::vector<blame_entry> &blame::entries() {
+    return this->_entries;
+}
+
+size_t blame::lines() const {
+    return this->_lines;
+}
+
+/**
+ * blame every line of path at commit. Suspects are visited from the
+ * newest commit, lines unchanged in a parent are passed to that parent
+ * and the rest are attributed to the suspect. The walk stops as soon as
+ * every line is attributed
+ * Args:
+ *      sign_t commit_sign: commit's sign
+ *      const std::string &path: blamed file's path
+ *      std::function<void (blame_entry &)> callback: invoked once per
+ *          entry as soon as it's attributed (in attribution order)
+ * Returns:
+ *      entries ordered by final line
+ */
+std::vector<blame_entry> &blame::run(sign_t commit_sign,
+                                     const std::string &path,
+                                     std::function<void (blame_entry &)> callback) {
+    this->_entries.clear();
+    this->_lines = 0;
+
+    std::map<sign_t, __blame_blob_s> blobs;
+    std::map<sign_t, __blame_suspect_s> suspects;
+    std::priority_queue<std::pair<uint64_t, sign_t>> queue;
+
+    auto load_commit = [&] (sign_t &sign, commit_body &body) -> bool {
+        object obj = this->_repo.get(sign);
+        if (obj.type() != obj_type::obj_type_commit) {
+            return false;
+        }
+        body = obj.get<commit>().body();
+        return true;
+    };
+
+    auto lookup_blob = [&] (commit_body &body) -> sign_t {
+        obj_type type;
+        sign_t blob_sign = this->_repo.lookup(sign_t(body.tree_sign()), path, type);
+        return type == obj_type::obj_type_blob ? blob_sign : sign_t();
+    };
+
+    auto acquire_blob = [&] (sign_t &sign) -> __blame_blob_s * {
+        auto find_result = blobs.find(sign);
+        if (find_result != blobs.end()) {
+            find_result->second.refs++;
+            return &find_result->second;
+        }
+
+        object obj = this->_repo.get(sign);
+        if (obj.type() != obj_type::obj_type_blob) {
+            return nullptr;
+        }
+        __blame_blob_s &parsed = blobs[sign];
+        parsed.content = obj.get<blob>().body();
+        parsed.lines = split_lines(parsed.content);
+        parsed.refs = 1;
+        return &parsed;
+    };
+
+    auto release_blob = [&] (sign_t &sign) -> void {
+        auto find_result = blobs.find(sign);
+        if (find_result != blobs.end() && --find_result->second.refs == 0) {
+            blobs.erase(find_result);
+        }
+    };
+
+    auto pass = [&] (__blame_parent_s &parent, const __blame_chunk_s &chunk) -> void {
+        auto find_result = suspects.find(parent.sign);
+        if (find_result == suspects.end()) {
+            acquire_blob(parent.blob);
+            find_result = suspects.insert(std::make_pair(parent.sign, __blame_suspect_s())).first;
+            find_result->second.body = parent.body;
+            find_result->second.blob = parent.blob;
+            queue.push(std::make_pair(parent.body.committer().timestamp(), parent.sign));
+        }
+        find_result->second.chunks.push_back(chunk);
+    };
+
+    __blame_suspect_s &root = suspects[commit_sign];
+    if (!load_commit(commit_sign, root.body)) {
+        return this->_entries;
+    }
+    root.blob = lookup_blob(root.body);
+    __blame_blob_s *root_blob = root.blob.bytes().empty() ? nullptr : acquire_blob(root.blob);
+    if (root_blob == nullptr || root_blob->lines.empty()) {
+        return this->_entries;
+    }
+    this->_lines = root_blob->lines.size();
+    root.chunks.push_back({ 0, 0, this->_lines });
+    queue.push(std::make_pair(root.body.committer().timestamp(), commit_sign));
+
+    size_t remaining = this->_lines;
+    while (!queue.empty() && remaining != 0) {
+        sign_t sign = queue.top().second;
+        queue.pop();
+
+        auto find_result = suspects.find(sign);
+        if (find_result == suspects.end()) {
+            continue;
+        }
+        __blame_suspect_s suspect = find_result->second;
+        suspects.erase(find_result);
+        __blame_blob_s &suspect_blob = blobs.find(suspect.blob)->second;
+
+        // a parent with the same blob takes the whole blame
+        std::vector<__blame_parent_s> parents;
+        for (auto itr = suspect.body.parents().begin(); itr != suspect.body.parents().end(); itr++) {
+            __blame_parent_s parent;
+            parent.sign = *itr;
+            if (!load_commit(parent.sign, parent.body)) {
+                continue;
+            }
+            parent.blob = lookup_blob(parent.body);
+            if (parent.blob.bytes().empty()) {
+                continue;
+            }
+
+            if (parent.blob == suspect.blob) {
+                for (auto chunk = suspect.chunks.begin(); chunk != suspect.chunks.end(); chunk++) {
+                    pass(parent, *chunk);
+                }
+                suspect.chunks.clear();
+                break;
+            }
+            parents.push_back(parent);
+        }
+
+        for (auto parent = parents.begin(); parent != parents.end() && !suspect.chunks.empty(); parent++) {
+            __blame_blob_s *parent_blob = acquire_blob(parent->blob);
+            if (parent_blob == nullptr) {
+                continue;
+            }
+
+            line_interner interner;
+            std::vector<uint32_t> a = interner.intern(parent_blob->content, parent_blob->lines);
+            std::vector<uint32_t> b = interner.intern(suspect_blob.content, suspect_blob.lines);
+            std::vector<diff_range_s> changes = diff_sequences(a, b, this->_algorithm);
+
+            // suspect's line -> parent's line (npos for changed lines)
+            std::vector<size_t> to_parent(b.size(), std::string::npos);
+            size_t ao = 0;
+            size_t bo = 0;
+            for (auto change = changes.begin(); change != changes.end(); change++) {
+                while (bo < change->new_begin) {
+                    to_parent[bo++] = ao++;
+                }
+                ao = change->old_end;
+                bo = change->new_end;
+            }
+            while (bo < b.size()) {
+                to_parent[bo++] = ao++;
+            }
+
+            std::vector<__blame_chunk_s> kept;
+            for (auto chunk = suspect.chunks.begin(); chunk != suspect.chunks.end(); chunk++) {
+                for (size_t i = 0; i < chunk->count; ) {
+                    size_t first = to_parent[chunk->suspect_start + i];
+                    size_t j = i + 1;
+                    if (first == std::string::npos) {
+                        while (j < chunk->count && to_parent[chunk->suspect_start + j] == std::string::npos) {
+                            j++;
+                        }
+                        kept.push_back({ chunk->final_start + i, chunk->suspect_start + i, j - i });
+                    }
+                    else {
+                        while (j < chunk->count && to_parent[chunk->suspect_start + j] == first + j - i) {
+                            j++;
+                        }
+                        pass(*parent, { chunk->final_start + i, first, j - i });
+                    }
+                    i = j;
+                }
+            }
+            suspect.chunks.swap(kept);
+
+            release_blob(parent->blob);
+        }
+
+        for (auto chunk = suspect.chunks.begin(); chunk != suspect.chunks.end(); chunk++) {
+            this->_entries.push_back(blame_entry(sign,
+                                                 chunk->final_start + 1,
+                                                 chunk->suspect_start + 1,
+                                                 chunk->count,
+                                                 suspect.body.author()));
+            if (callback) {
+                callback(this->_entries.back());
+            }
+            remaining -= chunk->count;
+        }
+
+        release_blob(suspect.blob);
+    }
+
+    std::sort(this->_entries.begin(),
+              this->_entries.end(),
+              [] (blame_entry &a, blame_entry &b) -> bool {
+                return a.final_start() < b.final_start();
+              });
+
+    return this->_entries;
+}
+
+}
+}
@@ -1,4 +1,6 @@
 #include "blob.h"
+#include "simd.h"
+#include <algorithm>
 
 namespace gitter_kid {
 namespace fsi {
@@ -6,6 +8,9 @@ namespace fsi {
 blob::blob(std::basic_string<byte> &body)
     : _body(body) { }
 
+blob::blob(std::basic_string<byte> &&body)
+    : _body(std::move(body)) { }
+
 obj_type blob::type() const {
     return obj_type_blob;
 }
@@ -14,5 +19,30 @@ std::basic_string<byte> &blob::body() {
     return this->_body;
 }
 
+/**
+ * sniff content's leading bytes, content is binary if it contains a NUL
+ * or more than 1/128 of it is non-printable
+ * Args:
+ *      const byte *begin: content's begin
+ *      const byte *end: content's end
+ * Returns:
+ *      blob_class_text or blob_class_binary
+ */
+blob_class classify_content(const byte *begin, const byte *end) {
+    end = begin + std::min(size_t(end - begin), BLOB_SNIFF_LEN);
+
+    bool has_nul = false;
+    size_t nonprintable = __count_control_bytes(begin, end, has_nul);
+    if (has_nul) {
+        return blob_class::blob_class_binary;
+    }
+
+    size_t printable = size_t(end - begin) - nonprintable;
+    if ((printable >> 7) < nonprintable) {
+        return blob_class::blob_class_binary;
+    }
+    return blob_class::blob_class_text;
+}
+
 }
 }
@@ -5,7 +5,8 @@
 namespace gitter_kid {
 namespace fsi {
 
-commit_metadata::commit_metadata() {}
+commit_metadata::commit_metadata()
+    : _timestamp(0) {}
 
 commit_metadata::commit_metadata(std::string name,
                                  std::string mail,
@@ -18,25 +19,32 @@ commit_metadata::commit_metadata(std::string name,
 
 commit_metadata::commit_metadata(std::basic_string<byte>::iterator begin,
                                  std::basic_string<byte>::iterator end) {
-    std::basic_string<byte> fields[4];
-    std::basic_string<byte>::iterator ch = begin;
-
-    int i;
-    for (i = 0; ch != end && i < 4; i++) {
-        auto space_itr = std::find(ch, end, byte(' '));
-        if (space_itr != end) {
-            fields[i].assign(ch, space_itr);
-            ch = space_itr + 1;
-        }
-        else {
-            ch = end;
-        }
+    // "<name> <<mail>> <timestamp> <timezone>", name may contain spaces
+    std::basic_string<byte>::iterator mail_begin = std::find(begin, end, byte('<'));
+    std::basic_string<byte>::iterator mail_end = std::find(mail_begin, end, byte('>'));
+    if (mail_end != end) {
+        mail_end++;
+    }
+
+    std::basic_string<byte>::iterator name_end = mail_begin;
+    while (name_end != begin && *(name_end - 1) == byte(' ')) {
+        name_end--;
     }
+    this->_name.assign(begin, name_end);
+    this->_mail.assign(mail_begin, mail_end);
 
-    this->_name.assign(fields[0].begin(), fields[0].end());
-    this->_mail.assign(fields[1].begin(), fields[1].end());
-    this->_timestamp = std::stol(std::string(fields[2].begin(), fields[2].end()));
-    this->_timezone.assign(fields[3].begin(), fields[3].end());
+    std::basic_string<byte>::iterator ch = mail_end;
+    while (ch != end && *ch == byte(' ')) {
+        ch++;
+    }
+    this->_timestamp = 0;
+    for (; ch != end && '0' <= *ch && *ch <= '9'; ch++) {
+        this->_timestamp = this->_timestamp * 10 + (*ch - '0');
+    }
+    while (ch != end && *ch == byte(' ')) {
+        ch++;
+    }
+    this->_timezone.assign(ch, end);
 }
 
 std::string &commit_metadata::name() {
@@ -55,9 +63,10 @@ std::string &commit_metadata::timezone() {
     return this->_timezone;
 }
 
-commit_body::commit_body() {}
+commit_body::commit_body()
+    : _parents(arena_allocator<sign_t>(arena::current())) {}
 
-std::vector<sign_t> &commit_body::parents() {
+commit_parents &commit_body::parents() {
     return this->_parents;
 }
 
@@ -77,10 +86,8 @@ commit_metadata &commit_body::committer() {
     return this->_committer;
 }
 
-commit::commit(commit_body &body,
-               std::basic_string<byte>::iterator spliter,
-               std::basic_string<byte>::iterator end)
-    : _body(body) {
+commit::commit(std::basic_string<byte>::iterator spliter,
+               std::basic_string<byte>::iterator end) {
     for (std::basic_string<byte>::iterator ch = spliter; ch != end; ) {
         std::basic_string<byte>::iterator end_line_iter = std::find(ch, end, byte('\n'));
 
@@ -102,7 +109,7 @@ commit::commit(commit_body &body,
             this->_body.committer() = commit_metadata(space_iter + 1, end_line_iter);
         }
         else if (tag.compare("parent") == 0) {
-            this->_body.parents().push_back(sign_t());
+            this->_body.parents().push_back(sign_t(arena::current()));
             this->_body.parents().back().str_assign(space_iter + 1, end_line_iter);
         }
 
@@ -0,0 +1,552 @@
+#include "fsck.h"
+#include "pack.h"
+#include "inflate.h"
+#include "parallel.h"
+#include "sha1.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace gitter_kid {
+namespace fsi {
+
+// checksummed files are read in blocks of this size
+const size_t __FSCK_READ_LEN = 1024 * 1024;
+
+// a pool job: a pack's checksums or a run of loose objects
+struct __fsck_job_s {
+    // nullptr for loose objects
+    std::shared_ptr<pack> checked_pack;
+    size_t begin;
+    size_t end;
+};
+
+// what a job found, merged into the report once it's done
+struct __fsck_result_s {
+    std::vector<fsck_issue> issues;
+    // (referencing object, referenced object) as positions in the sorted
+    // known ids, so an edge costs 8 bytes
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    // links to ids that aren't in the repository
+    std::vector<std::pair<uint32_t, sign_t>> broken_links;
+    size_t objects;
+    uint64_t bytes;
+};
+
+// the object whose links are collected
+struct __fsck_links_s {
+    // every id in the repository, sorted; nullptr if links aren't collected
+    const std::vector<sign_t> *known;
+    // object's position in known
+    uint32_t from;
+};
+
+/**
+ * record a link from the checked object
+ */
+inline void __inl_fsck_link(__fsck_result_s &result, const __fsck_links_s &links, const sign_t &to) {
+    if (links.known == nullptr) {
+        return;
+    }
+    auto found = std::lower_bound(links.known->begin(), links.known->end(), to);
+    if (found != links.known->end() && *found == to) {
+        result.links.push_back(std::make_pair(links.from, uint32_t(found - links.known->begin())));
+    }
+    else {
+        result.broken_links.push_back(std::make_pair(links.from, to));
+    }
+}
+
+inline void __inl_fsck_issue(__fsck_result_s &result,
+                             fsck_issue_kind kind,
+                             const sign_t &sign,
+                             const std::string &detail) {
+    fsck_issue issue;
+    issue.kind = kind;
+    issue.sign = sign;
+    issue.detail = detail;
+    result.issues.push_back(issue);
+}
+
+/**
+ * whether hex is a full lowercase id
+ */
+inline bool __inl_fsck_hex(const std::string &hex, size_t sign_len) {
+    return hex.size() == 2 * sign_len
+        && std::all_of(hex.begin(), hex.end(), [] (char ch) -> bool {
+                return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f');
+           });
+}
+
+/**
+ * hash a file but its trailing checksum
+ * Args:
+ *      const std::string &path: file's path
+ *      sign_t &digest: SHA-1 of all but the last SHA1_LEN bytes (output)
+ *      std::basic_string<byte> &tail: last 2 * SHA1_LEN bytes (output)
+ * Returns:
+ *      false if the file can't be read or is too short
+ */
+bool __fsck_digest(const std::string &path, sign_t &digest, std::basic_string<byte> &tail) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < 2 * SHA1_LEN) {
+        close(fd);
+        return false;
+    }
+    posix_fadvise(fd, 0, st.st_size, POSIX_FADV_SEQUENTIAL);
+
+    size_t hashed_len = st.st_size - SHA1_LEN;
+    sha1 hasher;
+    std::basic_string<byte> buf(__FSCK_READ_LEN, 0);
+    size_t off = 0;
+    while (off < hashed_len) {
+        ssize_t read_len = pread(fd, &buf[0], std::min(__FSCK_READ_LEN, hashed_len - off), off);
+        if (read_len <= 0) {
+            close(fd);
+            return false;
+        }
+        hasher.update(buf.data(), read_len);
+        off += read_len;
+    }
+
+    tail.resize(2 * SHA1_LEN);
+    bool tail_read = pread(fd, &tail[0], tail.size(), st.st_size - tail.size()) == ssize_t(tail.size());
+    close(fd);
+    // a detected collision attack fails the check like a mismatch
+    return tail_read && hasher.final(digest);
+}
+
+/**
+ * check a pack's trailer, its idx's trailer and that the idx was built
+ * for this pack
+ */
+void __fsck_checksums(pack &checked_pack, __fsck_result_s &result) {
+    sign_t pack_digest;
+    sign_t idx_digest;
+    std::basic_string<byte> pack_tail;
+    std::basic_string<byte> idx_tail;
+    if (!__fsck_digest(checked_pack.pack_path(), pack_digest, pack_tail)) {
+        __inl_fsck_issue(result, fsck_issue_checksum, sign_t(),
+                         checked_pack.pack_path() + ": unreadable");
+        return;
+    }
+    if (!__fsck_digest(checked_pack.idx_path(), idx_digest, idx_tail)) {
+        __inl_fsck_issue(result, fsck_issue_checksum, sign_t(),
+                         checked_pack.idx_path() + ": unreadable");
+        return;
+    }
+
+    std::basic_string<byte> pack_trailer = pack_tail.substr(SHA1_LEN);
+    if (!std::equal(pack_trailer.begin(), pack_trailer.end(), pack_digest.bytes().begin())) {
+        __inl_fsck_issue(result, fsck_issue_checksum, sign_t(),
+                         checked_pack.pack_path() + ": pack checksum mismatch");
+    }
+    if (!std::equal(idx_tail.begin() + SHA1_LEN, idx_tail.end(), idx_digest.bytes().begin())) {
+        __inl_fsck_issue(result, fsck_issue_checksum, sign_t(),
+                         checked_pack.idx_path() + ": idx checksum mismatch");
+    }
+    // idx files end with their pack's checksum, then their own
+    if (!std::equal(idx_tail.begin(), idx_tail.begin() + SHA1_LEN, pack_trailer.begin())) {
+        __inl_fsck_issue(result, fsck_issue_checksum, sign_t(),
+                         checked_pack.idx_path() + ": doesn't match its pack");
+    }
+}
+
+/**
+ * check a tree's entries: names are non-empty, have no '/', aren't "." or
+ * "..", and are unique and sorted the way git sorts them (trees compare as
+ * if their name ended with '/')
+ */
+void __fsck_tree(sign_t &sign, tree &checked_tree, __fsck_result_s &result, const __fsck_links_s &links) {
+    std::string prev_key;
+    std::string prev_name;
+    bool first = true;
+    // files a same-named tree may still follow: "a", "a-b", "a/" is sorted
+    std::vector<std::string> pending_files;
+    for (auto itr = checked_tree.items().begin(); itr != checked_tree.items().end(); itr++) {
+        std::string &name = itr->name();
+        if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+            __inl_fsck_issue(result, fsck_issue_malformed, sign, "tree: bad entry name '" + name + "'");
+        }
+
+        std::string key = itr->type() == obj_type::obj_type_tree ? name + "/" : name;
+        if (!first && name == prev_name) {
+            __inl_fsck_issue(result, fsck_issue_malformed, sign, "tree: duplicate entry '" + name + "'");
+        }
+        else if (!first && key < prev_key) {
+            __inl_fsck_issue(result, fsck_issue_malformed, sign, "tree: not properly sorted");
+        }
+
+        pending_files.erase(std::remove_if(pending_files.begin(),
+                                           pending_files.end(),
+                                           [&key] (const std::string &file) -> bool {
+                                               return file + "/" < key;
+                                           }),
+                            pending_files.end());
+        if (itr->type() != obj_type::obj_type_tree) {
+            pending_files.push_back(name);
+        }
+        else if (name != prev_name
+                 && std::find(pending_files.begin(), pending_files.end(), name) != pending_files.end()) {
+            __inl_fsck_issue(result, fsck_issue_malformed, sign, "tree: duplicate entry '" + name + "'");
+        }
+        prev_key.swap(key);
+        prev_name = name;
+        first = false;
+
+        // submodules' commits live in other repositories
+        if (itr->type() != obj_type::obj_type_commit) {
+            __inl_fsck_link(result, links, itr->sign());
+        }
+    }
+}
+
+void __fsck_commit(sign_t &sign, commit &checked_commit, size_t sign_len,
+                   __fsck_result_s &result, const __fsck_links_s &links) {
+    commit_body &body = checked_commit.body();
+    if (!__inl_fsck_hex(body.tree_sign(), sign_len)) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "commit: bad tree id");
+    }
+    else {
+        __inl_fsck_link(result, links, sign_t(body.tree_sign()));
+    }
+
+    for (auto itr = body.parents().begin(); itr != body.parents().end(); itr++) {
+        if (!__inl_fsck_hex(itr->str(), sign_len)) {
+            __inl_fsck_issue(result, fsck_issue_malformed, sign, "commit: bad parent id");
+        }
+        else {
+            __inl_fsck_link(result, links, *itr);
+        }
+    }
+
+    if (body.author().mail().empty()) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "commit: missing author");
+    }
+    if (body.committer().mail().empty()) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "commit: missing committer");
+    }
+}
+
+void __fsck_tag(sign_t &sign, tag &checked_tag, size_t sign_len,
+                __fsck_result_s &result, const __fsck_links_s &links) {
+    tag_body &body = checked_tag.get();
+    if (body.type() == obj_type::obj_type_unknow) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "tag: bad object type");
+    }
+    if (body.name().empty()) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "tag: missing name");
+    }
+    if (!__inl_fsck_hex(body.obj_sign(), sign_len)) {
+        __inl_fsck_issue(result, fsck_issue_malformed, sign, "tag: bad object id");
+    }
+    else {
+        __inl_fsck_link(result, links, sign_t(body.obj_sign()));
+    }
+}
+
+/**
+ * check a read object's structure and collect its links
+ * Args:
+ *      sign_t &sign: object's id
+ *      object &obj: object, obj_type_unknow if it couldn't be read or its
+ *                   content doesn't hash to its id
+ *      size_t sign_len: repository's id width
+ *      __fsck_result_s &result: job's findings (output)
+ *      const std::vector<sign_t> *known: every id in the repository, sorted,
+ *                                        nullptr if links aren't collected
+ */
+void __fsck_object(sign_t &sign, object &obj, size_t sign_len,
+                   __fsck_result_s &result, const std::vector<sign_t> *known) {
+    result.objects++;
+    __fsck_links_s links { known, 0 };
+    if (known != nullptr) {
+        links.from = uint32_t(std::lower_bound(known->begin(), known->end(), sign) - known->begin());
+    }
+    switch (obj.type()) {
+    case obj_type::obj_type_tree:
+        __fsck_tree(sign, obj.get<tree>(), result, links);
+        break;
+    case obj_type::obj_type_commit:
+        __fsck_commit(sign, obj.get<commit>(), sign_len, result, links);
+        break;
+    case obj_type::obj_type_tag:
+        __fsck_tag(sign, obj.get<tag>(), sign_len, result, links);
+        break;
+    case obj_type::obj_type_blob:
+        break;
+    default:
+        __inl_fsck_issue(result, fsck_issue_corrupt, sign, "unreadable or hash mismatch");
+        break;
+    }
+}
+
+/**
+ * check a loose object: it inflates, its header's size is its content's
+ * size and (if hashes_checked) it hashes to its id
+ */
+void __fsck_loose(repository &repo, sign_t &sign, bool hashes_checked,
+                  __fsck_result_s &result, const std::vector<sign_t> *known) {
+    std::ifstream loose_file(repo.looseobj_path(sign), std::ios::binary);
+    std::basic_string<byte> file_content((std::istreambuf_iterator<char>(loose_file)),
+                                         std::istreambuf_iterator<char>());
+    result.bytes += file_content.size();
+
+    std::basic_string<byte> inflated;
+    if (!file_content.empty()) {
+        inflated = __inflate(file_content, file_content.size() * 2);
+    }
+
+    // "<type> <size>\0<content>"
+    auto spliter = std::find(inflated.begin(), inflated.end(), byte(0));
+    auto space = std::find(inflated.begin(), spliter, byte(' '));
+    std::string declared_len(space == spliter ? spliter : space + 1, spliter);
+    if (spliter == inflated.end()
+        || declared_len != std::to_string(inflated.end() - spliter - 1)) {
+        result.objects++;
+        __inl_fsck_issue(result, fsck_issue_corrupt, sign, "loose object: bad header");
+        return;
+    }
+
+    if (hashes_checked) {
+        sha1 hasher;
+        hasher.update(inflated.data(), inflated.size());
+        sign_t computed;
+        if (!hasher.final(computed) || computed != sign) {
+            result.objects++;
+            __inl_fsck_issue(result, fsck_issue_corrupt, sign, "loose object: hash mismatch");
+            return;
+        }
+    }
+
+    object obj(std::move(inflated), repo.sign_len());
+    __fsck_object(sign, obj, repo.sign_len(), result, known);
+}
+
+fsck::fsck(repository &repo)
+    : _repo(repo)
+    , _threads(0)
+    , _connectivity(true) {}
+
+unsigned &fsck::threads() {
+    return this->_threads;
+}
+
+bool &fsck::connectivity() {
+    return this->_connectivity;
+}
+
+std::function<void(const fsck_progress &)> &fsck::progress() {
+    return this->_progress;
+}
+
+/**
+ * run every check
+ * Returns:
+ *      counters and issues, sorted by object id
+ */
+fsck_report fsck::check() {
+    auto started = std::chrono::steady_clock::now();
+    auto elapsed = [&started] () -> double {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    fsck_report report;
+    report.objects = 0;
+    report.loose = 0;
+    report.reachable = 0;
+    report.unreachable = 0;
+    report.bytes = 0;
+    // checksums and ids are SHA-256 in SHA-256 repositories
+    report.hashes_checked = this->_repo.sign_len() == SHA1_LEN;
+
+    this->_repo.refresh_packs();
+    std::shared_ptr<const pack_list> packs = this->_repo.packs();
+    report.packs = packs->size();
+    std::vector<sign_t> loose_signs = this->_repo.loose_objects();
+    report.loose = loose_signs.size();
+
+    // checksum jobs come first, hashing a whole pack is the longest job
+    std::vector<__fsck_job_s> jobs;
+    for (auto itr = packs->begin(); itr != packs->end() && report.hashes_checked; itr++) {
+        jobs.push_back(__fsck_job_s { *itr, 0, 0 });
+    }
+    for (size_t begin = 0; begin < loose_signs.size(); begin += FSCK_CHUNK_LEN) {
+        jobs.push_back(__fsck_job_s { nullptr, begin, std::min(loose_signs.size(), begin + FSCK_CHUNK_LEN) });
+    }
+    size_t total = loose_signs.size();
+    for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+        total += (*itr)->off_index().size();
+    }
+
+    // links are collected as positions in the sorted ids
+    std::vector<sign_t> known;
+    if (this->_connectivity) {
+        known.reserve(total);
+        known.insert(known.end(), loose_signs.begin(), loose_signs.end());
+        for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+            for (auto idx = (*itr)->off_index().begin(); idx != (*itr)->off_index().end(); idx++) {
+                known.push_back(idx->sign);
+            }
+        }
+        std::sort(known.begin(), known.end());
+        known.erase(std::unique(known.begin(), known.end()), known.end());
+    }
+    const std::vector<sign_t> *links_known = this->_connectivity ? &known : nullptr;
+
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    std::vector<std::pair<uint32_t, sign_t>> broken_links;
+    std::mutex merge_mutex;
+    // the caller holds merge_mutex (or is the only thread left)
+    auto merge = [&] (__fsck_result_s &result) -> void {
+        report.issues.insert(report.issues.end(), result.issues.begin(), result.issues.end());
+        links.insert(links.end(), result.links.begin(), result.links.end());
+        broken_links.insert(broken_links.end(), result.broken_links.begin(), result.broken_links.end());
+        report.objects += result.objects;
+        report.bytes += result.bytes;
+        result.issues.clear();
+        result.links.clear();
+        result.broken_links.clear();
+        result.objects = 0;
+        result.bytes = 0;
+        if (this->_progress) {
+            this->_progress(fsck_progress { "objects", report.objects, total, report.bytes, elapsed() });
+        }
+    };
+
+    __parallel_for(jobs.size(), this->_threads, [&] (size_t i) -> void {
+        __fsck_job_s &job = jobs[i];
+        __fsck_result_s result;
+        result.objects = 0;
+        result.bytes = 0;
+
+        if (job.checked_pack != nullptr) {
+            __fsck_checksums(*job.checked_pack, result);
+        }
+        else {
+            for (size_t nth = job.begin; nth < job.end; nth++) {
+                __fsck_loose(this->_repo, loose_signs[nth], report.hashes_checked,
+                             result, links_known);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        merge(result);
+    });
+
+    // every delta is undeltified once, from its base's content
+    std::vector<__fsck_result_s> results(__parallel_threads(this->_threads));
+    for (auto itr = results.begin(); itr != results.end(); itr++) {
+        itr->objects = 0;
+        itr->bytes = 0;
+    }
+    size_t sign_len = this->_repo.sign_len();
+    for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+        std::vector<__pack_idx_s> &off_index = (*itr)->off_index();
+        for (auto index = off_index.begin(); index != off_index.end(); index++) {
+            results[0].bytes += index->len;
+        }
+
+        (*itr)->for_each(*packs,
+                         [&] (unsigned worker, sign_t &sign, object &obj) -> void {
+                             __fsck_result_s &result = results[worker];
+                             __fsck_object(sign, obj, sign_len, result, links_known);
+                             if (result.objects == FSCK_CHUNK_LEN) {
+                                 std::lock_guard<std::mutex> lock(merge_mutex);
+                                 merge(result);
+                             }
+                         },
+                         this->_threads,
+                         report.hashes_checked);
+        for (auto result = results.begin(); result != results.end(); result++) {
+            merge(*result);
+        }
+    }
+
+    if (this->_connectivity) {
+        if (this->_progress) {
+            this->_progress(fsck_progress { "connectivity", 0, known.size(), report.bytes, elapsed() });
+        }
+
+        auto find_known = [&known] (const sign_t &sign) -> size_t {
+            auto found = std::lower_bound(known.begin(), known.end(), sign);
+            return found != known.end() && *found == sign ? found - known.begin() : known.size();
+        };
+
+        std::sort(broken_links.begin(), broken_links.end());
+        broken_links.erase(std::unique(broken_links.begin(), broken_links.end()), broken_links.end());
+        for (auto itr = broken_links.begin(); itr != broken_links.end(); itr++) {
+            sign_t from = known[itr->first];
+            report.issues.push_back(fsck_issue { fsck_issue_missing, itr->second, "broken link from " + from.str() });
+        }
+
+        // sorted links are adjacency lists: object nth links to
+        // targets[targets_begin[nth]] up to targets[targets_begin[nth + 1]]
+        std::sort(links.begin(), links.end());
+        links.erase(std::unique(links.begin(), links.end()), links.end());
+        std::vector<size_t> targets_begin(known.size() + 1, 0);
+        std::vector<uint32_t> targets(links.size());
+        for (size_t i = 0; i < links.size(); i++) {
+            targets_begin[links[i].first + 1]++;
+            targets[i] = links[i].second;
+        }
+        for (size_t i = 0; i < known.size(); i++) {
+            targets_begin[i + 1] += targets_begin[i];
+        }
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(links);
+
+        // breadth-first from refs over the links
+        std::vector<bool> reached(known.size(), false);
+        std::vector<uint32_t> queue;
+        std::map<std::string, sign_t> refs = this->_repo.refs();
+        for (auto itr = refs.begin(); itr != refs.end(); itr++) {
+            size_t nth = find_known(itr->second);
+            if (nth == known.size()) {
+                report.issues.push_back(fsck_issue { fsck_issue_missing, itr->second,
+                                                     "referenced by " + itr->first });
+            }
+            else if (!reached[nth]) {
+                reached[nth] = true;
+                queue.push_back(uint32_t(nth));
+            }
+        }
+        for (size_t head = 0; head < queue.size(); head++) {
+            uint32_t from = queue[head];
+            for (size_t i = targets_begin[from]; i < targets_begin[from + 1]; i++) {
+                if (!reached[targets[i]]) {
+                    reached[targets[i]] = true;
+                    queue.push_back(targets[i]);
+                }
+            }
+        }
+        report.reachable = queue.size();
+        report.unreachable = known.size() - queue.size();
+        if (this->_progress) {
+            this->_progress(fsck_progress { "connectivity", known.size(), known.size(),
+                                            report.bytes, elapsed() });
+        }
+    }
+
+    std::sort(report.issues.begin(),
+              report.issues.end(),
+              [] (const fsck_issue &a, const fsck_issue &b) -> bool {
+                if (a.sign != b.sign) {
+                    return a.sign < b.sign;
+                }
+                return a.detail < b.detail;
+              });
+    report.seconds = elapsed();
+    return report;
+}
+
+}
+}
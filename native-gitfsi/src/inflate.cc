@@ -1,52 +1,208 @@
 #include "inflate.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#ifdef GITFSI_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 
 namespace gitter_kid {
 namespace fsi {
 
-std::basic_string<byte> __inflate(std::basic_string<byte> &deflate_bytes,
-                                  size_t inflate_bytes_len) {
-    std::basic_string<byte> inflate_bytes(inflate_bytes_len, byte(0));
+/**
+ * per-thread zlib stream, initialized once and reset between objects
+ * instead of paying inflateInit/inflateEnd (and their allocations) per call
+ */
+class __inflater {
+private:
+    z_stream _stream;
+    bool _ready;
+public:
+    __inflater() : _ready(false) {
+        this->_stream.zalloc = nullptr;
+        this->_stream.zfree = nullptr;
+        this->_stream.opaque = nullptr;
+        this->_stream.avail_in = 0;
+        this->_stream.next_in = nullptr;
+    }
 
-    z_stream inflated_stream;
-    inflated_stream.zalloc = nullptr;
-    inflated_stream.zfree = nullptr;
-    inflated_stream.opaque = nullptr;
-    inflated_stream.avail_in = deflate_bytes.size();
-    inflated_stream.next_in = const_cast<byte *>(deflate_bytes.data());
+    ~__inflater() {
+        if (this->_ready) {
+            inflateEnd(&this->_stream);
+        }
+    }
 
-    int retval = inflateInit(&inflated_stream);
-    if (retval != Z_OK) {
-        return std::basic_string<byte>();
+    /**
+     * stream ready for a new zlib stream, nullptr if zlib couldn't be set up
+     */
+    z_stream *reset(const byte *deflate_bytes, size_t deflate_bytes_len) {
+        if (!this->_ready) {
+            this->_ready = inflateInit(&this->_stream) == Z_OK;
+            if (!this->_ready) {
+                return nullptr;
+            }
+        }
+        else if (inflateReset(&this->_stream) != Z_OK) {
+            return nullptr;
+        }
+        this->_stream.avail_in = deflate_bytes_len;
+        this->_stream.next_in = const_cast<byte *>(deflate_bytes);
+        return &this->_stream;
     }
+};
 
-    std::basic_string<byte> result;
+thread_local __inflater __inflater_current;
 
-    do {
-        size_t capacity_size = inflate_bytes.capacity();
-        inflated_stream.avail_out = capacity_size;
-        inflated_stream.next_out = const_cast<byte *>(inflate_bytes.data());
-        retval = inflate(&inflated_stream, Z_NO_FLUSH);
+#ifdef GITFSI_LIBDEFLATE
+/**
+ * per-thread libdeflate decompressor
+ */
+class __libdeflate_inflater {
+private:
+    libdeflate_decompressor *_decompressor;
+public:
+    __libdeflate_inflater() : _decompressor(libdeflate_alloc_decompressor()) {}
 
-        switch (retval) {
-        case Z_NEED_DICT:
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-            inflateEnd(&inflated_stream);
-            return result;
+    ~__libdeflate_inflater() {
+        if (this->_decompressor != nullptr) {
+            libdeflate_free_decompressor(this->_decompressor);
         }
+    }
+
+    libdeflate_decompressor *get() {
+        return this->_decompressor;
+    }
+};
+
+thread_local __libdeflate_inflater __libdeflate_current;
+
+/**
+ * one-shot decompression, the inflated size must be known (pack headers)
+ * Returns:
+ *      false if the stream didn't inflate to exactly inflate_bytes_len
+ *      bytes (zlib handles it then)
+ */
+bool __libdeflate_inflate(const byte *deflate_bytes,
+                          size_t deflate_bytes_len,
+                          std::basic_string<byte> &result) {
+    if (__libdeflate_current.get() == nullptr) {
+        return false;
+    }
+    size_t in_len = 0;
+    size_t out_len = 0;
+    // the input may run past the stream's end (pack segments are read with slack)
+    libdeflate_result retval = libdeflate_zlib_decompress_ex(__libdeflate_current.get(),
+                                                             deflate_bytes,
+                                                             deflate_bytes_len,
+                                                             const_cast<byte *>(result.data()),
+                                                             result.size(),
+                                                             &in_len,
+                                                             &out_len);
+    return retval == LIBDEFLATE_SUCCESS && out_len == result.size();
+}
+#endif
 
-        if (capacity_size < inflated_stream.avail_out) {
+/**
+ * inflate a zlib stream straight into the returned buffer, sized
+ * inflate_bytes_len up front and grown if the stream is larger
+ * Args:
+ *      const byte *deflate_bytes: zlib stream (may be followed by other data)
+ *      size_t deflate_bytes_len: available input
+ *      size_t inflate_bytes_len: expected inflated size (exact for pack
+ *                                items, a hint for loose objects)
+ * Returns:
+ *      inflated bytes, what was inflated so far if the stream is corrupted
+ *      or truncated
+ */
+std::basic_string<byte> __inflate(const byte *deflate_bytes,
+                                  size_t deflate_bytes_len,
+                                  size_t inflate_bytes_len) {
+    GITFSI_TRACE_SPAN(span, "inflate");
+    GITFSI_METRICS_START(started);
+    std::basic_string<byte> result(inflate_bytes_len, byte(0));
+
+#ifdef GITFSI_LIBDEFLATE
+    if (inflate_bytes_len != 0 && __libdeflate_inflate(deflate_bytes, deflate_bytes_len, result)) {
+        GITFSI_TRACE_ARG(span, "bytes", result.size());
+        GITFSI_METRICS_ADD(metric_counter_inflated_bytes, result.size());
+        GITFSI_METRICS_ELAPSED(metric_histogram_inflate_ns, started);
+        return result;
+    }
+#endif
+
+    z_stream *stream = __inflater_current.reset(deflate_bytes, deflate_bytes_len);
+    if (stream == nullptr) {
+        return std::basic_string<byte>();
+    }
+
+    size_t produced = 0;
+    while (true) {
+        if (produced == result.size()) {
+            result.resize(std::max(result.size() * 2, size_t(64)));
+        }
+        stream->avail_out = result.size() - produced;
+        stream->next_out = const_cast<byte *>(result.data()) + produced;
+        int retval = inflate(stream, Z_FINISH);
+        produced = result.size() - stream->avail_out;
+
+        if (retval == Z_STREAM_END) {
             break;
         }
+        // output full, grow and go on
+        if ((retval == Z_OK || retval == Z_BUF_ERROR) && stream->avail_out == 0) {
+            continue;
+        }
+        // corrupted, or the input ran out
+        break;
+    }
+    result.resize(produced);
 
-        size_t inflated_size = capacity_size - inflated_stream.avail_out;
-        result.insert(result.end(),
-                      inflate_bytes.begin(),
-                      inflate_bytes.begin() + inflated_size);
+    GITFSI_TRACE_ARG(span, "bytes", result.size());
+    GITFSI_METRICS_ADD(metric_counter_inflated_bytes, result.size());
+    GITFSI_METRICS_ELAPSED(metric_histogram_inflate_ns, started);
+    return result;
+}
 
-    } while (inflated_stream.avail_out == 0);
-    inflateEnd(&inflated_stream);
+std::basic_string<byte> __inflate(std::basic_string<byte> &deflate_bytes,
+                                  size_t inflate_bytes_len) {
+    return __inflate(deflate_bytes.data(), deflate_bytes.size(), inflate_bytes_len);
+}
+
+/**
+ * inflate only the leading bytes of a deflate stream. Always zlib, the
+ * stream may be truncated
+ * Args:
+ *      std::basic_string<byte> &deflate_bytes: deflate stream (may be truncated)
+ *      size_t limit: max inflated bytes
+ * Returns:
+ *      at most `limit` inflated bytes
+ */
+std::basic_string<byte> __inflate_prefix(std::basic_string<byte> &deflate_bytes,
+                                         size_t limit) {
+    GITFSI_TRACE_SPAN(span, "inflate");
+    GITFSI_METRICS_START(started);
+    std::basic_string<byte> result(limit, byte(0));
+
+    z_stream *stream = __inflater_current.reset(deflate_bytes.data(), deflate_bytes.size());
+    if (stream == nullptr) {
+        return std::basic_string<byte>();
+    }
+
+    stream->avail_out = limit;
+    stream->next_out = const_cast<byte *>(result.data());
+    int retval = inflate(stream, Z_SYNC_FLUSH);
+
+    switch (retval) {
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+        return std::basic_string<byte>();
+    }
 
+    result.resize(limit - stream->avail_out);
+    GITFSI_TRACE_ARG(span, "bytes", result.size());
+    GITFSI_METRICS_ADD(metric_counter_inflated_bytes, result.size());
+    GITFSI_METRICS_ELAPSED(metric_histogram_inflate_ns, started);
     return result;
 }
 
@@ -0,0 +1,551 @@
+#include "line_diff.h"
+#include "blob.h"
+#include "simd.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace gitter_kid {
+namespace fsi {
+
+// histogram diff falls back to myers when every line repeats more than this
+const size_t __HISTOGRAM_MAX_CHAIN = 64;
+
+/**
+ * split content into lines, newlines are located by a vectorized scan
+ * Args:
+ *      const std::basic_string<byte> &content: content
+ * Returns:
+ *      lines' spans, the last line may have no '\n'
+ */
+std::vector<line_span_s> split_lines(const std::basic_string<byte> &content) {
+    std::vector<line_span_s> lines;
+    size_t begin = 0;
+
+    __for_each_byte(content.data(),
+                    content.data() + content.size(),
+                    byte('\n'),
+                    [&] (size_t off) -> void {
+                        lines.push_back({ begin, off + 1 - begin });
+                        begin = off + 1;
+                    });
+    if (begin < content.size()) {
+        lines.push_back({ begin, content.size() - begin });
+    }
+
+    return lines;
+}
+
+/**
+ * hash a line, 8 bytes are mixed at once
+ */
+inline uint64_t __inl_line_hash(const byte *ptr, size_t len) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, ptr + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < len; i++) {
+        hash = (hash ^ ptr[i]) * 0x100000001B3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+/**
+ * map line to an integer id, equal lines get the same id
+ * Args:
+ *      const byte *ptr: line's begin (must stay alive with the interner)
+ *      size_t len: line's length
+ * Returns:
+ *      line's id
+ */
+uint32_t line_interner::intern(const byte *ptr, size_t len) {
+    uint64_t hash = __inl_line_hash(ptr, len);
+
+    auto range = this->_ids.equal_range(hash);
+    for (auto itr = range.first; itr != range.second; itr++) {
+        __line_s &line = this->_lines[itr->second];
+        if (line.len == len && std::memcmp(line.ptr, ptr, len) == 0) {
+            return itr->second;
+        }
+    }
+
+    uint32_t id = uint32_t(this->_lines.size());
+    this->_lines.push_back({ ptr, len });
+    this->_ids.insert(std::make_pair(hash, id));
+    return id;
+}
+
+std::vector<uint32_t> line_interner::intern(const std::basic_string<byte> &content,
+                                            const std::vector<line_span_s> &lines) {
+    std::vector<uint32_t> ids;
+    ids.reserve(lines.size());
+    for (auto itr = lines.begin(); itr != lines.end(); itr++) {
+        ids.push_back(this->intern(content.data() + itr->off, itr->len));
+    }
+    return ids;
+}
+
+size_t line_interner::size() const {
+    return this->_lines.size();
+}
+
+/**
+ * record a change, adjacent changes are merged
+ */
+inline void __inl_push_change(std::vector<diff_range_s> &changes,
+                              size_t old_begin,
+                              size_t old_end,
+                              size_t new_begin,
+                              size_t new_end) {
+    if (old_begin == old_end && new_begin == new_end) {
+        return;
+    }
+    if (!changes.empty()
+        && changes.back().old_end == old_begin
+        && changes.back().new_end == new_begin) {
+        changes.back().old_end = old_end;
+        changes.back().new_end = new_end;
+        return;
+    }
+    changes.push_back({ old_begin, old_end, new_begin, new_end });
+}
+
+/**
+ * strip common prefix & suffix of a[ao, ae) and b[bo, be)
+ */
+inline void __inl_trim(const uint32_t *a, size_t &ao, size_t &ae,
+                       const uint32_t *b, size_t &bo, size_t &be) {
+    while (ao < ae && bo < be && a[ao] == b[bo]) {
+        ao++;
+        bo++;
+    }
+    while (ao < ae && bo < be && a[ae - 1] == b[be - 1]) {
+        ae--;
+        be--;
+    }
+}
+
+/**
+ * myers' linear space diff, the middle snake splits a[ao, ae) x b[bo, be)
+ * into two smaller problems
+ */
+void __myers(const uint32_t *a, size_t ao, size_t ae,
+             const uint32_t *b, size_t bo, size_t be,
+             std::vector<diff_range_s> &changes) {
+    __inl_trim(a, ao, ae, b, bo, be);
+    if (ao == ae || bo == be) {
+        __inl_push_change(changes, ao, ae, bo, be);
+        return;
+    }
+
+    const uint32_t *x_seq = a + ao;
+    const uint32_t *y_seq = b + bo;
+    ptrdiff_t n = ptrdiff_t(ae - ao);
+    ptrdiff_t m = ptrdiff_t(be - bo);
+    ptrdiff_t max_d = (n + m + 1) / 2;
+    ptrdiff_t v_off = max_d;
+    ptrdiff_t v_len = 2 * max_d + 2;
+    std::vector<ptrdiff_t> vf(v_len, -1);
+    std::vector<ptrdiff_t> vb(v_len, -1);
+    vf[v_off + 1] = 0;
+    vb[v_off + 1] = 0;
+
+    ptrdiff_t delta = n - m;
+    bool front = (delta & 1) != 0;
+    ptrdiff_t kf_start = 0, kf_end = 0, kb_start = 0, kb_end = 0;
+
+    for (ptrdiff_t d = 0; d < max_d; d++) {
+        for (ptrdiff_t k = -d + kf_start; k <= d - kf_end; k += 2) {
+            ptrdiff_t k_off = v_off + k;
+            ptrdiff_t x = (k == -d || (k != d && vf[k_off - 1] < vf[k_off + 1]))
+                ? vf[k_off + 1]
+                : vf[k_off - 1] + 1;
+            ptrdiff_t y = x - k;
+            while (x < n && y < m && x_seq[x] == y_seq[y]) {
+                x++;
+                y++;
+            }
+            vf[k_off] = x;
+
+            if (x > n) {
+                kf_end += 2;
+            }
+            else if (y > m) {
+                kf_start += 2;
+            }
+            else if (front) {
+                ptrdiff_t kb_off = v_off + delta - k;
+                if (kb_off >= 0 && kb_off < v_len && vb[kb_off] != -1 && x >= n - vb[kb_off]) {
+                    __myers(a, ao, ao + x, b, bo, bo + y, changes);
+                    __myers(a, ao + x, ae, b, bo + y, be, changes);
+                    return;
+                }
+            }
+        }
+
+        for (ptrdiff_t k = -d + kb_start; k <= d - kb_end; k += 2) {
+            ptrdiff_t k_off = v_off + k;
+            ptrdiff_t x = (k == -d || (k != d && vb[k_off - 1] < vb[k_off + 1]))
+                ? vb[k_off + 1]
+                : vb[k_off - 1] + 1;
+            ptrdiff_t y = x - k;
+            while (x < n && y < m && x_seq[n - x - 1] == y_seq[m - y - 1]) {
+                x++;
+                y++;
+            }
+            vb[k_off] = x;
+
+            if (x > n) {
+                kb_end += 2;
+            }
+            else if (y > m) {
+                kb_start += 2;
+            }
+            else if (!front) {
+                ptrdiff_t kf_off = v_off + delta - k;
+                if (kf_off >= 0 && kf_off < v_len && vf[kf_off] != -1) {
+                    ptrdiff_t fx = vf[kf_off];
+                    ptrdiff_t fy = v_off + fx - kf_off;
+                    if (fx >= n - x) {
+                        __myers(a, ao, ao + fx, b, bo, bo + fy, changes);
+                        __myers(a, ao + fx, ae, b, bo + fy, be, changes);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    __inl_push_change(changes, ao, ae, bo, be);
+}
+
+/**
+ * histogram diff, the longest common run made of the least frequent
+ * lines anchors the region and both sides around it are diffed again
+ */
+void __histogram(const uint32_t *a, size_t ao, size_t ae,
+                 const uint32_t *b, size_t bo, size_t be,
+                 std::vector<diff_range_s> &changes) {
+    __inl_trim(a, ao, ae, b, bo, be);
+    if (ao == ae || bo == be) {
+        __inl_push_change(changes, ao, ae, bo, be);
+        return;
+    }
+
+    std::unordered_map<uint32_t, std::vector<size_t>> occurrences;
+    for (size_t i = ao; i < ae; i++) {
+        occurrences[a[i]].push_back(i);
+    }
+
+    bool has_common = false;
+    size_t best_count = __HISTOGRAM_MAX_CHAIN + 1;
+    size_t best_ao = 0, best_ae = 0, best_bo = 0, best_be = 0;
+
+    for (size_t bi = bo; bi < be; ) {
+        auto find_result = occurrences.find(b[bi]);
+        if (find_result == occurrences.end()) {
+            bi++;
+            continue;
+        }
+        has_common = true;
+
+        std::vector<size_t> &positions = find_result->second;
+        if (positions.size() > best_count) {
+            bi++;
+            continue;
+        }
+
+        size_t next_bi = bi + 1;
+        for (auto itr = positions.begin(); itr != positions.end(); itr++) {
+            size_t s_a = *itr, s_b = bi, e_a = *itr + 1, e_b = bi + 1;
+            size_t count = positions.size();
+
+            while (s_a > ao && s_b > bo && a[s_a - 1] == b[s_b - 1]) {
+                s_a--;
+                s_b--;
+                count = std::min(count, occurrences[a[s_a]].size());
+            }
+            while (e_a < ae && e_b < be && a[e_a] == b[e_b]) {
+                count = std::min(count, occurrences[a[e_a]].size());
+                e_a++;
+                e_b++;
+            }
+
+            next_bi = std::max(next_bi, e_b);
+            if (e_b - s_b > best_be - best_bo || count < best_count) {
+                best_count = count;
+                best_ao = s_a;
+                best_ae = e_a;
+                best_bo = s_b;
+                best_be = e_b;
+            }
+        }
+        bi = next_bi;
+    }
+
+    if (best_count > __HISTOGRAM_MAX_CHAIN) {
+        if (has_common) {
+            __myers(a, ao, ae, b, bo, be, changes);
+        }
+        else {
+            __inl_push_change(changes, ao, ae, bo, be);
+        }
+        return;
+    }
+
+    __histogram(a, ao, best_ao, b, bo, best_bo, changes);
+    __histogram(a, best_ae, ae, b, best_be, be, changes);
+}
+
+/**
+ * diff two integer sequences
+ * Args:
+ *      const std::vector<uint32_t> &a: old sequence
+ *      const std::vector<uint32_t> &b: new sequence
+ *      diff_algorithm algorithm: myers or histogram
+ * Returns:
+ *      changes, ordered
+ */
+std::vector<diff_range_s> diff_sequences(const std::vector<uint32_t> &a,
+                                         const std::vector<uint32_t> &b,
+                                         diff_algorithm algorithm) {
+    std::vector<diff_range_s> changes;
+    if (algorithm == diff_algorithm::diff_algorithm_histogram) {
+        __histogram(a.data(), 0, a.size(), b.data(), 0, b.size(), changes);
+    }
+    else {
+        __myers(a.data(), 0, a.size(), b.data(), 0, b.size(), changes);
+    }
+    return changes;
+}
+
+diff_line::diff_line(diff_line_type type,
+                     size_t old_no,
+                     size_t new_no,
+                     const byte *begin,
+                     size_t len)
+    : _type(type)
+    , _old_no(old_no)
+    , _new_no(new_no)
+    , _begin(begin)
+    , _len(len) {}
+
+diff_line_type &diff_line::type() {
+    return this->_type;
+}
+
+size_t &diff_line::old_no() {
+    return this->_old_no;
+}
+
+size_t &diff_line::new_no() {
+    return this->_new_no;
+}
+
+std::string diff_line::content() const {
+    return std::string(this->_begin, this->_begin + this->_len);
+}
+
+bool diff_line::eol() const {
+    return this->_len != 0 && this->_begin[this->_len - 1] == '\n';
+}
+
+diff_hunk::diff_hunk()
+    : _old_start(0)
+    , _old_count(0)
+    , _new_start(0)
+    , _new_count(0) {}
+
+size_t &diff_hunk::old_start() {
+    return this->_old_start;
+}
+
+size_t &diff_hunk::old_count() {
+    return this->_old_count;
+}
+
+size_t &diff_hunk::new_start() {
+    return this->_new_start;
+}
+
+size_t &diff_hunk::new_count() {
+    return this->_new_count;
+}
+
+std::vector<diff_line> &diff_hunk::lines() {
+    return this->_lines;
+}
+
+std::string diff_hunk::header() const {
+    std::stringstream header_builder;
+    header_builder << "@@ -" << this->_old_start;
+    if (this->_old_count != 1) {
+        header_builder << ',' << this->_old_count;
+    }
+    header_builder << " +" << this->_new_start;
+    if (this->_new_count != 1) {
+        header_builder << ',' << this->_new_count;
+    }
+    header_builder << " @@";
+    return header_builder.str();
+}
+
+line_diff::line_diff()
+    : _algorithm(diff_algorithm::diff_algorithm_myers)
+    , _context(3)
+    , _old_binary(false)
+    , _new_binary(false)
+    , _binary(false) {}
+
+diff_algorithm &line_diff::algorithm() {
+    return this->_algorithm;
+}
+
+size_t &line_diff::context() {
+    return this->_context;
+}
+
+bool &line_diff::old_binary() {
+    return this->_old_binary;
+}
+
+bool &line_diff::new_binary() {
+    return this->_new_binary;
+}
+
+bool line_diff::binary() const {
+    return this->_binary;
+}
+
+std::vector<diff_hunk> &line_diff::hunks() {
+    return this->_hunks;
+}
+
+inline bool __inl_sniff_binary(const std::basic_string<byte> &content) {
+    return classify_content(content.data(), content.data() + content.size())
+        == blob_class::blob_class_binary;
+}
+
+/**
+ * diff two contents into unified hunks, hunks' lines point into both
+ * contents, so they must outlive the hunks
+ * Args:
+ *      const std::basic_string<byte> &old_content: old content
+ *      const std::basic_string<byte> &new_content: new content
+ * Returns:
+ *      hunks, empty when contents are equal or either side is binary
+ */
+std::vector<diff_hunk> &line_diff::diff(const std::basic_string<byte> &old_content,
+                                        const std::basic_string<byte> &new_content) {
+    this->_hunks.clear();
+    this->_binary = this->_old_binary
+        || this->_new_binary
+        || __inl_sniff_binary(old_content)
+        || __inl_sniff_binary(new_content);
+    if (this->_binary) {
+        return this->_hunks;
+    }
+
+    std::vector<line_span_s> old_lines = split_lines(old_content);
+    std::vector<line_span_s> new_lines = split_lines(new_content);
+
+    line_interner interner;
+    std::vector<uint32_t> a = interner.intern(old_content, old_lines);
+    std::vector<uint32_t> b = interner.intern(new_content, new_lines);
+
+    std::vector<diff_range_s> changes = diff_sequences(a, b, this->_algorithm);
+
+    auto emit = [&] (diff_hunk &hunk, diff_line_type type, size_t o, size_t n) -> void {
+        const line_span_s &span = type == diff_line_type::diff_line_added ? new_lines[n] : old_lines[o];
+        const byte *base = type == diff_line_type::diff_line_added ? new_content.data() : old_content.data();
+        hunk.lines().push_back(diff_line(type,
+                                         type == diff_line_type::diff_line_added ? 0 : o + 1,
+                                         type == diff_line_type::diff_line_deleted ? 0 : n + 1,
+                                         base + span.off,
+                                         span.len));
+    };
+
+    for (size_t i = 0; i < changes.size(); ) {
+        size_t j = i;
+        while (j + 1 < changes.size()
+               && changes[j + 1].old_begin - changes[j].old_end <= 2 * this->_context) {
+            j++;
+        }
+
+        size_t old_begin = changes[i].old_begin - std::min(changes[i].old_begin, this->_context);
+        size_t new_begin = changes[i].new_begin - (changes[i].old_begin - old_begin);
+        size_t old_end = std::min(changes[j].old_end + this->_context, old_lines.size());
+        size_t new_end = changes[j].new_end + (old_end - changes[j].old_end);
+
+        this->_hunks.push_back(diff_hunk());
+        diff_hunk &hunk = this->_hunks.back();
+        hunk.old_count() = old_end - old_begin;
+        hunk.new_count() = new_end - new_begin;
+        hunk.old_start() = hunk.old_count() == 0 ? old_begin : old_begin + 1;
+        hunk.new_start() = hunk.new_count() == 0 ? new_begin : new_begin + 1;
+
+        size_t o = old_begin;
+        size_t n = new_begin;
+        for (size_t c = i; c <= j; c++) {
+            for (; o < changes[c].old_begin; o++, n++) {
+                emit(hunk, diff_line_type::diff_line_context, o, n);
+            }
+            for (; o < changes[c].old_end; o++) {
+                emit(hunk, diff_line_type::diff_line_deleted, o, 0);
+            }
+            for (; n < changes[c].new_end; n++) {
+                emit(hunk, diff_line_type::diff_line_added, 0, n);
+            }
+        }
+        for (; o < old_end; o++, n++) {
+            emit(hunk, diff_line_type::diff_line_context, o, n);
+        }
+
+        i = j + 1;
+    }
+
+    return this->_hunks;
+}
+
+/**
+ * render hunks in unified diff format
+ * Returns:
+ *      unified diff text (without file headers)
+ */
+std::string line_diff::unified() {
+    if (this->_binary) {
+        return std::string("Binary files differ\n");
+    }
+
+    std::string result;
+    for (auto hunk = this->_hunks.begin(); hunk != this->_hunks.end(); hunk++) {
+        result.append(hunk->header());
+        result.push_back('\n');
+
+        for (auto line = hunk->lines().begin(); line != hunk->lines().end(); line++) {
+            switch (line->type()) {
+            case diff_line_type::diff_line_context:
+                result.push_back(' ');
+                break;
+            case diff_line_type::diff_line_deleted:
+                result.push_back('-');
+                break;
+            case diff_line_type::diff_line_added:
+                result.push_back('+');
+                break;
+            }
+            result.append(line->content());
+            if (!line->eol()) {
+                result.append("\n\\ No newline at end of file\n");
+            }
+        }
+    }
+    return result;
+}
+
+}
+}
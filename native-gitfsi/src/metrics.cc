@@ -0,0 +1,188 @@
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+namespace gitter_kid {
+namespace fsi {
+
+struct __metrics_block_s {
+    std::atomic<uint64_t> counters[metric_counter_count];
+    std::atomic<uint64_t> buckets[metric_histogram_count][METRICS_BUCKETS];
+    std::atomic<uint64_t> sums[metric_histogram_count];
+};
+
+struct __metrics_registry_s {
+    std::mutex mutex;
+    std::set<__metrics_block_s *> blocks;
+    // totals of exited threads
+    metrics_snapshot retired;
+};
+
+/**
+ * registry is never freed, threads may exit after static destruction
+ */
+__metrics_registry_s &__metrics_registry() {
+    static __metrics_registry_s *registry = new __metrics_registry_s();
+    return *registry;
+}
+
+/**
+ * add a block's values into a snapshot
+ */
+void __metrics_collect(__metrics_block_s &block, metrics_snapshot &snapshot) {
+    for (size_t i = 0; i < metric_counter_count; i++) {
+        snapshot.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < metric_histogram_count; i++) {
+        for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+            uint64_t count = block.buckets[i][j].load(std::memory_order_relaxed);
+            snapshot.histograms[i].buckets[j] += count;
+            snapshot.histograms[i].count += count;
+        }
+        snapshot.histograms[i].sum += block.sums[i].load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * current thread's block, registered on first use and folded into the
+ * retired totals when the thread exits
+ */
+class __metrics_thread {
+private:
+    __metrics_block_s *_block;
+public:
+    __metrics_thread() : _block(new __metrics_block_s()) {
+        __metrics_registry_s &registry = __metrics_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.blocks.insert(this->_block);
+    }
+
+    ~__metrics_thread() {
+        __metrics_registry_s &registry = __metrics_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        __metrics_collect(*this->_block, registry.retired);
+        registry.blocks.erase(this->_block);
+        delete this->_block;
+    }
+
+    __metrics_block_s &block() {
+        return *this->_block;
+    }
+};
+
+thread_local __metrics_thread __metrics_current;
+
+/**
+ * only the owning thread writes a block, a plain load and store is enough
+ */
+inline void __inl_metrics_bump(std::atomic<uint64_t> &value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void metrics::add(metric_counter counter, uint64_t value) {
+    __inl_metrics_bump(__metrics_current.block().counters[counter], value);
+}
+
+void metrics::observe(metric_histogram histogram, uint64_t value) {
+    size_t bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    __metrics_block_s &block = __metrics_current.block();
+    __inl_metrics_bump(block.buckets[histogram][bucket], 1);
+    __inl_metrics_bump(block.sums[histogram], value);
+}
+
+/**
+ * monotonic clock in nanoseconds
+ */
+uint64_t metrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+metrics_snapshot metrics::snapshot() {
+    __metrics_registry_s &registry = __metrics_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    metrics_snapshot result = registry.retired;
+    for (auto itr = registry.blocks.begin(); itr != registry.blocks.end(); itr++) {
+        __metrics_collect(**itr, result);
+    }
+    return result;
+}
+
+struct __metrics_desc_s {
+    const char *name;
+    const char *help;
+    // multiplier from recorded unit to exported unit
+    double scale;
+};
+
+const __metrics_desc_s __METRICS_COUNTERS[metric_counter_count] = {
+    { "gitfsi_lookups_loose_total", "Objects found loose.", 1 },
+    { "gitfsi_lookups_packed_total", "Objects found in a pack.", 1 },
+    { "gitfsi_lookups_missing_total", "Objects not found.", 1 },
+    { "gitfsi_inflated_bytes_total", "Bytes produced by inflating.", 1 },
+    { "gitfsi_delta_bases_hits_total", "Delta bases reused within a batch read.", 1 },
+    { "gitfsi_delta_bases_misses_total", "Delta bases resolved within a batch read.", 1 },
+    { "gitfsi_loose_dirs_hits_total", "Loose lookups answered by a cached directory listing.", 1 },
+    { "gitfsi_loose_dirs_misses_total", "Loose object directories (re)read.", 1 },
+    { "gitfsi_blob_classes_hits_total", "Blob classifications answered from cache.", 1 },
+    { "gitfsi_blob_classes_misses_total", "Blob classifications computed.", 1 },
+    { "gitfsi_pool_hits_total", "Repositories found in the pool.", 1 },
+    { "gitfsi_pool_misses_total", "Repositories opened by the pool.", 1 },
+    { "gitfsi_pack_opens_total", "Pack indexes loaded.", 1 },
+    { "gitfsi_verify_failures_total", "Objects whose content didn't match their id.", 1 }
+};
+
+const __metrics_desc_s __METRICS_HISTOGRAMS[metric_histogram_count] = {
+    { "gitfsi_get_seconds", "Object read latency.", 1e-9 },
+    { "gitfsi_inflate_seconds", "Time spent inflating one stream.", 1e-9 },
+    { "gitfsi_index_load_seconds", "Time spent loading one pack index.", 1e-9 },
+    { "gitfsi_delta_depth", "Deltas applied to read one packed object.", 1 }
+};
+
+/**
+ * current values in Prometheus' text exposition format
+ */
+std::string metrics::prometheus() {
+    metrics_snapshot current = metrics::snapshot();
+    std::ostringstream out;
+    out.precision(12);
+
+    for (size_t i = 0; i < metric_counter_count; i++) {
+        out << "# HELP " << __METRICS_COUNTERS[i].name << " " << __METRICS_COUNTERS[i].help << "\n"
+            << "# TYPE " << __METRICS_COUNTERS[i].name << " counter\n"
+            << __METRICS_COUNTERS[i].name << " " << current.counters[i] << "\n";
+    }
+
+    for (size_t i = 0; i < metric_histogram_count; i++) {
+        const __metrics_desc_s &desc = __METRICS_HISTOGRAMS[i];
+        metrics_histogram &histogram = current.histograms[i];
+        out << "# HELP " << desc.name << " " << desc.help << "\n"
+            << "# TYPE " << desc.name << " histogram\n";
+
+        // buckets are cumulative, empty ones past the last value are left out
+        size_t last = 0;
+        for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+            if (histogram.buckets[j] != 0) {
+                last = j;
+            }
+        }
+        uint64_t cumulative = 0;
+        for (size_t j = 0; j <= last && j < METRICS_BUCKETS - 1; j++) {
+            cumulative += histogram.buckets[j];
+            double upper = j == 0 ? 0 : double((uint64_t(1) << j) - 1);
+            out << desc.name << "_bucket{le=\"" << upper * desc.scale << "\"} " << cumulative << "\n";
+        }
+        out << desc.name << "_bucket{le=\"+Inf\"} " << histogram.count << "\n"
+            << desc.name << "_sum " << double(histogram.sum) * desc.scale << "\n"
+            << desc.name << "_count " << histogram.count << "\n";
+    }
+    return out.str();
+}
+
+}
+}
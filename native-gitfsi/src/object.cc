@@ -1,108 +1,135 @@
 #include "object.h"
-#include "blob.h"
-#include "tree.h"
-#include "commit.h"
 #include <algorithm>
+#include <new>
+#include <utility>
 
 namespace gitter_kid {
 namespace fsi {
 
 object::object()
-    : _body_buffer(nullptr)
-    , _body(nullptr)
-    , _type(obj_type::obj_type_unknow) {}
+    : _type(obj_type::obj_type_unknow) {}
 
-object::object(std::basic_string<byte> &buffer)
-    : _body_buffer(nullptr)
-    , _body(nullptr)
-    , _type(obj_type::obj_type_unknow) {
+object::object(std::basic_string<byte> &buffer, size_t sign_len)
+    : object(std::basic_string<byte>(buffer), sign_len) {}
+
+/**
+ * build object from "<type> <size>\0<content>", blob's content takes
+ * over the buffer. sign_len is the width of ids in trees
+ */
+object::object(std::basic_string<byte> &&buffer, size_t sign_len)
+    : _type(obj_type::obj_type_unknow) {
 
-    this->_type = obj_type::obj_type_unknow;
     if (buffer.empty()) { return; }
 
     std::basic_string<byte>::iterator spliter = std::find(buffer.begin(),
                                                           buffer.end(),
                                                           byte(0));
 
-    this->_body = nullptr;
-    switch (this->analysis_type(buffer, spliter)) {
+    obj_type type = this->analysis_type(buffer, spliter);
+    if (type == obj_type::obj_type_unknow) { return; }
+
+    this->__construct(std::move(buffer), spliter + 1 - buffer.begin(), type, sign_len);
+}
+
+object::object(std::basic_string<byte> &buffer, obj_type type, size_t sign_len)
+    : object(std::basic_string<byte>(buffer), type, sign_len) {}
+
+/**
+ * build object from content, blob's content takes over the buffer
+ */
+object::object(std::basic_string<byte> &&buffer, obj_type type, size_t sign_len)
+    : _type(obj_type::obj_type_unknow) {
+    this->__construct(std::move(buffer), 0, type, sign_len);
+}
+
+object::object(object &&other)
+    : _type(obj_type::obj_type_unknow) {
+    this->__move(other);
+}
+
+object::~object() {
+    this->__destroy();
+}
+
+object &object::operator=(object &&other) {
+    if (this != &other) {
+        this->__destroy();
+        this->__move(other);
+    }
+    return *this;
+}
+
+/**
+ * construct body in place
+ * Args:
+ *      std::basic_string<byte> &&buffer: buffer
+ *      size_t off: content's offset in buffer
+ *      obj_type type: object's type
+ *      size_t sign_len: width of ids in trees
+ */
+void object::__construct(std::basic_string<byte> &&buffer, size_t off, obj_type type, size_t sign_len) {
+    switch (type) {
     case obj_type::obj_type_blob:
-            this->_body_buffer = new std::basic_string<byte>(spliter + 1,
-                                                             buffer.end());
-            this->_body =
-                new blob(*reinterpret_cast<std::basic_string<byte> *>(this->_body_buffer));
-            this->_type = obj_type::obj_type_blob;
-            break;
+        buffer.erase(0, off);
+        new (&this->_blob) blob(std::move(buffer));
+        break;
     case obj_type::obj_type_tree:
-            this->_body_buffer = new std::vector<tree_item>();
-            this->_body =
-                new tree(*reinterpret_cast<std::vector<tree_item> *>(this->_body_buffer),
-                         spliter + 1,
-                         buffer.end());
-            this->_type = obj_type::obj_type_tree;
-            break;
+        new (&this->_tree) tree(buffer.begin() + off, buffer.end(), sign_len);
+        break;
     case obj_type::obj_type_commit:
-            this->_body_buffer = new commit_body();
-            this->_body =
-                new commit(*reinterpret_cast<commit_body *>(this->_body_buffer),
-                           spliter + 1,
-                           buffer.end());
-            this->_type = obj_type::obj_type_commit;
-            break;
+        new (&this->_commit) commit(buffer.begin() + off, buffer.end());
+        break;
+    case obj_type::obj_type_tag:
+        new (&this->_tag) tag(buffer.begin() + off, buffer.end());
+        break;
     default:
-            break;
+        return;
     }
+    this->_type = type;
 }
 
-object::object(std::basic_string<byte> &buffer, obj_type type)
-    : _body_buffer(nullptr)
-    , _body(nullptr) 
-    , _type(type) {
-
-    switch (this->_type) {
+/**
+ * take over other's body, other becomes an unknow object
+ */
+void object::__move(object &other) {
+    switch (other._type) {
     case obj_type::obj_type_blob:
-        this->_body_buffer = new std::basic_string<byte>(buffer.begin(),
-                                                         buffer.end());
-        this->_body = new blob(*reinterpret_cast<std::basic_string<byte> *>(this->_body_buffer));
+        new (&this->_blob) blob(std::move(other._blob));
         break;
     case obj_type::obj_type_tree:
-        this->_body_buffer = new std::vector<tree_item>();
-        this->_body =
-            new tree(*reinterpret_cast<std::vector<tree_item> *>(this->_body_buffer),
-                     buffer.begin(),
-                     buffer.end());
+        new (&this->_tree) tree(std::move(other._tree));
         break;
     case obj_type::obj_type_commit:
-        this->_body_buffer = new commit_body();
-        this->_body = new commit(*reinterpret_cast<commit_body *>(this->_body_buffer),
-                                 buffer.begin(),
-                                 buffer.end());
+        new (&this->_commit) commit(std::move(other._commit));
+        break;
+    case obj_type::obj_type_tag:
+        new (&this->_tag) tag(std::move(other._tag));
         break;
     default:
         return;
     }
+    this->_type = other._type;
+    other.__destroy();
 }
 
-object::~object() {
-    if (this->_body != nullptr) {
-        delete this->_body;
-    }
-
-    if (this->_body_buffer != nullptr) {
-        switch (this->_type) {
-        case obj_type::obj_type_blob:
-            delete reinterpret_cast<std::basic_string<byte> *>(this->_body_buffer);
-            break;
-        case obj_type::obj_type_commit:
-            delete reinterpret_cast<commit_body *>(this->_body_buffer);
-            break;
-        case obj_type::obj_type_tree:
-            delete reinterpret_cast<std::vector<tree_item> *>(this->_body_buffer);
-            break;
-        default:
-            break;
-        }
+void object::__destroy() {
+    switch (this->_type) {
+    case obj_type::obj_type_blob:
+        this->_blob.~blob();
+        break;
+    case obj_type::obj_type_tree:
+        this->_tree.~tree();
+        break;
+    case obj_type::obj_type_commit:
+        this->_commit.~commit();
+        break;
+    case obj_type::obj_type_tag:
+        this->_tag.~tag();
+        break;
+    default:
+        break;
     }
+    this->_type = obj_type::obj_type_unknow;
 }
 
 obj_type object::type() const {
@@ -111,39 +138,32 @@ obj_type object::type() const {
 
 obj_type object::analysis_type(std::basic_string<byte> &store,
                                std::basic_string<byte>::iterator &spliter) {
-    if (this->_type != obj_type::obj_type_unknow) {
-        return this->_type;
-    }
-
     if (store.empty()) {
-        return this->_type;
+        return obj_type::obj_type_unknow;
     }
     if (spliter == store.end()) {
-        return this->_type;
+        return obj_type::obj_type_unknow;
     }
 
     std::basic_string<byte>::iterator space_iter = std::find(store.begin(),
                                                              spliter,
                                                              byte(' '));
-    if (spliter == store.end()){
-        return this->_type;
-    }
-
-
-    std::string content_size(space_iter + 1, spliter);
     std::string type(store.begin(), space_iter);
 
     if (type.compare("blob") == 0) {
-        this->_type = obj_type::obj_type_blob;
+        return obj_type::obj_type_blob;
     }
     else if (type.compare("commit") == 0) {
-        this->_type = obj_type::obj_type_commit;
+        return obj_type::obj_type_commit;
     }
     else if (type.compare("tree") == 0) {
-        this->_type = obj_type::obj_type_tree;
+        return obj_type::obj_type_tree;
+    }
+    else if (type.compare("tag") == 0) {
+        return obj_type::obj_type_tag;
     }
 
-    return this->_type;
+    return obj_type::obj_type_unknow;
 }
 
 }
@@ -1,6 +1,10 @@
 #include "pack.h"
 #include "inflate.h"
 #include "commit.h"
+#include "metrics.h"
+#include "trace.h"
+#include "sha1.h"
+#include "parallel.h"
 #include <sstream>
 #include <algorithm>
 #include <arpa/inet.h>
@@ -10,29 +14,53 @@
 namespace gitter_kid {
 namespace fsi {
 
-pack::pack(std::string repo_path, std::string sign) {
+// resolved delta bases kept by a batch read are dropped beyond this
+const size_t __PACK_BATCH_BASES_MAX = 64 * 1024 * 1024;
+
+// items closer than this are read ahead as one range
+const size_t __PACK_READAHEAD_GAP = 64 * 1024;
+
+// headers of a whole-pack scan are read this many bytes at a time
+const size_t __PACK_SCAN_WINDOW = 256 * 1024;
+
+// compressed bytes usually enough to inflate a delta's two sizes
+const size_t __PACK_DELTA_PREFIX_LEN = 256;
+
+// longest delta chain followed (git's own limit), a longer one is taken
+// for a cycle
+const size_t __PACK_DELTA_DEPTH_MAX = 4095;
+
+pack::pack(std::string repo_path, std::string sign, size_t sign_len)
+    : _pack_fd(-1)
+    , _sign_len(sign_len) {
     std::stringstream path_builder;
 
     // build index file (.idx) path
-    this->_idx_path.resize(repo_path.size() + 63, 0);
+    this->_idx_path.resize(repo_path.size() + 23 + sign.size(), 0);
     path_builder.rdbuf()->pubsetbuf(const_cast<char *>(this->_idx_path.data()),
                                     this->_idx_path.size());
 
     path_builder.write(repo_path.data(), repo_path.size());
     path_builder.write("/objects/pack/pack-", 19);
-    path_builder.write(sign.data(), 40);
+    path_builder.write(sign.data(), sign.size());
     path_builder.write(".idx", 4);
 
     // build pack file (.pack) path
-    this->_pack_path.resize(repo_path.size() + 64, 0);
+    this->_pack_path.resize(repo_path.size() + 24 + sign.size(), 0);
     path_builder.rdbuf()->pubsetbuf(const_cast<char *>(this->_pack_path.data()),
                                     this->_pack_path.size());
     path_builder.write(repo_path.data(), repo_path.size());
     path_builder.write("/objects/pack/pack-", 19);
-    path_builder.write(sign.data(), 40);
+    path_builder.write(sign.data(), sign.size());
     path_builder.write(".pack", 5);
 }
 
+pack::~pack() {
+    if (this->_pack_fd != -1) {
+        close(this->_pack_fd);
+    }
+}
+
 std::string &pack::idx_path() {
     return this->_idx_path;
 }
@@ -41,6 +69,10 @@ std::string &pack::pack_path() {
     return this->_pack_path;
 }
 
+size_t pack::sign_len() const {
+    return this->_sign_len;
+}
+
 /**
  * Get packet's items count
  * Args:
@@ -67,16 +99,16 @@ uint32_t pack::__count(std::ifstream &idx_file) {
 }
 
 /**
- * Get packet's nth item offset
+ * Get packet's nth item offset (after the ids and their CRCs)
  * Args:
  *      std::ifstream &idx_file: index file stream (input)
  *      uint32_t items_count: items count
  *      uint32_t nth: nth item
  */
-inline uint32_t __inl_nth_off(std::ifstream &idx_file,
-                          uint32_t items_count,
-                          uint32_t nth) {
-    idx_file.seekg(8 + 1024 + 24 * items_count + 4 * nth, std::ios::beg);
+template<size_t _T_Sign_Len> inline uint32_t __inl_nth_off(std::ifstream &idx_file,
+                                                           uint32_t items_count,
+                                                           uint32_t nth) {
+    idx_file.seekg(8 + 1024 + (_T_Sign_Len + 4) * items_count + 4 * nth, std::ios::beg);
     uint32_t result;
     idx_file.read(reinterpret_cast<char *>(&result), 4);
 
@@ -90,14 +122,31 @@ inline uint32_t __inl_nth_off(std::ifstream &idx_file,
  *      uint32_t nth: nth index
  *      std::ifstream &idx_file: pack index file
  */
-inline void __inl_assign_nth_sign(sign_t &sign,
-                                  uint32_t nth,
-                                  std::ifstream &idx_file) {
-    idx_file.seekg(8 + 1024 + 20 * nth, std::ios::beg);
-    std::basic_string<byte> bytes_sign(20, 0);
-    idx_file.read(reinterpret_cast<char *>(const_cast<byte *>(bytes_sign.data())), 20);
+template<size_t _T_Sign_Len> inline void __inl_assign_nth_sign(sign_t &sign,
+                                                                uint32_t nth,
+                                                                std::ifstream &idx_file) {
+    idx_file.seekg(8 + 1024 + _T_Sign_Len * nth, std::ios::beg);
+    byte bytes_sign[_T_Sign_Len];
+    idx_file.read(reinterpret_cast<char *>(bytes_sign), _T_Sign_Len);
+
+    sign.bytes_assign(bytes_sign, bytes_sign + _T_Sign_Len);
+}
 
-    sign.bytes_assign(bytes_sign.begin(), bytes_sign.end());
+/**
+ * read every item's offset and id
+ * Args:
+ *      std::ifstream &idx_file: index file stream (input)
+ *      std::vector<__pack_idx_s> &indexes: items, sized to items count
+ */
+template<size_t _T_Sign_Len> void __pack_read_indexes(std::ifstream &idx_file,
+                                                     std::vector<__pack_idx_s> &indexes) {
+    uint32_t items_count = indexes.size();
+    for (uint32_t i = 0; i < items_count; i++) {
+        indexes[i].nth = i;
+        indexes[i].off = __inl_nth_off<_T_Sign_Len>(idx_file, items_count, i);
+        indexes[i].len = 0;
+        __inl_assign_nth_sign<_T_Sign_Len>(indexes[i].sign, i, idx_file);
+    }
 }
 
 /**
@@ -112,11 +161,14 @@ void pack::__sorted_indexes(std::ifstream &idx_file,
                        size_t pack_size) {
 
     this->_indexes.resize(items_count);
-    for (uint32_t i = 0; i < items_count; i++) {
-        this->_indexes[i].nth = i;
-        this->_indexes[i].off = __inl_nth_off(idx_file, items_count, i);
-        this->_indexes[i].len = 0;
-        __inl_assign_nth_sign(this->_indexes[i].sign, i, idx_file);
+    if (items_count == 0) {
+        return;
+    }
+    if (this->_sign_len == SIGN_SHA256_LEN) {
+        __pack_read_indexes<SIGN_SHA256_LEN>(idx_file, this->_indexes);
+    }
+    else {
+        __pack_read_indexes<SIGN_SHA1_LEN>(idx_file, this->_indexes);
     }
 
     std::sort(this->_indexes.begin(),
@@ -127,7 +179,8 @@ void pack::__sorted_indexes(std::ifstream &idx_file,
 
               });
 
-    this->_indexes.back().len = pack_size - 20 - this->_indexes.back().off;
+    // the pack ends with its checksum
+    this->_indexes.back().len = pack_size - this->_sign_len - this->_indexes.back().off;
     for (uint32_t i = 0; i < items_count - 1; i++) {
         this->_indexes[i].len = this->_indexes[i + 1].off - this->_indexes[i].off;
     }
@@ -159,17 +212,40 @@ size_t pack::__pack_size() const {
     return st.st_size;
 }
 
+#ifdef GITFSI_METRICS
+// deltas applied by the current __resolve call
+thread_local size_t __metrics_delta_depth = 0;
+#endif
+
 /**
- * initialize this pack's index
+ * initialize this pack's index and open the pack
+ * Returns:
+ *      false if the idx can't be read or the pack can't be opened (e.g.
+ *      removed by a repack since the directory was scanned)
  */
-void pack::idx_init() {
+bool pack::idx_init() {
+    GITFSI_METRICS_START(started);
     // read idx file
     std::ifstream idx_file(this->_idx_path, std::ios::binary);
+    if (!idx_file.is_open()) {
+        return false;
+    }
     // calculate items count
     uint32_t items_count = this->__count(idx_file);
     // build sorted vector & rd-tree (pack's index)
     this->__sorted_indexes(idx_file, items_count, this->__pack_size());
+    if (idx_file.fail()) {
+        return false;
+    }
     this->__build_rdtree_indexes();
+
+    if (this->_pack_fd == -1) {
+        this->_pack_fd = open(this->_pack_path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    GITFSI_METRICS_ADD(metric_counter_pack_opens, 1);
+    GITFSI_METRICS_ELAPSED(metric_histogram_index_load_ns, started);
+    return this->_pack_fd != -1;
 }
 
 /**
@@ -187,16 +263,47 @@ std::vector<__pack_idx_s> &pack::off_index() {
     return this->_indexes;
 }
 
-__pack_segment_s pack::__get_segment(std::ifstream &pack_file, size_t off, size_t len) {
-    pack_file.seekg(off, std::ios::beg);
+/**
+ * estimate memory held by this pack's indexes
+ */
+size_t pack::memory_usage() const {
+    // an id's bytes live in their own small heap block, a map node carries
+    // three pointers and a color besides its value
+    const size_t sign_heap = 32;
+    const size_t node_overhead = 32;
+
+    return this->_indexes.capacity() * (sizeof(__pack_idx_s) + sign_heap)
+        + this->_sign_indexes.size() * (node_overhead
+                                        + sizeof(std::pair<const sign_t, __pack_idx_s>)
+                                        + 2 * sign_heap);
+}
 
-    uint8_t p_byte = pack_file.get();
+/**
+ * read an item's header and `len` bytes following it, positional reads
+ * leave the pack's descriptor shareable between threads
+ * Args:
+ *      size_t off: item's offset
+ *      size_t len: bytes to read (0 for an estimate from the item's size)
+ * Returns:
+ *      segment, empty buf if reading failed
+ */
+__pack_segment_s pack::__get_segment(size_t off, size_t len) {
+    GITFSI_TRACE_SPAN(span, "pack.read");
+    GITFSI_TRACE_ARG(span, "off", off);
+    byte header[16];
+    ssize_t header_len = pread(this->_pack_fd, header, sizeof(header), off);
+    if (header_len <= 0) {
+        return { std::basic_string<byte>(), 0, 0, off };
+    }
+
+    ssize_t pos = 0;
+    uint8_t p_byte = header[pos++];
     uint8_t type = (p_byte >> 4) & 0x07;
 
     uint32_t size = p_byte & 0x0F;
     uint32_t shift = 4;
-    while (p_byte & 0x80) {
-        p_byte = pack_file.get();
+    while ((p_byte & 0x80) && pos < header_len) {
+        p_byte = header[pos++];
         size += (uint32_t(p_byte & 0x7F)) << shift;
         shift += 7;
     }
@@ -206,42 +313,72 @@ __pack_segment_s pack::__get_segment(std::ifstream &pack_file, size_t off, size_
     }
 
     std::basic_string<byte> buf(len, 0);
-    pack_file.read(reinterpret_cast<char *>(const_cast<byte *>(buf.data())), buf.size());
+    ssize_t nread = pread(this->_pack_fd,
+                          const_cast<byte *>(buf.data()),
+                          buf.size(),
+                          off + pos);
+    buf.resize(nread > 0 ? nread : 0);
+    GITFSI_TRACE_ARG(span, "bytes", buf.size());
 
     return { buf, type, size, off };
 }
 
 
 size_t pack::__indexes_findlen(pack &_pack, size_t off) {
-    int i = 0;
-    int j = _pack._indexes.size();
+    size_t i = 0;
+    size_t j = _pack._indexes.size();
     while (i < j) {
-        int mid = (i + j) / 2;
+        size_t mid = (i + j) / 2;
         if (off < _pack._indexes[mid].off) {
-            j = mid - 1;
+            j = mid;
         }
         else if (off > _pack._indexes[mid].off) {
             i = mid + 1;
         }
         else {
-            return _indexes[mid].len;
+            return _pack._indexes[mid].len;
         }
     }
     return 0;
 }
 
 
-__pack_item_s pack::__ofsdelta_patch(std::vector<pack> &pack_collection,
-                                    pack &_pack,
-                                    const __pack_item_s &packitem) {
-    std::ifstream packfile(_pack.pack_path());
+/**
+ * read and undeltify a delta's base. With a batch, bases are kept so that
+ * a base shared by several deltas is resolved only once
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      pack &_pack: pack containing the base
+ *      size_t off: base's offset
+ *      size_t len: base's length in pack (0 if unknown)
+ *      __pack_batch_s *batch: batch state (nullptr for none)
+ *      size_t depth: deltas above the base
+ * Returns:
+ *      undeltified base, empty buf if resolving failed or the chain is
+ *      deeper than __PACK_DELTA_DEPTH_MAX
+ */
+__pack_item_s pack::__delta_base(const pack_list &pack_collection,
+                                 pack &_pack,
+                                 size_t off,
+                                 size_t len,
+                                 __pack_batch_s *batch,
+                                 size_t depth) {
+    std::pair<const pack *, size_t> key(&_pack, off);
+
+    if (batch != nullptr) {
+        auto cached = batch->bases.find(key);
+        if (cached != batch->bases.end()) {
+            GITFSI_METRICS_ADD(metric_counter_delta_bases_hits, 1);
+            return cached->second;
+        }
+        GITFSI_METRICS_ADD(metric_counter_delta_bases_misses, 1);
+    }
 
-    __pack_segment_s base_segment =
-        this->__get_segment(packfile,
-                            packitem.off - packitem.negative_off,
-                            this->__indexes_findlen(_pack,
-                                                    packitem.off - packitem.negative_off));
+    if (depth > __PACK_DELTA_DEPTH_MAX) {
+        return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
+    }
 
+    __pack_segment_s base_segment = _pack.__get_segment(off, len);
     if (base_segment.buf.empty()) {
         return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
     }
@@ -252,30 +389,69 @@ __pack_item_s pack::__ofsdelta_patch(std::vector<pack> &pack_collection,
     }
 
     if (base_packitem.type == 6) {
-        base_packitem = this->__ofsdelta_patch(pack_collection, _pack, base_packitem);
+        base_packitem = this->__ofsdelta_patch(pack_collection, _pack, base_packitem, batch, depth);
     }
     else if (base_packitem.type == 7) {
-        base_packitem = this->__refdelta_patch(pack_collection, base_packitem);
+        base_packitem = this->__refdelta_patch(pack_collection, base_packitem, batch, depth);
     }
 
     if (base_packitem.buf.empty()) {
         return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
     }
 
+    if (batch != nullptr) {
+        if (batch->bases_len + base_packitem.buf.size() > __PACK_BATCH_BASES_MAX) {
+            batch->bases.clear();
+            batch->bases_len = 0;
+        }
+        batch->bases.insert(std::make_pair(key, base_packitem));
+        batch->bases_len += base_packitem.buf.size();
+    }
+
+    return base_packitem;
+}
+
+
+__pack_item_s pack::__ofsdelta_patch(const pack_list &pack_collection,
+                                    pack &_pack,
+                                    const __pack_item_s &packitem,
+                                    __pack_batch_s *batch,
+                                    size_t depth) {
+    GITFSI_TRACE_SPAN(span, "pack.ofs_delta");
+    size_t base_off = packitem.off - packitem.negative_off;
+    GITFSI_TRACE_ARG(span, "off", packitem.off);
+    GITFSI_TRACE_ARG(span, "base_off", base_off);
+    __pack_item_s base_packitem = this->__delta_base(pack_collection,
+                                                     _pack,
+                                                     base_off,
+                                                     this->__indexes_findlen(_pack, base_off),
+                                                     batch,
+                                                     depth + 1);
+    if (base_packitem.buf.empty()) {
+        return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
+    }
+
     std::basic_string<byte> patched_buf = this->__delta_patch(base_packitem.buf, packitem);
+    if (patched_buf.empty()) {
+        return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
+    }
 
     return { patched_buf, base_packitem.type, sign_t(), 0, 0, patched_buf.size() };
 }
 
 
-__pack_item_s pack::__refdelta_patch(std::vector<pack> &pack_collection,
-                                     const __pack_item_s &packitem) {
-    std::vector<pack>::iterator pack_itr = pack_collection.begin();
+__pack_item_s pack::__refdelta_patch(const pack_list &pack_collection,
+                                     const __pack_item_s &packitem,
+                                     __pack_batch_s *batch,
+                                     size_t depth) {
+    GITFSI_TRACE_SPAN(span, "pack.ref_delta");
+    GITFSI_TRACE_ARG(span, "off", packitem.off);
+    pack_list::const_iterator pack_itr = pack_collection.begin();
     std::map<sign_t, __pack_idx_s>::iterator find_result = this->_sign_indexes.end();
 
     for (; pack_itr != pack_collection.end(); pack_itr++) {
-        find_result = pack_itr->_sign_indexes.find(packitem.sign);
-        if (find_result != pack_itr->_sign_indexes.end()) {
+        find_result = (*pack_itr)->_sign_indexes.find(packitem.sign);
+        if (find_result != (*pack_itr)->_sign_indexes.end()) {
             break;
         }
     }
@@ -283,28 +459,15 @@ __pack_item_s pack::__refdelta_patch(std::vector<pack> &pack_collection,
     if (pack_itr == pack_collection.end()) {
         return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
     }
-
-    std::ifstream base_packfile(pack_itr->_pack_path);
-    __pack_segment_s base_segment = pack_itr->__get_segment(base_packfile,
-                                                            find_result->second.off,
-                                                            find_result->second.len);
-    if (base_segment.buf.empty()) {
-        return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
-    }
-    __pack_item_s base_packitem = this->__get_item(base_segment);
-    if (base_packitem.buf.empty()) {
-        return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
-    }
-
-    if (base_packitem.type == 6) {
-        base_packitem = this->__ofsdelta_patch(pack_collection,
-                                               *pack_itr,
-                                               base_packitem);
-    }
-    else if (base_packitem.type == 7) {
-       base_packitem = this->__refdelta_patch(pack_collection, base_packitem);
-    }
-
+    GITFSI_TRACE_ARG(span, "base_pack", (*pack_itr)->_pack_path);
+    GITFSI_TRACE_ARG(span, "base_off", find_result->second.off);
+
+    __pack_item_s base_packitem = this->__delta_base(pack_collection,
+                                                     **pack_itr,
+                                                     find_result->second.off,
+                                                     find_result->second.len,
+                                                     batch,
+                                                     depth + 1);
     if (base_packitem.buf.empty()) {
         return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
     }
@@ -319,90 +482,156 @@ __pack_item_s pack::__refdelta_patch(std::vector<pack> &pack_collection,
 }
 
 
+/**
+ * read an ofs delta's base offset, encoded at the start of its segment
+ * Args:
+ *      const std::basic_string<byte> &buf: segment after the item header
+ *      size_t off: delta's offset
+ *      size_t &nbytes: encoded offset's length (output)
+ *      size_t &base_off: base's offset (output)
+ * Returns:
+ *      false if the offset is cut, 0 or before the pack's start
+ */
+inline bool __inl_ofs_base(const std::basic_string<byte> &buf, size_t off, size_t &nbytes, size_t &base_off) {
+    auto itr = buf.begin();
+    if (itr == buf.end()) {
+        return false;
+    }
+
+    nbytes = 1;
+    size_t negative_off = size_t(*itr & 0x7F);
+    while (*itr & 0x80) {
+        if (++itr == buf.end() || (negative_off >> (8 * sizeof(size_t) - 8)) != 0) {
+            return false;
+        }
+        nbytes++;
+        negative_off = ((negative_off + 1) << 7) | size_t(*itr & 0x7F);
+    }
+    // the base comes strictly before the delta
+    if (negative_off == 0 || negative_off > off) {
+        return false;
+    }
+    base_off = off - negative_off;
+    return true;
+}
+
 __pack_item_s pack::__get_item(__pack_segment_s &seg) {
     if (seg.type < 5) {
         std::basic_string<byte> deflate_bytes = __inflate(seg.buf, seg.item_len);
         return { deflate_bytes, seg.type, sign_t(), 0, seg.off, 0 };
     }
     else if (seg.type == 6) { // ofs delta
-        auto itr = seg.buf.begin();
-
-        int nbytes = 1;
-        size_t negative_off = size_t(*itr & 0x7F);
-
-        while (*itr & 0x80) {
-            itr++;
-            nbytes++;
-            negative_off = (negative_off << 7) | size_t(*itr & 0x7F);
-        }
-        if (nbytes >= 2) {
-            for (int i = 1; i < nbytes; i++) {
-                negative_off += (1 << (7 * i));
-            }
+        size_t nbytes;
+        size_t base_off;
+        if (!__inl_ofs_base(seg.buf, seg.off, nbytes, base_off)) {
+            return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
         }
 
-        std::basic_string<byte> inflate_bytes(itr + 1, seg.buf.end());
-        std::basic_string<byte> deflate_bytes = __inflate(inflate_bytes,
-                                                          seg.buf.size() - nbytes);
-        return { deflate_bytes, seg.type, sign_t(), negative_off, seg.off, seg.item_len };
+        // delta's inflated size is in the pack header, inflate in one go
+        std::basic_string<byte> deflate_bytes = __inflate(seg.buf.data() + nbytes,
+                                                          seg.buf.size() - nbytes,
+                                                          seg.item_len);
+        return { deflate_bytes, seg.type, sign_t(), seg.off - base_off, seg.off, seg.item_len };
     }
-    else if (seg.type == 7) { // ref delta
-        std::string sign(seg.buf.begin(), seg.buf.begin() + 20);
-        std::basic_string<byte> inflate_bytes(seg.buf.begin() + 20, seg.buf.end());
-        std::basic_string<byte> deflate_bytes = __inflate(inflate_bytes, seg.item_len);
+    else if (seg.type == 7) { // ref delta, base's id comes first
+        if (seg.buf.size() < this->_sign_len) {
+            return { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
+        }
+        sign_t sign;
+        sign.bytes_assign(seg.buf.begin(), seg.buf.begin() + this->_sign_len);
+        std::basic_string<byte> deflate_bytes = __inflate(seg.buf.data() + this->_sign_len,
+                                                          seg.buf.size() - this->_sign_len,
+                                                          seg.item_len);
 
-        return { deflate_bytes, seg.type, sign_t(sign), 0, seg.off, seg.item_len };
+        return { deflate_bytes, seg.type, sign, 0, seg.off, seg.item_len };
     }
 
     return { std::basic_string<byte>(), 0, 0, 0, 0, 0 };
 }
 
 
-std::basic_string<byte> pack::__delta_patch(std::basic_string<byte> &base,
-                                            __pack_item_s delta) {
-    std::basic_string<byte>::iterator itr = delta.buf.begin();
-    while (*itr & 0x80) { itr++; }
-    itr++;
-
-    size_t size = 0;
+/**
+ * read a delta header's size (varint) at pos
+ * Returns:
+ *      false if the delta ends before the size does
+ */
+inline bool __inl_delta_varint(const std::basic_string<byte> &delta, size_t &pos, size_t &value) {
+    value = 0;
+    for (size_t shift = 0; pos < delta.size() && shift < 64; shift += 7) {
+        byte ch = delta[pos++];
+        value |= size_t(ch & 0x7F) << shift;
+        if (!(ch & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    int i = 0;
-    size_t tmp;
-    do {
-        tmp = *itr++;
-        size |= (tmp & 0x7F) << i;
-        i += 7;
-    } while (tmp & 0x80 && itr != delta.buf.end());
+/**
+ * apply a delta to its base, every read is bounded by the delta's and
+ * base's sizes
+ * Returns:
+ *      undeltified content, empty if the delta is malformed
+ */
+std::basic_string<byte> pack::__delta_patch(const std::basic_string<byte> &base,
+                                            const __pack_item_s &delta) {
+    GITFSI_TRACE_SPAN(span, "pack.delta_patch");
+    GITFSI_TRACE_ARG(span, "base_bytes", base.size());
+#ifdef GITFSI_METRICS
+    __metrics_delta_depth++;
+#endif
+    const std::basic_string<byte> &buf = delta.buf;
+    size_t pos = 0;
+    size_t base_size;
+    size_t size;
+    if (!__inl_delta_varint(buf, pos, base_size)
+        || !__inl_delta_varint(buf, pos, size)
+        || base_size != base.size()) {
+        return std::basic_string<byte>();
+    }
 
     std::basic_string<byte> ret;
-    while (itr != delta.buf.end()) {
-        uint8_t cmd = *itr++;
+    while (pos < buf.size()) {
+        uint8_t cmd = buf[pos++];
         if (cmd & 0x80) {
+            // bits 0-3 flag offset bytes, bits 4-6 size bytes, low first
             size_t cp_off = 0;
             size_t cp_size = 0;
-            if (cmd & 0x01) { cp_off = *itr++; }
-            if (cmd & 0x02) { cp_off |= *itr++ << 8; }
-            if (cmd & 0x04) { cp_off |= *itr++ << 16; }
-            if (cmd & 0x08) { cp_off |= ((unsigned) *itr++ << 24); }
-            if (cmd & 0x10) { cp_size = *itr++; }
-            if (cmd & 0x20) { cp_size |= *itr++ << 8; }
-            if (cmd & 0x40) { cp_size |= *itr++ << 16; }
+            for (int bit = 0; bit < 7; bit++) {
+                if (!(cmd & (1 << bit))) {
+                    continue;
+                }
+                if (pos == buf.size()) {
+                    return std::basic_string<byte>();
+                }
+                if (bit < 4) {
+                    cp_off |= size_t(buf[pos++]) << (8 * bit);
+                }
+                else {
+                    cp_size |= size_t(buf[pos++]) << (8 * (bit - 4));
+                }
+            }
             if (cp_size == 0) { cp_size = 0x10000; }
+            if (cp_off + cp_size > base.size() || cp_size > size) {
+                return std::basic_string<byte>();
+            }
 
             ret.insert(ret.end(), base.begin() + cp_off, base.begin() + cp_off + cp_size);
             size -= cp_size;
         }
         else if (cmd) {
-            if (cmd > size) { break; }
-            ret.insert(ret.end(), itr, itr + cmd);
-            itr += cmd;
+            if (cmd > size || cmd > buf.size() - pos) {
+                return std::basic_string<byte>();
+            }
+            ret.insert(ret.end(), buf.begin() + pos, buf.begin() + pos + cmd);
+            pos += cmd;
             size -= cmd;
         }
         else {
             return std::basic_string<byte>();
         }
     }
-    if (itr != delta.buf.end() || size != 0) {
+    if (size != 0) {
         return std::basic_string<byte>();
     }
 
@@ -410,35 +639,90 @@ std::basic_string<byte> pack::__delta_patch(std::basic_string<byte> &base,
 }
 
 
-object pack::__get(std::vector<pack> &pack_collection,
-                   const __pack_idx_s &index) {
-    std::ifstream pack_file(this->_pack_path);
-    if (!pack_file.is_open()) {
-        return object();
+/**
+ * resolve delta chain
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      __pack_item_s packitem: pack item (maybe delta)
+ *      __pack_batch_s *batch: batch state (nullptr for none)
+ * Returns:
+ *      undeltified pack item, type 0 if resolving failed
+ */
+__pack_item_s pack::__resolve(const pack_list &pack_collection,
+                              __pack_item_s packitem,
+                              __pack_batch_s *batch) {
+#ifdef GITFSI_METRICS
+    __metrics_delta_depth = 0;
+#endif
+    while (true) {
+        switch (packitem.type) {
+        case 0x06:
+            packitem = this->__ofsdelta_patch(pack_collection, *this, packitem, batch);
+            break;
+        case 0x07:
+            packitem = this->__refdelta_patch(pack_collection, packitem, batch);
+            break;
+        default:
+            GITFSI_METRICS_OBSERVE(metric_histogram_delta_depth, __metrics_delta_depth);
+            return packitem;
+        }
     }
-    __pack_segment_s segment = this->__get_segment(pack_file, index.off, index.len);
-    __pack_item_s packitem = this->__get_item(segment);
+}
 
-apply_delta:
-    switch (packitem.type) {
+/**
+ * map pack object type to object type
+ */
+inline obj_type __inl_pack_obj_type(uint8_t type) {
+    switch (type) {
     case 0x01:
-        return object(packitem.buf, obj_type::obj_type_commit);
+        return obj_type::obj_type_commit;
     case 0x02:
-        return object(packitem.buf, obj_type::obj_type_tree);
+        return obj_type::obj_type_tree;
     case 0x03:
-        return object(packitem.buf, obj_type::obj_type_blob);
-    case 0x06:
-        packitem = this->__ofsdelta_patch(pack_collection, *this, packitem);
-        goto apply_delta;
-    case 0x07:
-        packitem = this->__refdelta_patch(pack_collection, packitem);
-        goto apply_delta;
+        return obj_type::obj_type_blob;
+    case 0x04:
+        return obj_type::obj_type_tag;
     default:
+        return obj_type::obj_type_unknow;
+    }
+}
+
+/**
+ * check undeltified content against the object's id
+ */
+inline bool __inl_pack_verify(const sign_t &sign, obj_type type, std::basic_string<byte> &buf) {
+    sign_t computed;
+    if (hash_object(type, buf.data(), buf.size(), computed) && computed == sign) {
+        return true;
+    }
+    GITFSI_METRICS_ADD(metric_counter_verify_failures, 1);
+    return false;
+}
+
+object pack::__get(const pack_list &pack_collection,
+                   const __pack_idx_s &index,
+                   bool verify) {
+    GITFSI_TRACE_SPAN(span, "pack.get");
+    GITFSI_TRACE_ARG(span, "pack", this->_pack_path);
+    GITFSI_TRACE_ARG(span, "off", index.off);
+    __pack_segment_s segment = this->__get_segment(index.off, index.len);
+    __pack_item_s packitem = this->__resolve(pack_collection, this->__get_item(segment));
+
+    obj_type type = __inl_pack_obj_type(packitem.type);
+    if (verify && !__inl_pack_verify(index.sign, type, packitem.buf)) {
         return object();
     }
+    return object(std::move(packitem.buf), type, this->_sign_len);
 }
 
-object pack::get(std::vector<pack> &pack_collection, sign_t sign) {
+/**
+ * get object
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      sign_t sign: object's sign
+ *      bool verify: check content against sign, a mismatch reads as missing
+ */
+object pack::get(const pack_list &pack_collection, sign_t sign, bool verify) {
     auto find_result = this->_sign_indexes.find(sign);
     if (find_result == this->_sign_indexes.end()) {
         // return unknow object (not found)
@@ -446,7 +730,500 @@ object pack::get(std::vector<pack> &pack_collection, sign_t sign) {
     }
 
     // return packed object
-    return this->__get(pack_collection, find_result->second);
+    return this->__get(pack_collection, find_result->second, verify);
+}
+
+/**
+ * hint the kernel to read ahead the ranges covering indexes (sorted by
+ * offset), nearby items are merged into one range
+ * Args:
+ *      std::vector<__pack_idx_s> &indexes: items to be read
+ */
+void pack::__readahead(std::vector<__pack_idx_s> &indexes) {
+    int fd = this->_pack_fd;
+    if (fd == -1) {
+        return;
+    }
+
+    size_t begin = 0;
+    size_t end = 0;
+    for (auto itr = indexes.begin(); itr != indexes.end(); itr++) {
+        if (end != 0 && itr->off <= end + __PACK_READAHEAD_GAP) {
+            end = std::max(end, itr->off + itr->len);
+            continue;
+        }
+        if (end != 0) {
+            posix_fadvise(fd, begin, end - begin, POSIX_FADV_WILLNEED);
+        }
+        begin = itr->off;
+        end = itr->off + itr->len;
+    }
+    if (end != 0) {
+        posix_fadvise(fd, begin, end - begin, POSIX_FADV_WILLNEED);
+    }
+}
+
+/**
+ * get many objects of this pack in offset order, resolved delta bases are
+ * shared through the batch
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      std::vector<__pack_idx_s> &indexes: objects' indexes (sorted in place)
+ *      __pack_batch_s &batch: batch state
+ *      std::function<void(sign_t &, object &)> callback: invoked per object
+ *      bool verify: check contents against signs, mismatches come as
+ *                   obj_type_unknow
+ */
+void pack::get_many(const pack_list &pack_collection,
+                    std::vector<__pack_idx_s> &indexes,
+                    __pack_batch_s &batch,
+                    std::function<void(sign_t &, object &)> callback,
+                    bool verify) {
+    std::sort(indexes.begin(),
+              indexes.end(),
+              [] (const __pack_idx_s &a, const __pack_idx_s &b) -> bool {
+                return a.off < b.off;
+              });
+    indexes.erase(std::unique(indexes.begin(),
+                              indexes.end(),
+                              [] (const __pack_idx_s &a, const __pack_idx_s &b) -> bool {
+                                return a.off == b.off;
+                              }),
+                  indexes.end());
+    this->__readahead(indexes);
+
+    for (auto itr = indexes.begin(); itr != indexes.end(); itr++) {
+        __pack_segment_s segment = this->__get_segment(itr->off, itr->len);
+        __pack_item_s packitem = this->__resolve(pack_collection,
+                                                 this->__get_item(segment),
+                                                 &batch);
+
+        obj_type type = __inl_pack_obj_type(packitem.type);
+        if (verify && !__inl_pack_verify(itr->sign, type, packitem.buf)) {
+            object missing;
+            callback(itr->sign, missing);
+            continue;
+        }
+        object obj(std::move(packitem.buf), type, this->_sign_len);
+        callback(itr->sign, obj);
+    }
+}
+
+/**
+ * position of the item at `off` in offset order
+ * Returns:
+ *      PACK_NODE_ROOT if no item starts there
+ */
+inline size_t __inl_pack_position(const std::vector<__pack_idx_s> &indexes, size_t off) {
+    auto found = std::lower_bound(indexes.begin(),
+                                  indexes.end(),
+                                  off,
+                                  [] (const __pack_idx_s &index, size_t value) -> bool {
+                                    return index.off < value;
+                                  });
+    if (found == indexes.end() || found->off != off) {
+        return PACK_NODE_ROOT;
+    }
+    return found - indexes.begin();
+}
+
+/**
+ * undeltified object's size from a delta's beginning (base's size, then
+ * result's size, both as varints)
+ * Returns:
+ *      false if the delta is cut before the result's size
+ */
+inline bool __inl_delta_result_size(const std::basic_string<byte> &delta, size_t &size) {
+    size_t pos = 0;
+    return __inl_delta_varint(delta, pos, size) && __inl_delta_varint(delta, pos, size);
+}
+
+/**
+ * read every item's header (type, size and delta base) in offset order
+ * without inflating anything, headers are read through a sliding window
+ * Args:
+ *      std::vector<__pack_node_s> &nodes: items in offset order (output)
+ *      bool delta_sizes: give deltas the undeltified object's size, only
+ *                        their first bytes are inflated
+ */
+void pack::scan(std::vector<__pack_node_s> &nodes, bool delta_sizes) {
+    nodes.assign(this->_indexes.size(), __pack_node_s { 0, 0, PACK_NODE_ROOT });
+
+    // type and size, then an ofs delta's offset or a ref delta's base id
+    const size_t header_max = 20 + this->_sign_len + (delta_sizes ? __PACK_DELTA_PREFIX_LEN : 0);
+    std::basic_string<byte> window;
+    size_t window_off = 0;
+    for (size_t i = 0; i < this->_indexes.size(); i++) {
+        const __pack_idx_s &index = this->_indexes[i];
+        size_t need = std::min(index.len, header_max);
+        if (index.off < window_off || index.off + need > window_off + window.size()) {
+            window.resize(std::max(__PACK_SCAN_WINDOW, need));
+            ssize_t nread = pread(this->_pack_fd, &window[0], window.size(), index.off);
+            window.resize(nread > 0 ? nread : 0);
+            window_off = index.off;
+        }
+        const byte *header = window.data() + (index.off - window_off);
+        size_t header_len = std::min(need, window.size() - (index.off - window_off));
+        if (header_len == 0) {
+            continue;
+        }
+
+        size_t pos = 0;
+        uint8_t p_byte = header[pos++];
+        __pack_node_s &node = nodes[i];
+        node.type = (p_byte >> 4) & 0x07;
+        node.size = p_byte & 0x0F;
+        for (size_t shift = 4; (p_byte & 0x80) && pos < header_len; shift += 7) {
+            p_byte = header[pos++];
+            node.size += size_t(p_byte & 0x7F) << shift;
+        }
+        size_t type_header_len = pos;
+
+        if (node.type == 6 && pos < header_len) {
+            p_byte = header[pos++];
+            size_t negative_off = p_byte & 0x7F;
+            while ((p_byte & 0x80) && pos < header_len) {
+                p_byte = header[pos++];
+                negative_off = ((negative_off + 1) << 7) | (p_byte & 0x7F);
+            }
+            if (negative_off != 0 && negative_off <= index.off) {
+                node.base = __inl_pack_position(this->_indexes, index.off - negative_off);
+            }
+        }
+        else if (node.type == 7 && pos + this->_sign_len <= header_len) {
+            sign_t base_sign;
+            base_sign.bytes_assign(header + pos, header + pos + this->_sign_len);
+            auto find_result = this->_sign_indexes.find(base_sign);
+            if (find_result != this->_sign_indexes.end()) {
+                node.base = __inl_pack_position(this->_indexes, find_result->second.off);
+            }
+            pos += this->_sign_len;
+        }
+
+        if (delta_sizes && (node.type == 6 || node.type == 7) && pos < header_len) {
+            std::basic_string<byte> deflated(header + pos, header + header_len);
+            size_t result_size;
+            if (__inl_delta_result_size(__inflate_prefix(deflated, 20), result_size)) {
+                node.size = result_size;
+                continue;
+            }
+            // the stream starts with a large block header, read the whole delta
+            __pack_segment_s segment = this->__get_segment(index.off, index.len);
+            if (segment.buf.size() > pos - type_header_len) {
+                deflated.assign(segment.buf.begin() + (pos - type_header_len), segment.buf.end());
+                if (__inl_delta_result_size(__inflate_prefix(deflated, 20), result_size)) {
+                    node.size = result_size;
+                }
+            }
+        }
+    }
+}
+
+// a whole-pack scan's unit of work: one item, undeltified from its base's
+// content unless it's a root
+struct __pack_task_s {
+    size_t nth;
+    std::shared_ptr<const std::basic_string<byte>> base;
+    uint8_t base_type;
+};
+
+/**
+ * deliver every object of the pack exactly once. The delta forest is built
+ * from items' headers, then each tree is walked depth-first from its root:
+ * an item is inflated and undeltified once, from its base's content, and
+ * its deltas become tasks of a work-stealing pool
+ * Args:
+ *      const pack_list &pack_collection: repository's packs (bases of
+ *                                        thin deltas)
+ *      std::function<void(unsigned, sign_t &, object &)> callback: invoked
+ *          with the worker's number (below the threads count), concurrently
+ *          from different workers; unresolvable items come as obj_type_unknow
+ *      unsigned threads: threads count (0 for hardware concurrency)
+ *      bool verify: check contents against signs, mismatches come as
+ *                   obj_type_unknow
+ *      unsigned types: objects delivered, bit (1 << obj_type_x) for
+ *                      obj_type_x; trees of other types aren't read
+ */
+void pack::for_each(const pack_list &pack_collection,
+                    std::function<void(unsigned, sign_t &, object &)> callback,
+                    unsigned threads,
+                    bool verify,
+                    unsigned types) {
+    GITFSI_TRACE_SPAN(span, "pack.for_each");
+    GITFSI_TRACE_ARG(span, "pack", this->_pack_path);
+    std::vector<__pack_node_s> nodes;
+    this->scan(nodes);
+
+    // deltas of each item, consecutive in `children` from children_begin[nth]
+    std::vector<size_t> children_begin(nodes.size() + 1, 0);
+    for (auto itr = nodes.begin(); itr != nodes.end(); itr++) {
+        if (itr->base != PACK_NODE_ROOT) {
+            children_begin[itr->base + 1]++;
+        }
+    }
+    for (size_t i = 0; i < nodes.size(); i++) {
+        children_begin[i + 1] += children_begin[i];
+    }
+    std::vector<size_t> children(children_begin.back());
+    std::vector<size_t> children_end(children_begin.begin(), children_begin.end() - 1);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].base != PACK_NODE_ROOT) {
+            children[children_end[nodes[i].base]++] = i;
+        }
+    }
+
+    // items in a base cycle (only in a corrupt pack) are never reached
+    std::vector<uint8_t> delivered(nodes.size(), 0);
+    // deltas share their base's type, a filtered out tree is skipped whole
+    auto skip_tree = [&] (size_t root) -> void {
+        std::vector<size_t> pending(1, root);
+        while (!pending.empty()) {
+            size_t nth = pending.back();
+            pending.pop_back();
+            delivered[nth] = 1;
+            pending.insert(pending.end(),
+                           children.begin() + children_begin[nth],
+                           children.begin() + children_begin[nth + 1]);
+        }
+    };
+
+    // roots are dealt in offset order, a worker's share is contiguous and
+    // pushed backwards so it pops its lowest offset first
+    __steal_pool<__pack_task_s> pool(threads);
+    std::vector<size_t> roots;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].base != PACK_NODE_ROOT) {
+            continue;
+        }
+        obj_type type = __inl_pack_obj_type(nodes[i].type);
+        if (type != obj_type::obj_type_unknow && ((types >> type) & 1) == 0) {
+            skip_tree(i);
+            continue;
+        }
+        roots.push_back(i);
+    }
+    for (unsigned worker = 0; worker < pool.size(); worker++) {
+        size_t begin = roots.size() * worker / pool.size();
+        size_t end = roots.size() * (worker + 1) / pool.size();
+        for (size_t i = end; i > begin; i--) {
+            pool.push(worker, __pack_task_s { roots[i - 1], nullptr, 0 });
+        }
+    }
+
+    pool.run([&] (unsigned worker, __pack_task_s &task) -> void {
+        __pack_idx_s &index = this->_indexes[task.nth];
+        delivered[task.nth] = 1;
+
+        __pack_segment_s segment = this->__get_segment(index.off, index.len);
+        __pack_item_s packitem = { std::basic_string<byte>(), 0, sign_t(), 0, 0, 0 };
+        if (task.base != nullptr) {
+            packitem = this->__get_item(segment);
+            if (!packitem.buf.empty()) {
+                packitem.buf = this->__delta_patch(*task.base, packitem);
+            }
+            packitem.type = packitem.buf.empty() ? 0 : task.base_type;
+        }
+        else if (nodes[task.nth].type == 7) {
+            // a ref delta root's base is in another pack
+            packitem = this->__resolve(pack_collection, this->__get_item(segment));
+        }
+        else if (nodes[task.nth].type != 6) {
+            packitem = this->__get_item(segment);
+        }
+        // an ofs delta root's base offset isn't an item, it's delivered as
+        // obj_type_unknow
+
+        obj_type type = __inl_pack_obj_type(packitem.type);
+        if (type != obj_type::obj_type_unknow && ((types >> type) & 1) == 0) {
+            // a root whose base is in another pack
+            skip_tree(task.nth);
+            return;
+        }
+        bool valid = type != obj_type::obj_type_unknow
+            && (!verify || __inl_pack_verify(index.sign, type, packitem.buf));
+
+        size_t children_len = children_begin[task.nth + 1] - children_begin[task.nth];
+        if (type != obj_type::obj_type_unknow && children_len != 0) {
+            std::shared_ptr<const std::basic_string<byte>> base =
+                std::make_shared<const std::basic_string<byte>>(packitem.buf);
+            for (size_t i = children_begin[task.nth]; i < children_begin[task.nth + 1]; i++) {
+                pool.push(worker, __pack_task_s { children[i], base, packitem.type });
+            }
+        }
+
+        if (!valid) {
+            object missing;
+            callback(worker, index.sign, missing);
+            return;
+        }
+        object obj(std::move(packitem.buf), type, this->_sign_len);
+        callback(worker, index.sign, obj);
+    });
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (delivered[i] == 0) {
+            object missing;
+            callback(0, this->_indexes[i].sign, missing);
+        }
+    }
+}
+
+/**
+ * get object's undeltified content
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      sign_t sign: object's sign
+ *      obj_type &type: object's type (output, obj_type_unknow if not found)
+ *      bool verify: check content against sign, a mismatch reads as missing
+ * Returns:
+ *      object's content
+ */
+std::basic_string<byte> pack::raw(const pack_list &pack_collection,
+                                  sign_t sign,
+                                  obj_type &type,
+                                  bool verify) {
+    type = obj_type::obj_type_unknow;
+    auto find_result = this->_sign_indexes.find(sign);
+    if (find_result == this->_sign_indexes.end()) {
+        return std::basic_string<byte>();
+    }
+
+    __pack_segment_s segment = this->__get_segment(find_result->second.off,
+                                                   find_result->second.len);
+    __pack_item_s packitem = this->__resolve(pack_collection, this->__get_item(segment));
+
+    type = __inl_pack_obj_type(packitem.type);
+    if (verify && !__inl_pack_verify(sign, type, packitem.buf)) {
+        type = obj_type::obj_type_unknow;
+        return std::basic_string<byte>();
+    }
+    return packitem.buf;
+}
+
+/**
+ * get object's leading content bytes, undeltified objects are inflated
+ * only up to `limit` bytes
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      sign_t sign: object's sign
+ *      size_t limit: max content bytes
+ *      obj_type &type: object's type (output, obj_type_unknow if not found)
+ * Returns:
+ *      at most `limit` leading content bytes
+ */
+std::basic_string<byte> pack::prefix(const pack_list &pack_collection,
+                                     sign_t sign,
+                                     size_t limit,
+                                     obj_type &type) {
+    type = obj_type::obj_type_unknow;
+    auto find_result = this->_sign_indexes.find(sign);
+    if (find_result == this->_sign_indexes.end()) {
+        return std::basic_string<byte>();
+    }
+
+    // deflate never expands stored data by more than a few bytes per block
+    size_t segment_len = std::min(find_result->second.len, limit + (limit >> 4) + 64);
+    __pack_segment_s segment = this->__get_segment(find_result->second.off, segment_len);
+
+    if (segment.type < 5) {
+        type = __inl_pack_obj_type(segment.type);
+        return __inflate_prefix(segment.buf, limit);
+    }
+
+    // delta's result depends on the whole base, resolve completely
+    segment = this->__get_segment(find_result->second.off, find_result->second.len);
+    __pack_item_s packitem = this->__resolve(pack_collection, this->__get_item(segment));
+    type = __inl_pack_obj_type(packitem.type);
+    if (packitem.buf.size() > limit) {
+        packitem.buf.resize(limit);
+    }
+    return packitem.buf;
+}
+
+/**
+ * get an object's type and size from item headers only: a delta's size is
+ * read from its first inflated bytes, its type is its chain's base's.
+ * Content isn't read, so it isn't verified either
+ * Args:
+ *      const pack_list &pack_collection: repository's packs
+ *      sign_t sign: object's sign
+ *      obj_type &type: object's type (output, obj_type_unknow if not found
+ *                      or malformed)
+ * Returns:
+ *      object's size
+ */
+size_t pack::header(const pack_list &pack_collection, sign_t sign, obj_type &type) {
+    type = obj_type::obj_type_unknow;
+    auto find_result = this->_sign_indexes.find(sign);
+    if (find_result == this->_sign_indexes.end()) {
+        return 0;
+    }
+
+    // enough for a base reference and the delta's two sizes
+    const size_t ref_len = std::max(this->_sign_len, size_t(10));
+    __pack_segment_s segment = this->__get_segment(find_result->second.off,
+                                                   std::min(find_result->second.len,
+                                                            ref_len + __PACK_DELTA_PREFIX_LEN));
+    if (segment.buf.empty()) {
+        return 0;
+    }
+
+    size_t size = segment.item_len;
+    if (segment.type == 6 || segment.type == 7) {
+        size_t nbytes = this->_sign_len;
+        size_t base_off;
+        if (segment.type == 6 && !__inl_ofs_base(segment.buf, segment.off, nbytes, base_off)) {
+            return 0;
+        }
+        std::basic_string<byte> deflated(segment.buf.begin() + std::min(nbytes, segment.buf.size()),
+                                         segment.buf.end());
+        if (!__inl_delta_result_size(__inflate_prefix(deflated, 20), size)) {
+            // the stream starts with a large block header, read the whole delta
+            segment = this->__get_segment(find_result->second.off, find_result->second.len);
+            deflated.assign(segment.buf.begin() + std::min(nbytes, segment.buf.size()), segment.buf.end());
+            if (!__inl_delta_result_size(__inflate_prefix(deflated, 20), size)) {
+                return 0;
+            }
+        }
+    }
+
+    // down the chain to its base, reading headers only
+    pack *current = this;
+    for (size_t depth = 0; depth <= __PACK_DELTA_DEPTH_MAX; depth++) {
+        if (segment.type >= 1 && segment.type <= 4) {
+            type = __inl_pack_obj_type(segment.type);
+            return size;
+        }
+
+        size_t base_off;
+        size_t nbytes;
+        if (segment.type == 6) {
+            if (!__inl_ofs_base(segment.buf, segment.off, nbytes, base_off)) {
+                return 0;
+            }
+        }
+        else if (segment.type == 7 && segment.buf.size() >= this->_sign_len) {
+            sign_t base_sign;
+            base_sign.bytes_assign(segment.buf.begin(), segment.buf.begin() + this->_sign_len);
+            auto pack_itr = pack_collection.begin();
+            for (; pack_itr != pack_collection.end(); pack_itr++) {
+                auto base_find = (*pack_itr)->_sign_indexes.find(base_sign);
+                if (base_find != (*pack_itr)->_sign_indexes.end()) {
+                    current = pack_itr->get();
+                    base_off = base_find->second.off;
+                    break;
+                }
+            }
+            if (pack_itr == pack_collection.end()) {
+                return 0;
+            }
+        }
+        else {
+            return 0;
+        }
+        segment = current->__get_segment(base_off, ref_len);
+    }
+    return 0;
 }
 
 }
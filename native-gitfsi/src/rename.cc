@@ -0,0 +1,334 @@
+#include "rename.h"
+#include "blob.h"
+#include "parallel.h"
+#include <algorithm>
+#include <map>
+
+namespace gitter_kid {
+namespace fsi {
+
+const uint32_t __SIMILARITY_HASHBASE = 107927;
+const uint32_t __SIMILARITY_CHUNK_MAX = 64;
+const size_t __SIMILARITY_CANDIDATES_PER_DST = 4;
+
+similarity_fingerprint::similarity_fingerprint()
+    : _size(0) {}
+
+/**
+ * build fingerprint, content is cut into chunks ending at a newline
+ * (or after 64 bytes), every chunk is hashed and the bytes covered by
+ * each hash value are counted (same as git's diffcore-delta)
+ * Args:
+ *      const std::basic_string<byte> &content: blob's content
+ */
+similarity_fingerprint::similarity_fingerprint(const std::basic_string<byte> &content)
+    : _size(content.size()) {
+    std::map<uint32_t, uint32_t> counter;
+
+    uint32_t accum1 = 0;
+    uint32_t accum2 = 0;
+    uint32_t n = 0;
+    for (auto itr = content.begin(); itr != content.end(); itr++) {
+        uint32_t c = *itr;
+        // ignore CR in CRLF sequence
+        if (c == '\r' && itr + 1 != content.end() && *(itr + 1) == '\n') {
+            continue;
+        }
+
+        uint32_t old_1 = accum1;
+        accum1 = (accum1 << 7) ^ (accum2 >> 25);
+        accum2 = (accum2 << 7) ^ (old_1 >> 25);
+        accum1 += c;
+        if (++n < __SIMILARITY_CHUNK_MAX && c != '\n') {
+            continue;
+        }
+
+        counter[(accum1 + accum2 * 0x61) % __SIMILARITY_HASHBASE] += n;
+        n = 0;
+        accum1 = 0;
+        accum2 = 0;
+    }
+    if (n != 0) {
+        counter[(accum1 + accum2 * 0x61) % __SIMILARITY_HASHBASE] += n;
+    }
+
+    this->_chunks.assign(counter.begin(), counter.end());
+}
+
+size_t similarity_fingerprint::size() const {
+    return this->_size;
+}
+
+/**
+ * estimate similarity between two contents
+ * Args:
+ *      const similarity_fingerprint &other: other content's fingerprint
+ * Returns:
+ *      similarity percent (0 ~ 100), bytes shared / size of the larger one
+ */
+int similarity_fingerprint::score(const similarity_fingerprint &other) const {
+    size_t max_size = std::max(this->_size, other._size);
+    if (this->_size == 0 || other._size == 0) {
+        return 0;
+    }
+
+    size_t common = 0;
+    auto a = this->_chunks.begin();
+    auto b = other._chunks.begin();
+    while (a != this->_chunks.end() && b != other._chunks.end()) {
+        if (a->first < b->first) {
+            a++;
+        }
+        else if (a->first > b->first) {
+            b++;
+        }
+        else {
+            common += std::min(a->second, b->second);
+            a++;
+            b++;
+        }
+    }
+
+    return int(std::min(common, max_size) * 100 / max_size);
+}
+
+rename_detector::rename_detector(repository &repo)
+    : _repo(repo)
+    , _rename_limit(1000)
+    , _min_score(50)
+    , _find_copies(false)
+    , _threads(0) {}
+
+size_t &rename_detector::rename_limit() {
+    return this->_rename_limit;
+}
+
+int &rename_detector::min_score() {
+    return this->_min_score;
+}
+
+bool &rename_detector::find_copies() {
+    return this->_find_copies;
+}
+
+unsigned &rename_detector::threads() {
+    return this->_threads;
+}
+
+/**
+ * rewrite destination item as renamed (or copied) from source item
+ */
+inline void __inl_pair(tree_diff_item &dst, tree_diff_item &src, diff_status status, int score) {
+    dst.status() = status;
+    dst.old_path() = src.old_path();
+    dst.old_sign() = src.old_sign();
+    dst.similarity() = score;
+}
+
+/**
+ * pair sources & destinations having the same sign, no content is read
+ * Args:
+ *      std::vector<tree_diff_item> &items: diff items
+ *      std::vector<size_t> &sources: source items' indexes
+ *      std::vector<size_t> &destinations: added items' indexes
+ *      std::vector<bool> &consumed: deleted items renamed away
+ */
+void rename_detector::__exact(std::vector<tree_diff_item> &items,
+                              std::vector<size_t> &sources,
+                              std::vector<size_t> &destinations,
+                              std::vector<bool> &consumed) {
+    std::map<sign_t, std::vector<size_t>> source_signs;
+    for (auto itr = sources.begin(); itr != sources.end(); itr++) {
+        source_signs[items[*itr].old_sign()].push_back(*itr);
+    }
+
+    for (auto itr = destinations.begin(); itr != destinations.end(); itr++) {
+        tree_diff_item &dst = items[*itr];
+        auto find_result = source_signs.find(dst.new_sign());
+        if (find_result == source_signs.end()) {
+            continue;
+        }
+
+        std::vector<size_t> &candidates = find_result->second;
+        auto src_itr = std::find_if(candidates.begin(),
+                                    candidates.end(),
+                                    [&] (size_t src) -> bool {
+                                        return !consumed[src] &&
+                                            items[src].status() == diff_status::diff_status_deleted;
+                                    });
+
+        if (src_itr != candidates.end()) {
+            consumed[*src_itr] = true;
+            __inl_pair(dst, items[*src_itr], diff_status::diff_status_renamed, 100);
+        }
+        else if (this->_find_copies) {
+            __inl_pair(dst, items[candidates.front()], diff_status::diff_status_copied, 100);
+        }
+    }
+}
+
+struct __rename_candidate_s {
+    int score;
+    size_t dst;
+    size_t src;
+};
+
+/**
+ * pair remaining sources & destinations by content similarity
+ * Args:
+ *      std::vector<tree_diff_item> &items: diff items
+ *      std::vector<size_t> &sources: source items' indexes
+ *      std::vector<size_t> &destinations: added items' indexes
+ *      std::vector<bool> &consumed: deleted items renamed away
+ */
+void rename_detector::__inexact(std::vector<tree_diff_item> &items,
+                                std::vector<size_t> &sources,
+                                std::vector<size_t> &destinations,
+                                std::vector<bool> &consumed) {
+    std::vector<size_t> srcs;
+    std::vector<size_t> dsts;
+    for (auto itr = sources.begin(); itr != sources.end(); itr++) {
+        if (!consumed[*itr]) {
+            srcs.push_back(*itr);
+        }
+    }
+    for (auto itr = destinations.begin(); itr != destinations.end(); itr++) {
+        if (items[*itr].status() == diff_status::diff_status_added) {
+            dsts.push_back(*itr);
+        }
+    }
+
+    if (srcs.empty() || dsts.empty()) {
+        return;
+    }
+    if (srcs.size() * dsts.size() > this->_rename_limit * this->_rename_limit) {
+        return;
+    }
+
+    // fingerprint every candidate blob once
+    std::vector<similarity_fingerprint> src_prints(srcs.size());
+    std::vector<similarity_fingerprint> dst_prints(dsts.size());
+    __parallel_for(srcs.size() + dsts.size(), this->_threads, [&] (size_t i) -> void {
+        bool is_src = i < srcs.size();
+        sign_t &sign = is_src ? items[srcs[i]].old_sign() : items[dsts[i - srcs.size()]].new_sign();
+
+        object obj = this->_repo.get(sign);
+        if (obj.type() != obj_type::obj_type_blob) {
+            return;
+        }
+        if (is_src) {
+            src_prints[i] = similarity_fingerprint(obj.get<blob>().body());
+        }
+        else {
+            dst_prints[i - srcs.size()] = similarity_fingerprint(obj.get<blob>().body());
+        }
+    });
+
+    // score every destination against every source, keep the best few
+    std::vector<std::vector<__rename_candidate_s>> dst_candidates(dsts.size());
+    __parallel_for(dsts.size(), this->_threads, [&] (size_t i) -> void {
+        std::vector<__rename_candidate_s> &candidates = dst_candidates[i];
+
+        for (size_t j = 0; j < srcs.size(); j++) {
+            size_t max_size = std::max(dst_prints[i].size(), src_prints[j].size());
+            size_t delta_size = max_size - std::min(dst_prints[i].size(), src_prints[j].size());
+            if (max_size * (100 - this->_min_score) < delta_size * 100) {
+                continue;
+            }
+
+            int score = dst_prints[i].score(src_prints[j]);
+            if (score < this->_min_score) {
+                continue;
+            }
+            candidates.push_back({ score, i, j });
+        }
+
+        std::sort(candidates.begin(),
+                  candidates.end(),
+                  [] (const __rename_candidate_s &a, const __rename_candidate_s &b) -> bool {
+                    return a.score > b.score;
+                  });
+        if (candidates.size() > __SIMILARITY_CANDIDATES_PER_DST) {
+            candidates.resize(__SIMILARITY_CANDIDATES_PER_DST);
+        }
+    });
+
+    std::vector<__rename_candidate_s> candidates;
+    for (auto itr = dst_candidates.begin(); itr != dst_candidates.end(); itr++) {
+        candidates.insert(candidates.end(), itr->begin(), itr->end());
+    }
+    std::stable_sort(candidates.begin(),
+                     candidates.end(),
+                     [] (const __rename_candidate_s &a, const __rename_candidate_s &b) -> bool {
+                        return a.score > b.score;
+                     });
+
+    // best scores first, every destination is paired at most once
+    std::vector<bool> dst_paired(dsts.size(), false);
+    for (auto itr = candidates.begin(); itr != candidates.end(); itr++) {
+        if (dst_paired[itr->dst]) {
+            continue;
+        }
+
+        tree_diff_item &dst = items[dsts[itr->dst]];
+        size_t src = srcs[itr->src];
+        if (!consumed[src] && items[src].status() == diff_status::diff_status_deleted) {
+            consumed[src] = true;
+            __inl_pair(dst, items[src], diff_status::diff_status_renamed, itr->score);
+        }
+        else if (this->_find_copies) {
+            __inl_pair(dst, items[src], diff_status::diff_status_copied, itr->score);
+        }
+        else {
+            continue;
+        }
+        dst_paired[itr->dst] = true;
+    }
+}
+
+/**
+ * detect renames (and copies) in tree diff's items, deleted items
+ * renamed away are removed, added items are rewritten as renamed/copied
+ * Args:
+ *      std::vector<tree_diff_item> &items: tree diff's items
+ */
+void rename_detector::detect(std::vector<tree_diff_item> &items) {
+    std::vector<size_t> sources;
+    std::vector<size_t> destinations;
+    for (size_t i = 0; i < items.size(); i++) {
+        switch (items[i].status()) {
+        case diff_status::diff_status_added:
+            destinations.push_back(i);
+            break;
+        case diff_status::diff_status_deleted:
+            sources.push_back(i);
+            break;
+        case diff_status::diff_status_modified:
+            if (this->_find_copies) {
+                sources.push_back(i);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (destinations.empty() || sources.empty()) {
+        return;
+    }
+
+    std::vector<bool> consumed(items.size(), false);
+    this->__exact(items, sources, destinations, consumed);
+    this->__inexact(items, sources, destinations, consumed);
+
+    std::vector<tree_diff_item> result;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (!consumed[i]) {
+            result.push_back(items[i]);
+        }
+    }
+    items.swap(result);
+}
+
+}
+}
@@ -1,24 +1,130 @@
 #include "repository.h"
 #include "pack.h"
+#include "inflate.h"
+#include "parallel.h"
+#include "metrics.h"
+#include "trace.h"
+#include "sha1.h"
 #include <sstream>
 #include <fstream>
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <algorithm>
+#include <set>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
 
 namespace gitter_kid {
 namespace fsi {
 
+inline std::string __inl_config_trim(const std::string &value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return value.substr(begin, value.find_last_not_of(" \t\r") + 1 - begin);
+}
+
+/**
+ * id width of the repository at path, SHA-256 when the config has
+ * extensions.objectFormat = sha256
+ */
+inline size_t __inl_config_sign_len(const std::string &path) {
+    std::ifstream config_file(path + "/config");
+    std::string section;
+    std::string line;
+    while (std::getline(config_file, line)) {
+        line = __inl_config_trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') {
+            continue;
+        }
+        // section and key names are case-insensitive
+        std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+        if (line[0] == '[') {
+            section = __inl_config_trim(line.substr(1, line.find(']') - 1));
+            continue;
+        }
+
+        size_t equal = line.find('=');
+        if (section == "extensions"
+            && equal != std::string::npos
+            && __inl_config_trim(line.substr(0, equal)) == "objectformat"
+            && __inl_config_trim(line.substr(equal + 1)) == "sha256") {
+            return SIGN_SHA256_LEN;
+        }
+    }
+    return SIGN_SHA1_LEN;
+}
+
 repository::repository(std::string path)
-    : _path(path) {}
+    : _path(path)
+    , _packs(std::make_shared<const pack_list>())
+    , _packs_mtime({ 0, 0 })
+    , _watcher_stop(-1)
+    , _loose_dirs(256)
+    , _packed_refs_mtime({ 0, 0 })
+    , _verify(false)
+    , _sign_len(__inl_config_sign_len(path)) {}
+
+repository::~repository() {
+    if (this->_watcher.joinable()) {
+        close(this->_watcher_stop);
+        this->_watcher.join();
+    }
+}
+
+/**
+ * verify-on-read: get, get_many and raw hash what they read (SHA-1, with
+ * the SHA extensions when available) and treat a mismatch as missing.
+ * SHA-256 repositories aren't verified
+ */
+bool &repository::verify() {
+    return this->_verify;
+}
+
+/**
+ * whether reads are verified (hashing is SHA-1 only)
+ */
+bool repository::__verifying() const {
+    return this->_verify && this->_sign_len == SIGN_SHA1_LEN;
+}
+
+/**
+ * id width in bytes, SIGN_SHA1_LEN or SIGN_SHA256_LEN
+ */
+size_t repository::sign_len() const {
+    return this->_sign_len;
+}
+
+/**
+ * check inflated loose content ("<type> <size>\0<content>") against its id
+ */
+inline bool __inl_verify_loose(const sign_t &sign, const std::basic_string<byte> &inflated) {
+    sha1 hasher;
+    hasher.update(inflated.data(), inflated.size());
+    sign_t computed;
+    if (hasher.final(computed) && computed == sign) {
+        return true;
+    }
+    GITFSI_METRICS_ADD(metric_counter_verify_failures, 1);
+    return false;
+}
 
 const std::string &repository::path() {
     return this->_path;
 }
 
-void repository::initialize_packs() {
+/**
+ * list packs in objects/pack
+ * Returns:
+ *      packs' signs (hex)
+ */
+std::vector<std::string> repository::__scan_packs() {
+    std::vector<std::string> result;
     std::stringstream path_builder;
     std::string packs_path(this->_path.size() + 14, 0);
     path_builder.rdbuf()->pubsetbuf(const_cast<char *>(packs_path.data()),
@@ -28,27 +134,230 @@ void repository::initialize_packs() {
     path_builder.write("/objects/pack/", 14);
 
     DIR *dir = opendir(packs_path.data());
-    dirent *ent;
+    if (dir == nullptr) {
+        return result;
+    }
 
+    dirent *ent;
     while ((ent = readdir(dir))) {
         if (ent->d_type != DT_DIR) {
-            if (strcmp(ent->d_name + 45, ".idx") != 0) { continue; }
-            std::string pack_sign(ent->d_name + 5, ent->d_name + 45);
-
-            this->_packs.push_back(pack(this->_path, pack_sign));
-            this->_packs.back().idx_init();
+            // pack-<id in hex>.idx
+            size_t name_len = 5 + this->_sign_len * 2;
+            if (strlen(ent->d_name) != name_len + 4 || strcmp(ent->d_name + name_len, ".idx") != 0) { continue; }
+            result.push_back(std::string(ent->d_name + 5, ent->d_name + name_len));
         }
     }
 
     closedir(dir);
-    free(ent);
+    return result;
+}
+
+void repository::initialize_packs() {
+    this->refresh_packs();
+}
+
+/**
+ * get pack directory's modification time
+ * Returns:
+ *      false if the directory can't be read
+ */
+inline bool __inl_packs_mtime(const std::string &path, timespec &mtime) {
+    struct stat st;
+    if (stat((path + "/objects/pack").c_str(), &st) != 0) {
+        return false;
+    }
+    mtime = st.st_mtim;
+    return true;
+}
+
+/**
+ * rescan the pack directory: added packs are loaded, removed ones are
+ * retired (freed once their last reader is done), unchanged packs keep
+ * their loaded indexes. A pack whose idx or pack can't be opened (e.g.
+ * removed by a repack mid-scan) is left out. Safe while the repository is
+ * read
+ */
+void repository::refresh_packs() {
+    std::lock_guard<std::mutex> lock(this->_packs_mutex);
+    // taken before scanning, so a change during the scan is seen next time
+    __inl_packs_mtime(this->_path, this->_packs_mtime);
+
+    std::shared_ptr<const pack_list> current = std::atomic_load(&this->_packs);
+    std::map<std::string, std::shared_ptr<pack>> loaded;
+    for (auto itr = current->begin(); itr != current->end(); itr++) {
+        loaded.insert(std::make_pair((*itr)->idx_path(), *itr));
+    }
+
+    std::shared_ptr<pack_list> refreshed = std::make_shared<pack_list>();
+    std::vector<std::string> pack_signs = this->__scan_packs();
+    for (auto itr = pack_signs.begin(); itr != pack_signs.end(); itr++) {
+        std::shared_ptr<pack> scanned = std::make_shared<pack>(this->_path, *itr, this->_sign_len);
+        auto find_result = loaded.find(scanned->idx_path());
+        if (find_result != loaded.end()) {
+            refreshed->push_back(find_result->second);
+        }
+        else if (scanned->idx_init()) {
+            refreshed->push_back(scanned);
+        }
+    }
+
+    std::atomic_store(&this->_packs, std::shared_ptr<const pack_list>(refreshed));
+}
+
+/**
+ * whether the pack directory changed since the last scan
+ */
+bool repository::__packs_changed() {
+    timespec mtime;
+    if (!__inl_packs_mtime(this->_path, mtime)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->_packs_mutex);
+    return mtime.tv_sec != this->_packs_mtime.tv_sec
+        || mtime.tv_nsec != this->_packs_mtime.tv_nsec;
+}
+
+/**
+ * refresh packs if the pack directory changed since the last scan
+ * Returns:
+ *      whether packs were refreshed
+ */
+bool repository::revalidate_packs() {
+    if (!this->__packs_changed()) {
+        return false;
+    }
+    this->refresh_packs();
+    return true;
+}
+
+/**
+ * get current packs' snapshot
+ */
+std::shared_ptr<const pack_list> repository::packs() {
+    return std::atomic_load(&this->_packs);
+}
+
+/**
+ * find the pack containing an object, packs are refreshed once on a miss
+ * if the pack directory changed (e.g. after push or repack)
+ * Args:
+ *      sign_t &sign: object's sign
+ *      std::shared_ptr<const pack_list> &packs: snapshot searched (output)
+ * Returns:
+ *      pack containing the object, nullptr if none
+ */
+std::shared_ptr<pack> repository::__find_pack(sign_t &sign,
+                                              std::shared_ptr<const pack_list> &packs) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        packs = std::atomic_load(&this->_packs);
+        for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+            if ((*itr)->sign_index().find(sign) != (*itr)->sign_index().end()) {
+                return *itr;
+            }
+        }
+        if (attempt == 0 && !this->revalidate_packs()) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * watch the pack directory with inotify and refresh packs as soon as a
+ * pack is added or removed
+ * Returns:
+ *      false if the directory can't be watched
+ */
+bool repository::watch_packs() {
+    if (this->_watcher.joinable()) {
+        return true;
+    }
+
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd == -1) {
+        return false;
+    }
+    if (inotify_add_watch(inotify_fd,
+                          (this->_path + "/objects/pack").c_str(),
+                          IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) == -1) {
+        close(inotify_fd);
+        return false;
+    }
+
+    int stop_fds[2];
+    if (pipe(stop_fds) == -1) {
+        close(inotify_fd);
+        return false;
+    }
+    this->_watcher_stop = stop_fds[1];
+    this->_watcher = std::thread(&repository::__watch, this, inotify_fd, stop_fds[0]);
+    return true;
+}
+
+/**
+ * watcher thread's loop, ends when the stop pipe is closed
+ */
+void repository::__watch(int inotify_fd, int stop_fd) {
+    alignas(inotify_event) char events[4096];
+    pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            // a signal handled by this thread isn't the end of the watch
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP)) {
+            break;
+        }
+        ssize_t len = read(inotify_fd, events, sizeof(events));
+        bool changed = false;
+        for (ssize_t off = 0; off < len; ) {
+            inotify_event *event = reinterpret_cast<inotify_event *>(events + off);
+            size_t name_len = event->len ? strlen(event->name) : 0;
+            // git writes .idx last and deletes .pack first
+            if ((name_len > 4 && strcmp(event->name + name_len - 4, ".idx") == 0)
+                || (name_len > 5 && strcmp(event->name + name_len - 5, ".pack") == 0)) {
+                changed = true;
+            }
+            off += sizeof(inotify_event) + event->len;
+        }
+        if (changed) {
+            this->refresh_packs();
+        }
+    }
+
+    close(inotify_fd);
+    close(stop_fd);
+}
+
+size_t repository::pack_count() {
+    return std::atomic_load(&this->_packs)->size();
+}
+
+/**
+ * estimate memory held by pack indexes and caches
+ */
+size_t repository::memory_usage() {
+    size_t result = 0;
+    std::shared_ptr<const pack_list> packs = std::atomic_load(&this->_packs);
+    for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+        result += (*itr)->memory_usage();
+    }
+
+    std::lock_guard<std::mutex> lock(this->_blob_classes_mutex);
+    result += this->_blob_classes.size() * (64 + sizeof(std::pair<const sign_t, blob_class>));
+    return result;
 }
 
 std::string repository::looseobj_path(sign_t sign) {
     std::stringstream obj_path_builder;
 
     std::string path(this->_path.size() +
-                     1 + 7 + 1 + 2 + 1 + 38, 0);
+                     1 + 7 + 1 + 2 + 1 + (sign.str().size() - 2), 0);
     obj_path_builder.rdbuf()
         ->pubsetbuf(const_cast<char *>(path.data()),
                     path.size());
@@ -59,38 +368,851 @@ std::string repository::looseobj_path(sign_t sign) {
     obj_path_builder.write(sign.str().data(), 2);
     obj_path_builder.put('/');
     obj_path_builder.write(sign.str().data() + 2,
-                           38);
+                           sign.str().size() - 2);
 
     return path;
 }
 
-object repository::get(sign_t sign) {
-    // determine whether the sign corresponds to loose object
+/**
+ * read loose object file (deflated)
+ * Args:
+ *      std::string &looseobj_path: loose object's path
+ * Returns:
+ *      file's content
+ */
+std::basic_string<byte> repository::__looseobj_content(std::string &looseobj_path) {
+    std::ifstream loose_file(looseobj_path, std::ios::binary);
+    if (!loose_file.is_open()) {
+        return std::basic_string<byte>();
+    }
+    loose_file.seekg(0, std::ios::end);
+    std::basic_string<byte> file_content(loose_file.tellg(), 0);
+    loose_file.seekg(0, std::ios::beg);
+
+    loose_file.read(reinterpret_cast<char *>(const_cast<unsigned char *>(file_content.data())),
+                    file_content.size());
+
+    return file_content;
+}
+
+/**
+ * (re)read one fan-out directory's ids, a missing directory has none
+ * Args:
+ *      byte dir_byte: ids' first byte
+ *      const std::string &dir_path: directory's path
+ * Returns:
+ *      directory's new snapshot
+ */
+std::shared_ptr<const __loose_names_s> repository::__load_loose_dir(byte dir_byte, const std::string &dir_path) {
+    std::shared_ptr<__loose_names_s> names = std::make_shared<__loose_names_s>();
+
+    // taken before reading, so a change during the read is seen next time
+    struct stat st;
+    if (stat(dir_path.c_str(), &st) != 0) {
+        names->mtime = { 0, 0 };
+        return names;
+    }
+    names->mtime = st.st_mtim;
+
+    DIR *dir = opendir(dir_path.c_str());
+    if (dir == nullptr) {
+        return names;
+    }
+
+    // names are the id's hex without the directory's two digits, anything
+    // else (e.g. git's tmp_obj_*) isn't an object
+    size_t name_len = 2 * this->_sign_len - 2;
+    dirent *ent;
+    arena_bytes sign_bytes;
+    while ((ent = readdir(dir))) {
+        if (ent->d_type == DT_DIR || strlen(ent->d_name) != name_len
+            || !std::all_of(ent->d_name, ent->d_name + name_len, [] (char ch) -> bool {
+                    return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f');
+                })) {
+            continue;
+        }
+        sign_bytes.assign(1, dir_byte);
+        for (const char *itr = ent->d_name; itr != ent->d_name + name_len; itr += 2) {
+            sign_bytes.push_back(__to_byte(itr));
+        }
+        names->signs.insert(sign_bytes);
+    }
+
+    closedir(dir);
+    return names;
+}
+
+/**
+ * get a fan-out directory's snapshot, only rereading it holds the
+ * directory's mutex
+ * Args:
+ *      byte dir_byte: ids' first byte
+ *      bool revalidate: reread the directory if its mtime changed
+ */
+std::shared_ptr<const __loose_names_s> repository::__loose_dir(byte dir_byte, bool revalidate) {
+    static const char hex[] = "0123456789abcdef";
+    __loose_dir_s &loose_dir = this->_loose_dirs[dir_byte];
+    std::shared_ptr<const __loose_names_s> names = std::atomic_load(&loose_dir.names);
+    std::string dir_path = this->_path + "/objects/" + hex[dir_byte >> 4] + hex[dir_byte & 0x0F];
+
+    if (names != nullptr) {
+        if (!revalidate) {
+            GITFSI_METRICS_ADD(metric_counter_loose_dirs_hits, 1);
+            return names;
+        }
+        struct stat st;
+        if (stat(dir_path.c_str(), &st) != 0) {
+            st.st_mtim = { 0, 0 };
+        }
+        if (st.st_mtim.tv_sec == names->mtime.tv_sec
+            && st.st_mtim.tv_nsec == names->mtime.tv_nsec) {
+            GITFSI_METRICS_ADD(metric_counter_loose_dirs_hits, 1);
+            return names;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(loose_dir.mutex);
+    // reread by another reader while this one waited
+    std::shared_ptr<const __loose_names_s> current = std::atomic_load(&loose_dir.names);
+    if (current != nullptr && current != names) {
+        GITFSI_METRICS_ADD(metric_counter_loose_dirs_hits, 1);
+        return current;
+    }
+    GITFSI_METRICS_ADD(metric_counter_loose_dirs_misses, 1);
+    names = this->__load_loose_dir(dir_byte, dir_path);
+    std::atomic_store(&loose_dir.names, names);
+    return names;
+}
+
+/**
+ * list loose objects, fan-out directories changed since they were cached
+ * are read again
+ * Returns:
+ *      loose objects' ids
+ */
+std::vector<sign_t> repository::loose_objects() {
+    std::vector<sign_t> result;
+
+    for (int i = 0; i < 256; i++) {
+        std::shared_ptr<const __loose_names_s> names = this->__loose_dir(byte(i), true);
+        for (auto itr = names->signs.begin(); itr != names->signs.end(); itr++) {
+            result.push_back(sign_t());
+            result.back().bytes_assign(itr->begin(), itr->end());
+        }
+    }
+    return result;
+}
+
+/**
+ * read loose object file if the fan-out directory's snapshot lists it
+ * Args:
+ *      sign_t &sign: object's sign
+ *      bool revalidate: reread the directory if its mtime changed
+ * Returns:
+ *      file's content, empty if the object isn't loose
+ */
+std::basic_string<byte> repository::__loose_content(sign_t &sign, bool revalidate) {
+    if (sign.bytes().empty()) {
+        return std::basic_string<byte>();
+    }
+
+    std::shared_ptr<const __loose_names_s> names = this->__loose_dir(sign.bytes()[0], revalidate);
+    if (names->signs.find(sign.bytes()) == names->signs.end()) {
+        return std::basic_string<byte>();
+    }
+
     std::string may_looseobj_path = this->looseobj_path(sign);
+    std::basic_string<byte> file_content = this->__looseobj_content(may_looseobj_path);
+    if (file_content.empty()) {
+        // removed since listed (e.g. pruned after packing), dropped so
+        // the next lookup rereads the directory
+        std::atomic_store(&this->_loose_dirs[sign.bytes()[0]].names,
+                          std::shared_ptr<const __loose_names_s>());
+    }
+    return file_content;
+}
 
-    if (access(may_looseobj_path.c_str(), F_OK) != -1) {
-        std::ifstream loose_file(may_looseobj_path, std::ios::binary);
-        loose_file.seekg(0, std::ios::end);
-        std::basic_string<byte> file_content(loose_file.tellg(), 0);
-        loose_file.seekg(0, std::ios::beg);
+/**
+ * locate an object: listed loose objects first, then packs, then the
+ * fan-out directory is revalidated. Packed lookups cost no syscall
+ * Args:
+ *      sign_t &sign: object's sign
+ *      std::shared_ptr<const pack_list> &packs: snapshot searched (output)
+ *      std::basic_string<byte> &loose_content: loose file's content (output)
+ * Returns:
+ *      pack containing the object, nullptr if loose (loose_content isn't
+ *      empty) or missing
+ */
+std::shared_ptr<pack> repository::__locate(sign_t &sign,
+                                           std::shared_ptr<const pack_list> &packs,
+                                           std::basic_string<byte> &loose_content) {
+    loose_content = this->__loose_content(sign, false);
+    if (!loose_content.empty()) {
+        GITFSI_METRICS_ADD(metric_counter_lookups_loose, 1);
+        return nullptr;
+    }
 
-        loose_file.read(reinterpret_cast<char *>(const_cast<unsigned char *>(file_content.data())),
-                        file_content.size());
+    std::shared_ptr<pack> found = this->__find_pack(sign, packs);
+    if (found != nullptr) {
+        GITFSI_METRICS_ADD(metric_counter_lookups_packed, 1);
+        return found;
+    }
 
-        return object(file_content);
+    loose_content = this->__loose_content(sign, true);
+    if (loose_content.empty()) {
+        GITFSI_METRICS_ADD(metric_counter_lookups_missing, 1);
+    }
+    else {
+        GITFSI_METRICS_ADD(metric_counter_lookups_loose, 1);
     }
+    return nullptr;
+}
 
-    std::vector<pack>::iterator findpack_ret =
-        std::find_if(this->_packs.begin(), this->_packs.end(),
-                     [&] (pack &_pack) -> bool { 
-                     return _pack.sign_index().find(sign) != _pack.sign_index().end();
-                     });
+object repository::get(sign_t sign) {
+    GITFSI_TRACE_SPAN(span, "repository.get");
+    GITFSI_TRACE_ARG(span, "sign", sign.str());
+    GITFSI_METRICS_START(started);
+    std::shared_ptr<const pack_list> packs;
+    std::basic_string<byte> file_content;
+    std::shared_ptr<pack> found = this->__locate(sign, packs, file_content);
 
-    if (findpack_ret == this->_packs.end()) {
-        return object();
+    if (found == nullptr) {
+        if (file_content.empty()) {
+            return object();
+        }
+        std::basic_string<byte> inflated_content = __inflate(file_content,
+                                                             file_content.size() * 2);
+        if (this->__verifying() && !__inl_verify_loose(sign, inflated_content)) {
+            return object();
+        }
+
+        GITFSI_METRICS_ELAPSED(metric_histogram_get_ns, started);
+        return object(std::move(inflated_content), this->_sign_len);
     }
 
-    return (*findpack_ret).get(this->_packs, sign);
+    object result = found->get(*packs, sign, this->__verifying());
+    GITFSI_METRICS_ELAPSED(metric_histogram_get_ns, started);
+    return result;
+}
+
+/**
+ * get object, parsed body is allocated from request's arena (the object
+ * must not outlive the arena)
+ * Args:
+ *      sign_t sign: object's sign
+ *      arena &request_arena: request's arena
+ */
+object repository::get(sign_t sign, arena &request_arena) {
+    arena_scope scope(request_arena);
+    return this->get(sign);
+}
+
+/**
+ * get many objects at once. Packed objects are read pack by pack in offset
+ * order and share resolved delta bases. Every distinct sign is delivered
+ * once, as soon as it's read; missing objects come as obj_type_unknow
+ * Args:
+ *      const std::vector<sign_t> &signs: objects' signs
+ *      std::function<void(sign_t &, object &)> callback: invoked per object
+ */
+void repository::get_many(const std::vector<sign_t> &signs,
+                          std::function<void(sign_t &, object &)> callback) {
+    GITFSI_TRACE_SPAN(span, "repository.get_many");
+    GITFSI_TRACE_ARG(span, "signs", signs.size());
+    std::vector<sign_t> distinct(signs);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+    // found packs are held, a refresh in between can't free them
+    std::shared_ptr<const pack_list> packs;
+    std::map<std::shared_ptr<pack>, std::vector<__pack_idx_s>> pack_indexes;
+    std::basic_string<byte> file_content;
+    for (auto itr = distinct.begin(); itr != distinct.end(); itr++) {
+        std::shared_ptr<pack> found = this->__locate(*itr, packs, file_content);
+        if (found == nullptr) {
+            object obj;
+            if (!file_content.empty()) {
+                std::basic_string<byte> inflated_content = __inflate(file_content,
+                                                                     file_content.size() * 2);
+                if (!this->__verifying() || __inl_verify_loose(*itr, inflated_content)) {
+                    obj = object(std::move(inflated_content), this->_sign_len);
+                }
+            }
+            callback(*itr, obj);
+            continue;
+        }
+        pack_indexes[found].push_back(found->sign_index().find(*itr)->second);
+    }
+
+    __pack_batch_s batch;
+    batch.bases_len = 0;
+    for (auto itr = pack_indexes.begin(); itr != pack_indexes.end(); itr++) {
+        itr->first->get_many(*packs, itr->second, batch, callback, this->__verifying());
+    }
+}
+
+/**
+ * get object's content without parsing it
+ * Args:
+ *      sign_t sign: object's sign
+ *      obj_type &type: object's type (output, obj_type_unknow if not found)
+ * Returns:
+ *      object's content
+ */
+/**
+ * type named in a loose object's "<type> <size>\0" header
+ */
+inline obj_type __inl_loose_type(const std::string &type_name) {
+    if (type_name == "blob") {
+        return obj_type::obj_type_blob;
+    }
+    else if (type_name == "tree") {
+        return obj_type::obj_type_tree;
+    }
+    else if (type_name == "commit") {
+        return obj_type::obj_type_commit;
+    }
+    else if (type_name == "tag") {
+        return obj_type::obj_type_tag;
+    }
+    return obj_type::obj_type_unknow;
+}
+
+std::basic_string<byte> repository::raw(sign_t sign, obj_type &type) {
+    type = obj_type::obj_type_unknow;
+
+    std::shared_ptr<const pack_list> packs;
+    std::basic_string<byte> file_content;
+    std::shared_ptr<pack> found = this->__locate(sign, packs, file_content);
+    if (found == nullptr) {
+        if (file_content.empty()) {
+            return std::basic_string<byte>();
+        }
+        std::basic_string<byte> content = __inflate(file_content, file_content.size() * 2);
+        if (this->__verifying() && !__inl_verify_loose(sign, content)) {
+            return std::basic_string<byte>();
+        }
+
+        // loose object's content starts with "<type> <size>\0"
+        auto spliter = std::find(content.begin(), content.end(), byte(0));
+        if (spliter == content.end()) {
+            return std::basic_string<byte>();
+        }
+        type = __inl_loose_type(std::string(content.begin(), std::find(content.begin(), spliter, byte(' '))));
+        content.erase(content.begin(), spliter + 1);
+        return content;
+    }
+
+    return found->raw(*packs, sign, type, this->__verifying());
+}
+
+/**
+ * get object's type and size without reading its content: a loose
+ * object's header is inflated alone, a packed one's comes from item
+ * headers. Nothing is verified
+ * Args:
+ *      sign_t sign: object's sign
+ *      obj_type &type: object's type (output, obj_type_unknow if not found)
+ * Returns:
+ *      object's size
+ */
+size_t repository::header(sign_t sign, obj_type &type) {
+    type = obj_type::obj_type_unknow;
+
+    std::shared_ptr<const pack_list> packs;
+    std::basic_string<byte> file_content;
+    std::shared_ptr<pack> found = this->__locate(sign, packs, file_content);
+    if (found != nullptr) {
+        return found->header(*packs, sign, type);
+    }
+    if (file_content.empty()) {
+        return 0;
+    }
+
+    // "<type> <size>\0", the longest being "commit " and 20 digits
+    std::basic_string<byte> content = __inflate_prefix(file_content, 32);
+    auto spliter = std::find(content.begin(), content.end(), byte(0));
+    auto space = std::find(content.begin(), spliter, byte(' '));
+    std::string size_digits(space == spliter ? spliter : space + 1, spliter);
+    if (spliter == content.end() || size_digits.empty()
+        || size_digits.find_first_not_of("0123456789") != std::string::npos) {
+        return 0;
+    }
+    type = __inl_loose_type(std::string(content.begin(), space));
+    return type == obj_type::obj_type_unknow ? 0 : std::stoull(size_digits);
+}
+
+/**
+ * count leading hex digits two ids share
+ */
+inline size_t __inl_common_nibbles(const arena_bytes &a, const arena_bytes &b) {
+    size_t result = 0;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        if (a[i] == b[i]) {
+            result += 2;
+            continue;
+        }
+        if ((a[i] >> 4) == (b[i] >> 4)) {
+            result++;
+        }
+        break;
+    }
+    return result;
+}
+
+/**
+ * collect up to two distinct objects whose id starts with hex_prefix
+ * Args:
+ *      const std::string &hex_prefix: lower case hex, at least 2 digits
+ *      std::vector<sign_t> &matches: matching signs (output)
+ */
+void repository::__abbrev_matches(const std::string &hex_prefix, std::vector<sign_t> &matches) {
+    matches.clear();
+
+    // lowest id with the prefix, an odd prefix's last digit is the high half
+    std::string low_hex(hex_prefix);
+    if (low_hex.size() % 2) {
+        low_hex.push_back('0');
+    }
+    sign_t low(low_hex);
+
+    std::shared_ptr<const pack_list> packs = std::atomic_load(&this->_packs);
+    for (auto pack_itr = packs->begin(); pack_itr != packs->end(); pack_itr++) {
+        std::map<sign_t, __pack_idx_s> &index = (*pack_itr)->sign_index();
+        for (auto itr = index.lower_bound(low);
+             itr != index.end() && __inl_common_nibbles(itr->first.bytes(), low.bytes()) >= hex_prefix.size();
+             itr++) {
+            if (std::find(matches.begin(), matches.end(), itr->first) == matches.end()) {
+                matches.push_back(itr->first);
+            }
+            if (matches.size() > 1) {
+                return;
+            }
+        }
+    }
+
+    std::shared_ptr<const __loose_names_s> names = this->__loose_dir(low.bytes()[0], true);
+    for (auto itr = names->signs.lower_bound(low.bytes());
+         itr != names->signs.end() && __inl_common_nibbles(*itr, low.bytes()) >= hex_prefix.size();
+         itr++) {
+        sign_t loose;
+        loose.bytes_assign(itr->begin(), itr->end());
+        if (std::find(matches.begin(), matches.end(), loose) == matches.end()) {
+            matches.push_back(loose);
+        }
+        if (matches.size() > 1) {
+            return;
+        }
+    }
+}
+
+/**
+ * resolve an abbreviated id against packs' sorted indexes and loose
+ * objects' directories
+ * Args:
+ *      const std::string &hex_prefix: ABBREV_MIN_LEN to full id's hex digits
+ *      sign_t &sign: object's sign (output, set if found)
+ * Returns:
+ *      abbrev_status_ambiguous if more than one object matches
+ */
+abbrev_status repository::resolve_abbrev(const std::string &hex_prefix, sign_t &sign) {
+    if (hex_prefix.size() < ABBREV_MIN_LEN || hex_prefix.size() > this->_sign_len * 2) {
+        return abbrev_status::abbrev_status_invalid;
+    }
+    std::string hex(hex_prefix);
+    for (auto itr = hex.begin(); itr != hex.end(); itr++) {
+        if ('A' <= *itr && *itr <= 'F') {
+            *itr += 'a' - 'A';
+        }
+        if (!(('0' <= *itr && *itr <= '9') || ('a' <= *itr && *itr <= 'f'))) {
+            return abbrev_status::abbrev_status_invalid;
+        }
+    }
+
+    std::vector<sign_t> matches;
+    this->__abbrev_matches(hex, matches);
+    if (matches.empty() && this->revalidate_packs()) {
+        this->__abbrev_matches(hex, matches);
+    }
+
+    if (matches.empty()) {
+        return abbrev_status::abbrev_status_missing;
+    }
+    if (matches.size() > 1) {
+        return abbrev_status::abbrev_status_ambiguous;
+    }
+    sign = matches.front();
+    return abbrev_status::abbrev_status_found;
+}
+
+/**
+ * shortest unique abbreviation, from the ids sorted around sign
+ * Args:
+ *      sign_t &sign: object's sign
+ *      const pack_list &packs: packs' snapshot
+ *      size_t min_len: shortest abbreviation returned
+ */
+std::string repository::__abbrev(sign_t &sign, const pack_list &packs, size_t min_len) {
+    if (sign.bytes().empty()) {
+        return std::string();
+    }
+
+    size_t common = 0;
+    for (auto pack_itr = packs.begin(); pack_itr != packs.end(); pack_itr++) {
+        std::map<sign_t, __pack_idx_s> &index = (*pack_itr)->sign_index();
+        auto itr = index.upper_bound(sign);
+        if (itr != index.end()) {
+            common = std::max(common, __inl_common_nibbles(itr->first.bytes(), sign.bytes()));
+        }
+        itr = index.lower_bound(sign);
+        if (itr != index.begin()) {
+            itr--;
+            common = std::max(common, __inl_common_nibbles(itr->first.bytes(), sign.bytes()));
+        }
+    }
+
+    std::shared_ptr<const __loose_names_s> names = this->__loose_dir(sign.bytes()[0], false);
+    auto itr = names->signs.upper_bound(sign.bytes());
+    if (itr != names->signs.end()) {
+        common = std::max(common, __inl_common_nibbles(*itr, sign.bytes()));
+    }
+    itr = names->signs.lower_bound(sign.bytes());
+    if (itr != names->signs.begin()) {
+        itr--;
+        common = std::max(common, __inl_common_nibbles(*itr, sign.bytes()));
+    }
+
+    std::string &hex = sign.str();
+
+    return hex.substr(0, std::min(hex.size(), std::max(common + 1, min_len)));
+}
+
+/**
+ * shortest abbreviation no other object in the repository shares
+ * Args:
+ *      sign_t sign: object's sign
+ *      size_t min_len: shortest abbreviation returned
+ */
+std::string repository::abbrev(sign_t sign, size_t min_len) {
+    std::shared_ptr<const pack_list> packs = std::atomic_load(&this->_packs);
+    return this->__abbrev(sign, *packs, min_len);
+}
+
+/**
+ * abbreviate many ids (e.g. a rendered commit list) against one packs'
+ * snapshot
+ * Args:
+ *      const std::vector<sign_t> &signs: objects' signs
+ *      size_t min_len: shortest abbreviation returned
+ * Returns:
+ *      abbreviations in signs' order
+ */
+std::vector<std::string> repository::abbrev_many(const std::vector<sign_t> &signs,
+                                                 size_t min_len) {
+    std::shared_ptr<const pack_list> packs = std::atomic_load(&this->_packs);
+    std::vector<std::string> result;
+    result.reserve(signs.size());
+    for (auto itr = signs.begin(); itr != signs.end(); itr++) {
+        sign_t sign(*itr);
+        result.push_back(this->__abbrev(sign, *packs, min_len));
+    }
+    return result;
+}
+
+/**
+ * find the entry at path under a tree
+ * Args:
+ *      sign_t tree_sign: root tree's sign
+ *      const std::string &path: '/' separated path
+ *      obj_type &type: entry's type (output)
+ * Returns:
+ *      entry's sign, empty sign if not found
+ */
+sign_t repository::lookup(sign_t tree_sign, const std::string &path, obj_type &type) {
+    type = obj_type::obj_type_tree;
+    sign_t sign = tree_sign;
+
+    size_t begin = 0;
+    while (begin < path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end == begin) {
+            begin++;
+            continue;
+        }
+        if (type != obj_type::obj_type_tree) {
+            return sign_t();
+        }
+
+        object obj = this->get(sign);
+        if (obj.type() != obj_type::obj_type_tree) {
+            return sign_t();
+        }
+
+        tree_items &items = obj.get<tree>().items();
+        auto item = std::find_if(items.begin(),
+                                 items.end(),
+                                 [&] (tree_item &item) -> bool {
+                                    return item.name().compare(0, std::string::npos,
+                                                               path, begin, end - begin) == 0;
+                                 });
+        if (item == items.end()) {
+            return sign_t();
+        }
+
+        sign = item->sign();
+        type = item->type();
+        begin = end + 1;
+    }
+
+    return sign;
+}
+
+/**
+ * whether name is a ref repository's files may be read for: "refs/..."
+ * or an upper case root ref (HEAD, FETCH_HEAD...), never leaving the
+ * repository's directory
+ */
+inline bool __inl_ref_name_safe(const std::string &name) {
+    if (name.compare(0, 5, "refs/") != 0) {
+        return !name.empty()
+            && std::all_of(name.begin(), name.end(), [] (char ch) -> bool {
+                    return ('A' <= ch && ch <= 'Z') || ch == '_';
+               });
+    }
+    if (name.find("..") != std::string::npos
+        || name.find("//") != std::string::npos
+        || name.back() == '/') {
+        return false;
+    }
+    return std::none_of(name.begin(), name.end(), [] (char ch) -> bool {
+                return uint8_t(ch) < 0x20 || ch == '\\' || ch == 0x7F;
+           });
+}
+
+/**
+ * parse packed-refs again if it changed since the last read, the caller
+ * holds _packed_refs_mutex
+ */
+void repository::__load_packed_refs() {
+    std::string packed_refs_path = this->_path + "/packed-refs";
+
+    struct stat st;
+    if (stat(packed_refs_path.c_str(), &st) != 0) {
+        st.st_mtim = { 0, 0 };
+    }
+    if (st.st_mtim.tv_sec != this->_packed_refs_mtime.tv_sec
+        || st.st_mtim.tv_nsec != this->_packed_refs_mtime.tv_nsec) {
+        this->_packed_refs.clear();
+        this->_packed_refs_mtime = st.st_mtim;
+
+        // "<id> <name>" lines, '#' starts a header and '^' a peeled tag
+        std::ifstream packed_refs_file(packed_refs_path);
+        std::string line;
+        while (std::getline(packed_refs_file, line)) {
+            size_t hex_len = this->_sign_len * 2;
+            if (line.size() > hex_len + 1 && line[hex_len] == ' ' && line[0] != '#' && line[0] != '^') {
+                this->_packed_refs[line.substr(hex_len + 1)] = sign_t(line.substr(0, hex_len));
+            }
+        }
+    }
+}
+
+/**
+ * find a ref in packed-refs, the file is parsed again only after it changed
+ * Args:
+ *      const std::string &name: ref's full name
+ *      sign_t &sign: ref's target (output)
+ * Returns:
+ *      false if packed-refs doesn't have the ref
+ */
+bool repository::__packed_ref(const std::string &name, sign_t &sign) {
+    std::lock_guard<std::mutex> lock(this->_packed_refs_mutex);
+    this->__load_packed_refs();
+
+    auto find_result = this->_packed_refs.find(name);
+    if (find_result == this->_packed_refs.end()) {
+        return false;
+    }
+    sign = find_result->second;
+    return true;
+}
+
+/**
+ * resolve a ref's full name (HEAD, refs/heads/main...), symbolic refs are
+ * followed, loose refs take precedence over packed-refs
+ * Args:
+ *      const std::string &name: ref's full name
+ * Returns:
+ *      ref's target, empty sign if the ref doesn't exist
+ */
+sign_t repository::resolve_ref(const std::string &name) {
+    std::string ref_name(name);
+    // git gives up following symbolic refs at the same depth
+    for (int depth = 0; depth < 5; depth++) {
+        if (!__inl_ref_name_safe(ref_name)) {
+            return sign_t();
+        }
+
+        std::ifstream ref_file(this->_path + "/" + ref_name);
+        std::string line;
+        if (std::getline(ref_file, line)) {
+            if (line.compare(0, 5, "ref: ") == 0) {
+                ref_name = line.substr(5);
+                continue;
+            }
+            size_t hex_len = this->_sign_len * 2;
+            if (line.size() >= hex_len
+                && std::all_of(line.begin(), line.begin() + hex_len, [] (char ch) -> bool {
+                        return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f');
+                   })) {
+                return sign_t(line.substr(0, hex_len));
+            }
+            return sign_t();
+        }
+
+        sign_t sign;
+        if (this->__packed_ref(ref_name, sign)) {
+            return sign;
+        }
+        return sign_t();
+    }
+    return sign_t();
+}
+
+/**
+ * list every ref (loose refs take precedence over packed-refs) and HEAD,
+ * symbolic refs are resolved
+ * Returns:
+ *      refs' full names and targets
+ */
+std::map<std::string, sign_t> repository::refs() {
+    std::map<std::string, sign_t> result;
+    {
+        std::lock_guard<std::mutex> lock(this->_packed_refs_mutex);
+        this->__load_packed_refs();
+        result = this->_packed_refs;
+    }
+
+    std::vector<std::string> dirs(1, "refs");
+    while (!dirs.empty()) {
+        std::string dir_name = dirs.back();
+        dirs.pop_back();
+
+        DIR *dir = opendir((this->_path + "/" + dir_name).c_str());
+        if (dir == nullptr) {
+            continue;
+        }
+        for (dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            std::string ref_name = dir_name + "/" + entry->d_name;
+            struct stat st;
+            if (stat((this->_path + "/" + ref_name).c_str(), &st) != 0) {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                dirs.push_back(ref_name);
+                continue;
+            }
+            sign_t sign = this->resolve_ref(ref_name);
+            if (!sign.bytes().empty()) {
+                result[ref_name] = sign;
+            }
+        }
+        closedir(dir);
+    }
+
+    sign_t head = this->resolve_ref("HEAD");
+    if (!head.bytes().empty()) {
+        result["HEAD"] = head;
+    }
+    return result;
+}
+
+/**
+ * classify blob as text or binary, only the leading BLOB_SNIFF_LEN bytes
+ * are inflated (unless the blob is deltified), results are cached
+ * Args:
+ *      sign_t sign: blob's sign
+ * Returns:
+ *      blob_class_unknow if sign isn't a blob
+ */
+blob_class repository::classify(sign_t sign) {
+    {
+        std::lock_guard<std::mutex> lock(this->_blob_classes_mutex);
+        auto find_result = this->_blob_classes.find(sign);
+        if (find_result != this->_blob_classes.end()) {
+            GITFSI_METRICS_ADD(metric_counter_blob_classes_hits, 1);
+            return find_result->second;
+        }
+    }
+    GITFSI_METRICS_ADD(metric_counter_blob_classes_misses, 1);
+
+    obj_type type = obj_type::obj_type_unknow;
+    std::basic_string<byte> content;
+
+    std::shared_ptr<const pack_list> packs;
+    std::basic_string<byte> file_content;
+    std::shared_ptr<pack> found = this->__locate(sign, packs, file_content);
+    if (found == nullptr && !file_content.empty()) {
+        // loose object's content starts with "<type> <size>\0"
+        content = __inflate_prefix(file_content, BLOB_SNIFF_LEN + 32);
+
+        auto spliter = std::find(content.begin(), content.end(), byte(0));
+        if (spliter != content.end()
+            && std::string(content.begin(), std::find(content.begin(), spliter, byte(' '))) == "blob") {
+            type = obj_type::obj_type_blob;
+            content.erase(content.begin(), spliter + 1);
+        }
+    }
+    else if (found != nullptr) {
+        content = found->prefix(*packs, sign, BLOB_SNIFF_LEN, type);
+    }
+
+    if (type != obj_type::obj_type_blob) {
+        return blob_class::blob_class_unknow;
+    }
+
+    blob_class result = classify_content(content.data(), content.data() + content.size());
+
+    std::lock_guard<std::mutex> lock(this->_blob_classes_mutex);
+    this->_blob_classes[sign] = result;
+    return result;
+}
+
+/**
+ * classify every blob of a tree concurrently
+ * Args:
+ *      sign_t tree_sign: tree's sign
+ *      unsigned threads: threads count (0 for hardware concurrency)
+ * Returns:
+ *      tree's items and their classes (blob_class_unknow for non-blob items)
+ */
+std::vector<std::pair<tree_item, blob_class>> repository::classify_tree(sign_t tree_sign,
+                                                                        unsigned threads) {
+    std::vector<std::pair<tree_item, blob_class>> result;
+
+    object obj = this->get(tree_sign);
+    if (obj.type() != obj_type::obj_type_tree) {
+        return result;
+    }
+
+    tree_items &items = obj.get<tree>().items();
+    for (auto itr = items.begin(); itr != items.end(); itr++) {
+        result.push_back(std::make_pair(*itr, blob_class::blob_class_unknow));
+    }
+
+    __parallel_for(result.size(), threads, [&] (size_t i) -> void {
+        if (result[i].first.type() == obj_type::obj_type_blob) {
+            result[i].second = this->classify(result[i].first.sign());
+        }
+    });
+
+    return result;
 }
 
 }
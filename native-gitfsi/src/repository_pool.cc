@@ -0,0 +1,158 @@
+#include "repository_pool.h"
+#include "metrics.h"
+#include <unistd.h>
+
+namespace gitter_kid {
+namespace fsi {
+
+repository_pool::repository_pool(size_t max_repositories,
+                                 size_t max_memory,
+                                 size_t max_packs)
+    : _max_repositories(max_repositories)
+    , _max_memory(max_memory)
+    , _max_packs(max_packs)
+    , _memory(0)
+    , _packs(0) {}
+
+size_t &repository_pool::max_repositories() {
+    return this->_max_repositories;
+}
+
+size_t &repository_pool::max_memory() {
+    return this->_max_memory;
+}
+
+size_t &repository_pool::max_packs() {
+    return this->_max_packs;
+}
+
+/**
+ * refresh entry's share of the pool's memory and packs
+ */
+void repository_pool::__account(__pool_entry_s &entry) {
+    this->_memory -= entry.memory;
+    this->_packs -= entry.packs;
+    entry.memory = entry.repo->memory_usage();
+    entry.packs = entry.repo->pack_count();
+    this->_memory += entry.memory;
+    this->_packs += entry.packs;
+}
+
+/**
+ * drop least recently used repositories until the pool fits its budget
+ * Args:
+ *      const std::string &keep: repository never dropped (just used)
+ */
+void repository_pool::__evict(const std::string &keep) {
+    while (!this->_lru.empty()
+           && (this->_entries.size() > this->_max_repositories
+               || this->_memory > this->_max_memory
+               || this->_packs > this->_max_packs)) {
+        std::string &victim = this->_lru.back();
+        if (victim == keep) {
+            break;
+        }
+
+        auto entry = this->_entries.find(victim);
+        this->_memory -= entry->second.memory;
+        this->_packs -= entry->second.packs;
+        this->_entries.erase(entry);
+        this->_lru.pop_back();
+    }
+}
+
+/**
+ * get the repository at path, opening it on first use. A repository whose
+ * pack directory changed is refreshed (only added packs are loaded)
+ * Args:
+ *      const std::string &path: repository's path
+ * Returns:
+ *      repository, nullptr if path isn't a repository
+ */
+std::shared_ptr<repository> repository_pool::get(const std::string &path) {
+    if (access((path + "/objects/pack").c_str(), R_OK) == -1) {
+        return nullptr;
+    }
+
+    std::shared_ptr<repository> repo;
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        auto find_result = this->_entries.find(path);
+        if (find_result != this->_entries.end()) {
+            this->_lru.splice(this->_lru.begin(), this->_lru, find_result->second.lru);
+            repo = find_result->second.repo;
+        }
+    }
+
+    // index loading happens outside the lock
+    if (repo != nullptr) {
+        GITFSI_METRICS_ADD(metric_counter_pool_hits, 1);
+        if (repo->revalidate_packs()) {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            auto find_result = this->_entries.find(path);
+            if (find_result != this->_entries.end() && find_result->second.repo == repo) {
+                this->__account(find_result->second);
+                this->__evict(path);
+            }
+        }
+        return repo;
+    }
+
+    GITFSI_METRICS_ADD(metric_counter_pool_misses, 1);
+    repo.reset(new repository(path));
+    repo->initialize_packs();
+
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto find_result = this->_entries.find(path);
+    if (find_result != this->_entries.end()) {
+        // opened concurrently by someone else
+        return find_result->second.repo;
+    }
+
+    this->_lru.push_front(path);
+    __pool_entry_s &entry = this->_entries[path];
+    entry.repo = repo;
+    entry.lru = this->_lru.begin();
+    entry.memory = 0;
+    entry.packs = 0;
+    this->__account(entry);
+    this->__evict(path);
+
+    return repo;
+}
+
+/**
+ * forget a repository (e.g. deleted), current holders keep their handle
+ */
+void repository_pool::remove(const std::string &path) {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto find_result = this->_entries.find(path);
+    if (find_result == this->_entries.end()) {
+        return;
+    }
+    this->_memory -= find_result->second.memory;
+    this->_packs -= find_result->second.packs;
+    this->_lru.erase(find_result->second.lru);
+    this->_entries.erase(find_result);
+}
+
+size_t repository_pool::size() {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_entries.size();
+}
+
+size_t repository_pool::memory() {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_memory;
+}
+
+/**
+ * process-wide pool
+ */
+repository_pool &repository_pool::global() {
+    static repository_pool pool;
+    return pool;
+}
+
+}
+}
@@ -0,0 +1,238 @@
+#include "revparse.h"
+#include "commit.h"
+#include "tag.h"
+#include <algorithm>
+
+namespace gitter_kid {
+namespace fsi {
+
+// a ref named <name> is looked for as <prefix><name><suffix>, in order
+const char *const __REVPARSE_REF_RULES[][2] = {
+    { "", "" },
+    { "refs/", "" },
+    { "refs/tags/", "" },
+    { "refs/heads/", "" },
+    { "refs/remotes/", "" },
+    { "refs/remotes/", "/HEAD" }
+};
+
+// tags pointing to tags are followed at most this deep
+const int __REVPARSE_PEEL_MAX = 64;
+
+revparse::revparse(repository &repo)
+    : _repo(repo)
+    , _type(obj_type::obj_type_unknow)
+    , _loaded(false) {}
+
+void revparse::__set(sign_t sign, obj_type type) {
+    this->_sign = sign;
+    this->_type = type;
+    this->_loaded = false;
+}
+
+/**
+ * read current object if it isn't read yet. The type a tag or a commit
+ * claimed is replaced by the object's own
+ * Args:
+ *      obj_type expected: type about to be accessed, obj_type_unknow for any
+ * Returns:
+ *      false if the object doesn't exist or isn't of expected type
+ */
+bool revparse::__load(obj_type expected) {
+    if (!this->_loaded) {
+        this->_obj = this->_repo.get(this->_sign);
+        this->_type = this->_obj.type();
+        this->_loaded = true;
+    }
+    return this->_type != obj_type::obj_type_unknow
+        && (expected == obj_type::obj_type_unknow || this->_type == expected);
+}
+
+/**
+ * resolve the expression's leading id or ref name
+ * Args:
+ *      const std::string &name: full id, ref name or abbreviated id
+ * Returns:
+ *      false if nothing is named so
+ */
+bool revparse::__base(const std::string &name) {
+    if (name.empty()) {
+        return false;
+    }
+    if (name.size() == this->_repo.sign_len() * 2
+        && std::all_of(name.begin(), name.end(), [] (char ch) -> bool {
+                return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f');
+           })) {
+        this->__set(sign_t(name), obj_type::obj_type_unknow);
+        return true;
+    }
+
+    for (auto rule = std::begin(__REVPARSE_REF_RULES); rule != std::end(__REVPARSE_REF_RULES); rule++) {
+        sign_t sign = this->_repo.resolve_ref((*rule)[0] + name + (*rule)[1]);
+        if (!sign.bytes().empty()) {
+            this->__set(sign, obj_type::obj_type_unknow);
+            return true;
+        }
+    }
+
+    sign_t sign;
+    if (this->_repo.resolve_abbrev(name, sign) == abbrev_status::abbrev_status_found) {
+        this->__set(sign, obj_type::obj_type_unknow);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * peel tags until an object of target type, a commit peels to its tree
+ * Args:
+ *      obj_type target: wanted type, obj_type_unknow for the first non-tag
+ * Returns:
+ *      false if there's no such object
+ */
+bool revparse::__peel(obj_type target) {
+    for (int depth = 0; depth < __REVPARSE_PEEL_MAX; depth++) {
+        // a type known from a tag or a commit saves reading the object
+        if (this->_type == target && target != obj_type::obj_type_unknow) {
+            return true;
+        }
+        if (!this->__load()) {
+            return false;
+        }
+
+        if (this->_type == obj_type::obj_type_tag && target != obj_type::obj_type_tag) {
+            tag_body &body = this->_obj.get<tag>().get();
+            this->__set(sign_t(body.obj_sign()), body.type());
+        }
+        else if (this->_type == target || target == obj_type::obj_type_unknow) {
+            return true;
+        }
+        else if (this->_type == obj_type::obj_type_commit && target == obj_type::obj_type_tree) {
+            this->__set(sign_t(this->_obj.get<commit>().body().tree_sign()), obj_type::obj_type_tree);
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * move to current commit's nth parent (the commit itself for 0)
+ */
+bool revparse::__parent(size_t nth) {
+    if (!this->__peel(obj_type::obj_type_commit)) {
+        return false;
+    }
+    if (nth == 0) {
+        return true;
+    }
+    // a tag or a child may have claimed a commit that isn't one
+    if (!this->__load(obj_type::obj_type_commit)) {
+        return false;
+    }
+
+    commit_parents &parents = this->_obj.get<commit>().body().parents();
+    if (nth > parents.size()) {
+        return false;
+    }
+    this->__set(parents[nth - 1], obj_type::obj_type_commit);
+    return true;
+}
+
+/**
+ * resolve a revision expression
+ * Args:
+ *      const std::string &rev: revision expression
+ *      obj_type &type: resolved object's type (output)
+ * Returns:
+ *      resolved object's sign, empty sign if rev is malformed or names
+ *      nothing
+ */
+sign_t revparse::resolve(const std::string &rev, obj_type &type) {
+    type = obj_type::obj_type_unknow;
+
+    size_t colon = rev.find(':');
+    std::string expr = rev.substr(0, colon);
+    size_t pos = std::min(expr.find_first_of("~^"), expr.size());
+    if (!this->__base(expr.substr(0, pos))) {
+        return sign_t();
+    }
+
+    while (pos < expr.size()) {
+        char op = expr[pos++];
+
+        if (op == '^' && pos < expr.size() && expr[pos] == '{') {
+            size_t close = expr.find('}', pos);
+            if (close == std::string::npos) {
+                return sign_t();
+            }
+            std::string target_name = expr.substr(pos + 1, close - pos - 1);
+            pos = close + 1;
+
+            obj_type target;
+            if (target_name.empty()) {
+                target = obj_type::obj_type_unknow;
+            }
+            else if (target_name == "commit") {
+                target = obj_type::obj_type_commit;
+            }
+            else if (target_name == "tree") {
+                target = obj_type::obj_type_tree;
+            }
+            else if (target_name == "blob") {
+                target = obj_type::obj_type_blob;
+            }
+            else if (target_name == "tag") {
+                target = obj_type::obj_type_tag;
+            }
+            else {
+                return sign_t();
+            }
+            if (!this->__peel(target)) {
+                return sign_t();
+            }
+            continue;
+        }
+
+        size_t digits_end = std::min(expr.find_first_not_of("0123456789", pos), expr.size());
+        // longer counts can't be meant (and would overflow)
+        if (digits_end - pos > 9) {
+            return sign_t();
+        }
+        size_t count = digits_end == pos ? 1 : std::stoul(expr.substr(pos, digits_end - pos));
+        pos = digits_end;
+
+        if (op == '~') {
+            for (size_t i = 0; i < count; i++) {
+                if (!this->__parent(1)) {
+                    return sign_t();
+                }
+            }
+        }
+        else if (!this->__parent(count)) {
+            return sign_t();
+        }
+    }
+
+    if (colon != std::string::npos) {
+        if (!this->__peel(obj_type::obj_type_tree)) {
+            return sign_t();
+        }
+        sign_t sign = this->_repo.lookup(this->_sign, rev.substr(colon + 1), type);
+        if (sign.bytes().empty()) {
+            type = obj_type::obj_type_unknow;
+        }
+        return sign;
+    }
+
+    if (this->_type == obj_type::obj_type_unknow && !this->__load()) {
+        return sign_t();
+    }
+    type = this->_type;
+    return this->_sign;
+}
+
+}
+}
@@ -0,0 +1,195 @@
+#include "revwalk.h"
+#include "tree.h"
+#include <algorithm>
+
+namespace gitter_kid {
+namespace fsi {
+
+// path components cache is dropped once it grows beyond this
+const size_t __REVWALK_COMPONENTS_MAX = 65536;
+
+revwalk::revwalk(repository &repo)
+    : _repo(repo) {}
+
+/**
+ * limit the walk to commits touching path, must be set before push
+ * Args:
+ *      const std::string &path: '/' separated path, empty for no limit
+ */
+void revwalk::path(const std::string &path) {
+    this->_path.clear();
+    this->_components.clear();
+
+    size_t begin = 0;
+    while (begin < path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end != begin) {
+            this->_path.push_back(path.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+}
+
+bool revwalk::__load(sign_t &sign, commit_body &body) {
+    object obj = this->_repo.get(sign);
+    if (obj.type() != obj_type::obj_type_commit) {
+        return false;
+    }
+    body = obj.get<commit>().body();
+    return true;
+}
+
+void revwalk::__enqueue(sign_t &sign, commit_body &body) {
+    if (!this->_seen.insert(sign).second) {
+        return;
+    }
+    this->_pending[sign] = body;
+    this->_queue.push(std::make_pair(body.committer().timestamp(), sign));
+}
+
+/**
+ * find path's depth-th component in a tree, every tree is read at most
+ * once per walk
+ * Args:
+ *      size_t depth: component's index
+ *      sign_t &tree_sign: tree containing the component
+ * Returns:
+ *      component's sign, empty sign if not found
+ */
+sign_t revwalk::__component(size_t depth, sign_t &tree_sign) {
+    std::pair<size_t, sign_t> key(depth, tree_sign);
+    auto find_result = this->_components.find(key);
+    if (find_result != this->_components.end()) {
+        return find_result->second;
+    }
+
+    sign_t result;
+    object obj = this->_repo.get(tree_sign);
+    if (obj.type() == obj_type::obj_type_tree) {
+        tree_items &items = obj.get<tree>().items();
+        auto item = std::find_if(items.begin(),
+                                 items.end(),
+                                 [&] (tree_item &item) -> bool {
+                                    return item.name() == this->_path[depth];
+                                 });
+        if (item != items.end()) {
+            result = item->sign();
+        }
+    }
+
+    if (this->_components.size() >= __REVWALK_COMPONENTS_MAX) {
+        this->_components.clear();
+    }
+    this->_components.insert(std::make_pair(key, result));
+    return result;
+}
+
+/**
+ * compare path between two commits, tree signs along the path are
+ * compared from the root and the first identical subtree ends the walk
+ * Args:
+ *      commit_body &a: commit
+ *      commit_body &b: other commit
+ * Returns:
+ *      whether path is identical (or missing in both)
+ */
+bool revwalk::__treesame(commit_body &a, commit_body &b) {
+    sign_t a_sign(a.tree_sign());
+    sign_t b_sign(b.tree_sign());
+
+    for (size_t depth = 0; depth < this->_path.size(); depth++) {
+        if (a_sign == b_sign) {
+            return true;
+        }
+        if (a_sign.bytes().empty() || b_sign.bytes().empty()) {
+            return false;
+        }
+        a_sign = this->__component(depth, a_sign);
+        b_sign = this->__component(depth, b_sign);
+    }
+
+    return a_sign == b_sign;
+}
+
+bool revwalk::__path_exists(commit_body &body) {
+    sign_t sign(body.tree_sign());
+    for (size_t depth = 0; depth < this->_path.size() && !sign.bytes().empty(); depth++) {
+        sign = this->__component(depth, sign);
+    }
+    return !sign.bytes().empty();
+}
+
+void revwalk::push(sign_t sign) {
+    commit_body body;
+    if (this->__load(sign, body)) {
+        this->__enqueue(sign, body);
+    }
+}
+
+/**
+ * get next commit (newest committer date first). With a path limit only
+ * commits changing path are returned, and history is simplified: a commit
+ * identical to one of its parents at path follows only that parent
+ * Args:
+ *      sign_t &sign: commit's sign (output)
+ *      commit_body &body: commit's body (output)
+ * Returns:
+ *      false if the walk is over
+ */
+bool revwalk::next(sign_t &sign, commit_body &body) {
+    while (!this->_queue.empty()) {
+        sign_t current_sign = this->_queue.top().second;
+        this->_queue.pop();
+
+        auto pending = this->_pending.find(current_sign);
+        commit_body current = pending->second;
+        this->_pending.erase(pending);
+
+        bool interesting = true;
+        if (!this->_path.empty()) {
+            std::vector<std::pair<sign_t, commit_body>> parents;
+            for (auto itr = current.parents().begin(); itr != current.parents().end(); itr++) {
+                commit_body parent;
+                if (!this->__load(*itr, parent)) {
+                    continue;
+                }
+                if (this->__treesame(current, parent)) {
+                    parents.clear();
+                    parents.push_back(std::make_pair(*itr, parent));
+                    interesting = false;
+                    break;
+                }
+                parents.push_back(std::make_pair(*itr, parent));
+            }
+
+            if (current.parents().empty()) {
+                interesting = this->__path_exists(current);
+            }
+            for (auto itr = parents.begin(); itr != parents.end(); itr++) {
+                this->__enqueue(itr->first, itr->second);
+            }
+        }
+        else {
+            for (auto itr = current.parents().begin(); itr != current.parents().end(); itr++) {
+                commit_body parent;
+                if (this->__load(*itr, parent)) {
+                    this->__enqueue(*itr, parent);
+                }
+            }
+        }
+
+        if (interesting) {
+            sign = current_sign;
+            body = current;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
+}
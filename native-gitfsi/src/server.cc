@@ -0,0 +1,317 @@
+#include "server.h"
+#include "object.h"
+#include "revparse.h"
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+
+namespace gitter_kid {
+namespace fsi {
+
+// responses are flushed once this much is buffered
+const size_t __SERVER_WRITE_BUFFER = 64 * 1024;
+
+inline const char *__inl_type_name(obj_type type) {
+    switch (type) {
+    case obj_type::obj_type_blob:
+        return "blob";
+    case obj_type::obj_type_tree:
+        return "tree";
+    case obj_type::obj_type_commit:
+        return "commit";
+    case obj_type::obj_type_tag:
+        return "tag";
+    default:
+        return "unknow";
+    }
+}
+
+/**
+ * parse a full hex id
+ * Args:
+ *      const std::string &hex: hex string
+ *      sign_t &sign: parsed sign (output)
+ * Returns:
+ *      false if hex isn't a full id (SHA-1 or SHA-256)
+ */
+inline bool __inl_parse_sign(const std::string &hex, sign_t &sign) {
+    if (hex.size() != 2 * SIGN_SHA1_LEN && hex.size() != 2 * SIGN_SHA256_LEN) {
+        return false;
+    }
+    for (auto itr = hex.begin(); itr != hex.end(); itr++) {
+        if (!(('0' <= *itr && *itr <= '9') || ('a' <= *itr && *itr <= 'f'))) {
+            return false;
+        }
+    }
+    sign.str_assign(hex.begin(), hex.end());
+    return true;
+}
+
+/**
+ * resolve a request's object argument, full ids skip revision parsing
+ * Args:
+ *      repository &repo: requested repository
+ *      const std::string &rev: full id or revision expression
+ *      sign_t &sign: resolved sign (output)
+ * Returns:
+ *      false if rev names nothing
+ */
+inline bool __inl_resolve_sign(repository &repo, const std::string &rev, sign_t &sign) {
+    if (rev.size() == 2 * repo.sign_len() && __inl_parse_sign(rev, sign)) {
+        return true;
+    }
+    obj_type type;
+    sign = revparse(repo).resolve(rev, type);
+    return !sign.bytes().empty();
+}
+
+/**
+ * register a repository, the first one is used by requests without @<repo>
+ * Args:
+ *      const std::string &name: repository's name in requests
+ *      const std::string &path: repository's path (.git directory)
+ */
+void server::add(const std::string &name, const std::string &path) {
+    std::unique_ptr<repository> repo(new repository(path));
+    repo->initialize_packs();
+
+    if (this->_repositories.empty()) {
+        this->_default_repository = name;
+    }
+    this->_repositories[name] = std::move(repo);
+}
+
+repository *server::__repository(const std::string &name) {
+    auto find_result = this->_repositories.find(name.empty() ? this->_default_repository : name);
+    if (find_result == this->_repositories.end()) {
+        return nullptr;
+    }
+    return find_result->second.get();
+}
+
+std::string server::__info(repository &repo, const std::string &argument, bool with_content) {
+    sign_t sign;
+    if (!__inl_resolve_sign(repo, argument, sign)) {
+        return "missing " + argument + "\n";
+    }
+
+    obj_type type;
+    std::basic_string<byte> content;
+    size_t size;
+    if (with_content) {
+        content = repo.raw(sign, type);
+        size = content.size();
+    }
+    else {
+        // from headers, the content isn't inflated
+        size = repo.header(sign, type);
+    }
+    if (type == obj_type::obj_type_unknow) {
+        return "missing " + argument + "\n";
+    }
+
+    std::string result = "ok " + sign.str() + " " + __inl_type_name(type) + " "
+        + std::to_string(size) + "\n";
+    result.append(content.begin(), content.end());
+    return result;
+}
+
+std::string server::__tree(repository &repo, const std::string &argument) {
+    sign_t sign;
+    if (!__inl_resolve_sign(repo, argument, sign)) {
+        return "missing " + argument + "\n";
+    }
+
+    object obj = repo.get(sign);
+    if (obj.type() != obj_type::obj_type_tree) {
+        return "missing " + argument + "\n";
+    }
+
+    tree_items &items = obj.get<tree>().items();
+    std::string result = "ok " + sign.str() + " tree " + std::to_string(items.size()) + "\n";
+    for (auto itr = items.begin(); itr != items.end(); itr++) {
+        result.append(__inl_type_name(itr->type()));
+        result.push_back(' ');
+        result.append(itr->sign().str());
+        result.push_back('\t');
+        result.append(itr->name());
+        result.push_back('\n');
+    }
+    return result;
+}
+
+std::string server::__resolve(repository &repo, const std::string &argument) {
+    obj_type type;
+    sign_t sign = revparse(repo).resolve(argument, type);
+    if (sign.bytes().empty()) {
+        return "missing " + argument + "\n";
+    }
+
+    return "ok " + sign.str() + " " + __inl_type_name(type) + "\n";
+}
+
+/**
+ * answer one request
+ * Args:
+ *      const std::string &request: request's payload
+ * Returns:
+ *      response's payload
+ */
+std::string server::handle(const std::string &request) {
+    std::string repo_name;
+    size_t begin = 0;
+    if (!request.empty() && request[0] == '@') {
+        begin = request.find(' ');
+        if (begin == std::string::npos) {
+            return "error bad request\n";
+        }
+        repo_name = request.substr(1, begin - 1);
+        begin++;
+    }
+
+    repository *repo = this->__repository(repo_name);
+    if (repo == nullptr) {
+        return "error unknown repository\n";
+    }
+
+    size_t space = request.find(' ', begin);
+    if (space == std::string::npos) {
+        return "error bad request\n";
+    }
+    std::string command = request.substr(begin, space - begin);
+    std::string argument = request.substr(space + 1);
+
+    if (command == "info") {
+        return this->__info(*repo, argument, false);
+    }
+    else if (command == "contents") {
+        return this->__info(*repo, argument, true);
+    }
+    else if (command == "tree") {
+        return this->__tree(*repo, argument);
+    }
+    else if (command == "resolve") {
+        return this->__resolve(*repo, argument);
+    }
+    return "error unknown command\n";
+}
+
+/**
+ * write all bytes, retrying on short writes
+ */
+inline bool __inl_write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+/**
+ * serve framed requests until input ends. Responses are buffered and only
+ * flushed before blocking for more input, so pipelined requests are
+ * answered with few writes
+ * Args:
+ *      int in_fd: requests' file descriptor
+ *      int out_fd: responses' file descriptor
+ */
+void server::serve(int in_fd, int out_fd) {
+    std::string in_buffer;
+    std::string out_buffer;
+    size_t consumed = 0;
+    char chunk[16 * 1024];
+
+    while (true) {
+        if (in_buffer.size() - consumed >= 4) {
+            uint32_t len;
+            memcpy(&len, in_buffer.data() + consumed, 4);
+            len = ntohl(len);
+            if (len > SERVER_REQUEST_MAX) {
+                break;
+            }
+
+            if (in_buffer.size() - consumed - 4 >= len) {
+                std::string response = this->handle(in_buffer.substr(consumed + 4, len));
+                consumed += 4 + len;
+
+                uint32_t response_len = htonl(uint32_t(response.size()));
+                out_buffer.append(reinterpret_cast<char *>(&response_len), 4);
+                out_buffer.append(response);
+                if (out_buffer.size() >= __SERVER_WRITE_BUFFER) {
+                    if (!__inl_write_all(out_fd, out_buffer.data(), out_buffer.size())) {
+                        return;
+                    }
+                    out_buffer.clear();
+                }
+                continue;
+            }
+        }
+
+        // need more input, drop what's consumed and flush before blocking
+        in_buffer.erase(0, consumed);
+        consumed = 0;
+        if (!out_buffer.empty()) {
+            if (!__inl_write_all(out_fd, out_buffer.data(), out_buffer.size())) {
+                return;
+            }
+            out_buffer.clear();
+        }
+
+        ssize_t nread = read(in_fd, chunk, sizeof(chunk));
+        if (nread <= 0) {
+            break;
+        }
+        in_buffer.append(chunk, nread);
+    }
+
+    __inl_write_all(out_fd, out_buffer.data(), out_buffer.size());
+}
+
+/**
+ * serve a unix socket, every connection on its own thread
+ * Args:
+ *      const std::string &socket_path: socket's path (replaced if exists)
+ * Returns:
+ *      -1 if the socket can't be set up, otherwise doesn't return
+ */
+int server::listen(const std::string &socket_path) {
+    sockaddr_un addr;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path.data(), socket_path.size());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        return -1;
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1
+        || ::listen(listen_fd, 64) == -1) {
+        close(listen_fd);
+        return -1;
+    }
+
+    while (true) {
+        int conn_fd = accept(listen_fd, nullptr, nullptr);
+        if (conn_fd == -1) {
+            continue;
+        }
+        std::thread([this, conn_fd] () -> void {
+            this->serve(conn_fd, conn_fd);
+            close(conn_fd);
+        }).detach();
+    }
+}
+
+}
+}
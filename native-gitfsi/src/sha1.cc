@@ -0,0 +1,442 @@
+#include "sha1.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define __SHA1_X86
+#endif
+#ifdef GITFSI_SHA1DC
+#include <sha1dc/sha1.h>
+#endif
+
+namespace gitter_kid {
+namespace fsi {
+
+typedef void (*__sha1_compress_f)(uint32_t *state, const byte *data, size_t blocks);
+
+inline uint32_t __inl_sha1_rol(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * portable compression of 64 bytes blocks
+ */
+void __sha1_compress(uint32_t *state, const byte *data, size_t blocks) {
+    uint32_t w[80];
+    for (; blocks != 0; blocks--, data += 64) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16)
+                   | (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = __inl_sha1_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = __inl_sha1_rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = __inl_sha1_rol(b, 30);
+            b = a;
+            a = temp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef __SHA1_X86
+/**
+ * compression with the SHA extensions (sha1rnds4 runs 4 rounds, sha1msg1
+ * and sha1msg2 expand the message schedule)
+ */
+__attribute__((target("sha,sse4.1")))
+void __sha1_compress_shani(uint32_t *state, const byte *data, size_t blocks) {
+    // words are big endian
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+    __m128i e1;
+    __m128i msg0;
+    __m128i msg1;
+    __m128i msg2;
+    __m128i msg3;
+
+    for (; blocks != 0; blocks--, data += 64) {
+        __m128i abcd_save = abcd;
+        __m128i e0_save = e0;
+
+        // rounds 0-3
+        msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0)), mask);
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        // rounds 4-7
+        msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+        // rounds 8-11
+        msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32)), mask);
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // rounds 12-15
+        msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48)), mask);
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // rounds 16-19
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // rounds 20-23
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // rounds 24-27
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // rounds 28-31
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // rounds 32-35
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // rounds 36-39
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // rounds 40-43
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // rounds 44-47
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // rounds 48-51
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // rounds 52-55
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // rounds 56-59
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+
+        // rounds 60-63
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+        msg1 = _mm_xor_si128(msg1, msg3);
+
+        // rounds 64-67
+        e0 = _mm_sha1nexte_epu32(e0, msg0);
+        e1 = abcd;
+        msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+        msg2 = _mm_xor_si128(msg2, msg0);
+
+        // rounds 68-71
+        e1 = _mm_sha1nexte_epu32(e1, msg1);
+        e0 = abcd;
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        msg3 = _mm_xor_si128(msg3, msg1);
+
+        // rounds 72-75
+        e0 = _mm_sha1nexte_epu32(e0, msg2);
+        e1 = abcd;
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        // rounds 76-79
+        e1 = _mm_sha1nexte_epu32(e1, msg3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+/**
+ * SHA extensions need SSSE3 (pshufb) and SSE4.1 (pextrd) too
+ */
+bool __sha1_cpu_has_shani() {
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+        || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & bit_SHA) != 0;
+}
+#endif
+
+// set by __sha1_force, nullptr for the CPU's pick
+static std::atomic<__sha1_compress_f> __sha1_forced(nullptr);
+
+/**
+ * block compression picked once, on first use, unless forced
+ */
+__sha1_compress_f __sha1_compressor() {
+    __sha1_compress_f forced = __sha1_forced.load(std::memory_order_relaxed);
+    if (forced != nullptr) {
+        return forced;
+    }
+#ifdef __SHA1_X86
+    static const __sha1_compress_f compress = __sha1_cpu_has_shani()
+                                              ? __sha1_compress_shani
+                                              : __sha1_compress;
+    return compress;
+#else
+    return __sha1_compress;
+#endif
+}
+
+bool __sha1_force(__sha1_impl impl) {
+    __sha1_compress_f forced = nullptr;
+#ifdef GITFSI_SHA1DC
+    // sha1dc compresses on its own
+    if (impl != __sha1_impl::__sha1_impl_auto) {
+        return false;
+    }
+#endif
+    if (impl == __sha1_impl::__sha1_impl_portable) {
+        forced = __sha1_compress;
+    }
+    else if (impl == __sha1_impl::__sha1_impl_shani) {
+#ifdef __SHA1_X86
+        if (!__sha1_cpu_has_shani()) {
+            return false;
+        }
+        forced = __sha1_compress_shani;
+#else
+        return false;
+#endif
+    }
+    __sha1_forced.store(forced, std::memory_order_relaxed);
+    return true;
+}
+
+sha1::sha1()
+    : _len(0)
+    , _block_len(0)
+    , _dc(nullptr) {
+    this->_state[0] = 0x67452301;
+    this->_state[1] = 0xEFCDAB89;
+    this->_state[2] = 0x98BADCFE;
+    this->_state[3] = 0x10325476;
+    this->_state[4] = 0xC3D2E1F0;
+#ifdef GITFSI_SHA1DC
+    SHA1_CTX *dc = new SHA1_CTX;
+    SHA1DCInit(dc);
+    this->_dc = dc;
+#endif
+}
+
+sha1::~sha1() {
+#ifdef GITFSI_SHA1DC
+    delete static_cast<SHA1_CTX *>(this->_dc);
+#endif
+}
+
+void sha1::update(const byte *data, size_t len) {
+#ifdef GITFSI_SHA1DC
+    SHA1DCUpdate(static_cast<SHA1_CTX *>(this->_dc), reinterpret_cast<const char *>(data), len);
+    return;
+#endif
+    __sha1_compress_f compress = __sha1_compressor();
+    this->_len += len;
+
+    if (this->_block_len != 0) {
+        size_t taken = std::min(len, sizeof(this->_block) - this->_block_len);
+        memcpy(this->_block + this->_block_len, data, taken);
+        this->_block_len += taken;
+        data += taken;
+        len -= taken;
+        if (this->_block_len < sizeof(this->_block)) {
+            return;
+        }
+        compress(this->_state, this->_block, 1);
+        this->_block_len = 0;
+    }
+
+    // whole blocks are hashed in place
+    compress(this->_state, data, len / 64);
+    data += len - len % 64;
+    memcpy(this->_block, data, len % 64);
+    this->_block_len = len % 64;
+}
+
+void sha1::update(const std::string &data) {
+    this->update(reinterpret_cast<const byte *>(data.data()), data.size());
+}
+
+bool sha1::final(byte *digest) {
+#ifdef GITFSI_SHA1DC
+    return SHA1DCFinal(digest, static_cast<SHA1_CTX *>(this->_dc)) == 0;
+#endif
+    uint64_t bits = this->_len * 8;
+
+    // 0x80, zeros up to 56 mod 64, then the message length in bits
+    byte padding[72] = { 0x80 };
+    size_t padding_len = (this->_block_len < 56 ? 56 : 120) - this->_block_len;
+    for (int i = 0; i < 8; i++) {
+        padding[padding_len + i] = byte(bits >> (56 - i * 8));
+    }
+    this->update(padding, padding_len + 8);
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = byte(this->_state[i] >> 24);
+        digest[i * 4 + 1] = byte(this->_state[i] >> 16);
+        digest[i * 4 + 2] = byte(this->_state[i] >> 8);
+        digest[i * 4 + 3] = byte(this->_state[i]);
+    }
+    return true;
+}
+
+bool sha1::final(sign_t &sign) {
+    byte digest[SHA1_LEN];
+    bool result = this->final(digest);
+    sign.bytes_assign(digest, digest + SHA1_LEN);
+    return result;
+}
+
+bool sha1::accelerated() {
+#if defined(__SHA1_X86) && !defined(GITFSI_SHA1DC)
+    return __sha1_compressor() == __sha1_compress_shani;
+#else
+    return false;
+#endif
+}
+
+bool hash_object(obj_type type, const byte *content, size_t len, sign_t &sign) {
+    const char *type_name;
+    switch (type) {
+    case obj_type::obj_type_blob:
+        type_name = "blob";
+        break;
+    case obj_type::obj_type_tree:
+        type_name = "tree";
+        break;
+    case obj_type::obj_type_commit:
+        type_name = "commit";
+        break;
+    case obj_type::obj_type_tag:
+        type_name = "tag";
+        break;
+    default:
+        return false;
+    }
+
+    sha1 hasher;
+    hasher.update(std::string(type_name) + " " + std::to_string(len) + std::string(1, '\0'));
+    hasher.update(content, len);
+    return hasher.final(sign);
+}
+
+}
+}
@@ -13,26 +13,44 @@ sign_t::sign_t(char *sign) {
     this->str_assign(sign, sign + 40);
 }
 
+/**
+ * empty sign whose bytes are allocated from bytes_arena
+ */
+sign_t::sign_t(arena *bytes_arena)
+    : _sign_bytes(arena_allocator<byte>(bytes_arena)) {}
+
 std::string &sign_t::str() {
+    if (this->_sign_str.empty() && !this->_sign_bytes.empty()) {
+        static const char hex[] = "0123456789abcdef";
+
+        this->_sign_str.resize(this->_sign_bytes.size() * 2);
+        for (size_t i = 0; i < this->_sign_bytes.size(); i++) {
+            this->_sign_str[2 * i] = hex[this->_sign_bytes[i] >> 4];
+            this->_sign_str[2 * i + 1] = hex[this->_sign_bytes[i] & 0x0F];
+        }
+    }
     return this->_sign_str;
 }
 
-std::basic_string<byte> &sign_t::bytes() {
+arena_bytes &sign_t::bytes() {
+    return this->_sign_bytes;
+}
+
+const arena_bytes &sign_t::bytes() const {
     return this->_sign_bytes;
 }
 
 bool sign_t::operator<(const sign_t &other_sign) const {
-    for (int i = 0; i < 20; i++) {
-        if (this->_sign_bytes[i] < other_sign._sign_bytes[i]) {
-            return true;
-        }
-        else if (this->_sign_bytes[i] > other_sign._sign_bytes[i]) {
-            return false;
-        }
-    }
-    return false;
+    return this->_sign_bytes < other_sign._sign_bytes;
 }
 
+bool sign_t::operator==(const sign_t &other_sign) const {
+    return this->_sign_bytes == other_sign._sign_bytes;
 }
+
+bool sign_t::operator!=(const sign_t &other_sign) const {
+    return this->_sign_bytes != other_sign._sign_bytes;
 }
 
+}
+}
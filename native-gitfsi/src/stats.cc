@@ -0,0 +1,407 @@
+#include "stats.h"
+#include "pack.h"
+#include "inflate.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <cstdlib>
+
+namespace gitter_kid {
+namespace fsi {
+
+// a tree's subtrees, for the path depth
+struct __stats_tree_s {
+    sign_t sign;
+    std::vector<std::pair<std::string, sign_t>> subtrees;
+    bool files;
+};
+
+struct __stats_commit_s {
+    sign_t sign;
+    std::vector<sign_t> parents;
+};
+
+// trees and commits read by one worker
+struct __stats_graph_s {
+    std::vector<__stats_tree_s> trees;
+    std::vector<__stats_commit_s> commits;
+    stats_object widest_tree;
+};
+
+inline stats_type *__inl_stats_type(stats_report &report, obj_type type) {
+    switch (type) {
+    case obj_type::obj_type_commit:
+        return &report.commits;
+    case obj_type::obj_type_tree:
+        return &report.trees;
+    case obj_type::obj_type_blob:
+        return &report.blobs;
+    case obj_type::obj_type_tag:
+        return &report.tags;
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * map pack object type to object type
+ */
+inline obj_type __inl_stats_pack_type(uint8_t type) {
+    switch (type) {
+    case 0x01:
+        return obj_type::obj_type_commit;
+    case 0x02:
+        return obj_type::obj_type_tree;
+    case 0x03:
+        return obj_type::obj_type_blob;
+    case 0x04:
+        return obj_type::obj_type_tag;
+    default:
+        return obj_type::obj_type_unknow;
+    }
+}
+
+/**
+ * keep the STATS_LARGEST_LEN largest objects, largest first
+ */
+inline void __inl_stats_keep(std::vector<stats_object> &largest, const sign_t &sign, uint64_t size) {
+    if (largest.size() == STATS_LARGEST_LEN && size <= largest.back().size) {
+        return;
+    }
+    auto pos = std::upper_bound(largest.begin(),
+                                largest.end(),
+                                size,
+                                [] (uint64_t value, const stats_object &object) -> bool {
+                                    return value > object.size;
+                                });
+    largest.insert(pos, stats_object { sign, size });
+    if (largest.size() > STATS_LARGEST_LEN) {
+        largest.pop_back();
+    }
+}
+
+/**
+ * count one object in the report
+ */
+void __stats_count(stats_report &report, const sign_t &sign, obj_type type,
+                   uint64_t size, uint64_t disk_size, size_t depth) {
+    stats_type *counters = __inl_stats_type(report, type);
+    if (counters == nullptr) {
+        return;
+    }
+    counters->count++;
+    counters->size += size;
+    counters->disk_size += disk_size;
+
+    if (report.delta_depths.size() <= depth) {
+        report.delta_depths.resize(depth + 1, 0);
+    }
+    report.delta_depths[depth]++;
+
+    if (type == obj_type::obj_type_blob) {
+        __inl_stats_keep(report.largest_blobs, sign, size);
+    }
+    else if (type == obj_type::obj_type_tree) {
+        __inl_stats_keep(report.largest_trees, sign, size);
+    }
+}
+
+/**
+ * count a pack's objects from their headers: a delta takes its chain's
+ * root type, its depth is its chain's length
+ */
+void __stats_pack(stats_report &report, const pack_list &packs, pack &counted_pack) {
+    std::vector<__pack_node_s> nodes;
+    counted_pack.scan(nodes, true);
+    std::vector<__pack_idx_s> &indexes = counted_pack.off_index();
+
+    std::vector<obj_type> types(nodes.size(), obj_type::obj_type_unknow);
+    std::vector<size_t> depths(nodes.size(), 0);
+    std::vector<uint8_t> resolved(nodes.size(), 0);
+    std::vector<size_t> chain;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        chain.clear();
+        size_t nth = i;
+        while (!resolved[nth] && nodes[nth].base != PACK_NODE_ROOT && chain.size() <= nodes.size()) {
+            chain.push_back(nth);
+            nth = nodes[nth].base;
+        }
+
+        if (!resolved[nth] && nodes[nth].base == PACK_NODE_ROOT) {
+            resolved[nth] = 1;
+            if (nodes[nth].type < 5) {
+                types[nth] = __inl_stats_pack_type(nodes[nth].type);
+            }
+            else {
+                // base in another pack, the delta is resolved for its type
+                counted_pack.prefix(packs, indexes[nth].sign, 0, types[nth]);
+                depths[nth] = 1;
+            }
+        }
+        // chains looping back (a corrupt pack) stay unknown
+        for (auto itr = chain.rbegin(); itr != chain.rend(); itr++) {
+            types[*itr] = types[nodes[*itr].base];
+            depths[*itr] = depths[nodes[*itr].base] + 1;
+            resolved[*itr] = 1;
+        }
+
+        __stats_count(report, indexes[i].sign, types[i], nodes[i].size, indexes[i].len, depths[i]);
+    }
+}
+
+/**
+ * count a loose object from its header, only its first bytes are inflated
+ */
+obj_type __stats_loose(stats_report &report, repository &repo, const sign_t &sign) {
+    std::ifstream loose_file(repo.looseobj_path(sign), std::ios::binary);
+    std::basic_string<byte> file_content((std::istreambuf_iterator<char>(loose_file)),
+                                         std::istreambuf_iterator<char>());
+    std::basic_string<byte> header = __inflate_prefix(file_content, 32);
+
+    // "<type> <size>\0"
+    auto spliter = std::find(header.begin(), header.end(), byte(0));
+    auto space = std::find(header.begin(), spliter, byte(' '));
+    if (spliter == header.end() || space == spliter) {
+        return obj_type::obj_type_unknow;
+    }
+    std::string type_name(header.begin(), space);
+    obj_type type = type_name == "commit" ? obj_type::obj_type_commit
+        : type_name == "tree" ? obj_type::obj_type_tree
+        : type_name == "blob" ? obj_type::obj_type_blob
+        : type_name == "tag" ? obj_type::obj_type_tag
+        : obj_type::obj_type_unknow;
+    uint64_t size = std::strtoull(std::string(space + 1, spliter).c_str(), nullptr, 10);
+
+    __stats_count(report, sign, type, size, file_content.size(), 0);
+    return type;
+}
+
+/**
+ * record a tree's or a commit's links
+ */
+void __stats_graph(__stats_graph_s &graph, sign_t &sign, object &obj) {
+    if (obj.type() == obj_type::obj_type_tree) {
+        tree_items &items = obj.get<tree>().items();
+        if (items.size() > graph.widest_tree.size) {
+            graph.widest_tree = stats_object { sign, items.size() };
+        }
+
+        graph.trees.push_back(__stats_tree_s { sign, {}, false });
+        __stats_tree_s &node = graph.trees.back();
+        for (auto itr = items.begin(); itr != items.end(); itr++) {
+            if (itr->type() == obj_type::obj_type_tree) {
+                node.subtrees.push_back(std::make_pair(itr->name(), itr->sign()));
+            }
+            else {
+                node.files = true;
+            }
+        }
+    }
+    else if (obj.type() == obj_type::obj_type_commit) {
+        commit_parents &parents = obj.get<commit>().body().parents();
+        graph.commits.push_back(__stats_commit_s { sign, std::vector<sign_t>(parents.begin(), parents.end()) });
+    }
+}
+
+/**
+ * position of sign in a vector sorted by sign
+ * Returns:
+ *      items.size() if it isn't there
+ */
+template <typename _T_Item>
+size_t __stats_find(const std::vector<_T_Item> &items, const sign_t &sign) {
+    auto found = std::lower_bound(items.begin(),
+                                  items.end(),
+                                  sign,
+                                  [] (const _T_Item &item, const sign_t &value) -> bool {
+                                    return item.sign < value;
+                                  });
+    return found != items.end() && found->sign == sign ? found - items.begin() : items.size();
+}
+
+/**
+ * deepest path over every tree: a tree's depth is one for its files, or
+ * one more than its deepest subtree. Depth-first with an explicit stack,
+ * a missing subtree counts as an empty directory
+ */
+void __stats_paths(stats_report &report, std::vector<__stats_tree_s> &trees) {
+    const size_t none = size_t(-1);
+    std::vector<size_t> depths(trees.size(), none);
+    // subtree on the deepest path, none if the tree's files are deepest
+    std::vector<size_t> deepest(trees.size(), none);
+    // (tree, next subtree to visit)
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    for (size_t root = 0; root < trees.size(); root++) {
+        if (depths[root] != none) {
+            continue;
+        }
+        // 0 marks a tree being visited, a cycle (only with forged ids) ends there
+        depths[root] = 0;
+        stack.push_back(std::make_pair(root, 0));
+        while (!stack.empty()) {
+            size_t nth = stack.back().first;
+            size_t next = stack.back().second++;
+            if (next < trees[nth].subtrees.size()) {
+                size_t sub = __stats_find(trees, trees[nth].subtrees[next].second);
+                if (sub != trees.size() && depths[sub] == none) {
+                    depths[sub] = 0;
+                    stack.push_back(std::make_pair(sub, 0));
+                }
+                continue;
+            }
+
+            size_t depth = trees[nth].files ? 1 : 0;
+            for (size_t i = 0; i < trees[nth].subtrees.size(); i++) {
+                size_t sub = __stats_find(trees, trees[nth].subtrees[i].second);
+                size_t sub_depth = sub == trees.size() ? 0 : depths[sub];
+                if (sub_depth + 1 > depth) {
+                    depth = sub_depth + 1;
+                    deepest[nth] = i;
+                }
+            }
+            depths[nth] = depth;
+            stack.pop_back();
+        }
+
+        if (depths[root] > report.max_path_depth) {
+            report.max_path_depth = depths[root];
+            report.deepest_path.clear();
+            for (size_t nth = root; nth < trees.size() && deepest[nth] != none;) {
+                std::pair<std::string, sign_t> &sub = trees[nth].subtrees[deepest[nth]];
+                report.deepest_path += (report.deepest_path.empty() ? "" : "/") + sub.first;
+                nth = __stats_find(trees, sub.second);
+            }
+        }
+    }
+}
+
+/**
+ * longest parent chain: a commit's generation is one more than its
+ * parents' highest. Depth-first with an explicit stack, histories are deep
+ */
+void __stats_history(stats_report &report, std::vector<__stats_commit_s> &commits) {
+    const size_t none = size_t(-1);
+    std::vector<size_t> generations(commits.size(), none);
+    // (commit, next parent to visit)
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    for (size_t tip = 0; tip < commits.size(); tip++) {
+        if (generations[tip] != none) {
+            continue;
+        }
+        generations[tip] = 0;
+        stack.push_back(std::make_pair(tip, 0));
+        while (!stack.empty()) {
+            size_t nth = stack.back().first;
+            size_t next = stack.back().second++;
+            if (next < commits[nth].parents.size()) {
+                size_t parent = __stats_find(commits, commits[nth].parents[next]);
+                if (parent != commits.size() && generations[parent] == none) {
+                    generations[parent] = 0;
+                    stack.push_back(std::make_pair(parent, 0));
+                }
+                continue;
+            }
+
+            size_t generation = 1;
+            for (auto itr = commits[nth].parents.begin(); itr != commits[nth].parents.end(); itr++) {
+                size_t parent = __stats_find(commits, *itr);
+                if (parent != commits.size()) {
+                    generation = std::max(generation, generations[parent] + 1);
+                }
+            }
+            generations[nth] = generation;
+            stack.pop_back();
+        }
+    }
+
+    for (size_t nth = 0; nth < commits.size(); nth++) {
+        if (generations[nth] > report.history_length) {
+            report.history_length = generations[nth];
+            report.history_tip = commits[nth].sign;
+        }
+    }
+}
+
+stats::stats(repository &repo)
+    : _repo(repo)
+    , _threads(0) {}
+
+unsigned &stats::threads() {
+    return this->_threads;
+}
+
+/**
+ * compute the report
+ */
+stats_report stats::collect() {
+    auto started = std::chrono::steady_clock::now();
+
+    stats_report report;
+    report.commits = stats_type { 0, 0, 0 };
+    report.trees = stats_type { 0, 0, 0 };
+    report.blobs = stats_type { 0, 0, 0 };
+    report.tags = stats_type { 0, 0, 0 };
+    report.widest_tree = stats_object { sign_t(), 0 };
+    report.max_path_depth = 0;
+    report.history_length = 0;
+
+    this->_repo.refresh_packs();
+    std::shared_ptr<const pack_list> packs = this->_repo.packs();
+    std::vector<__stats_graph_s> graphs(__parallel_threads(this->_threads));
+    for (auto itr = graphs.begin(); itr != graphs.end(); itr++) {
+        itr->widest_tree = stats_object { sign_t(), 0 };
+    }
+
+    for (auto itr = packs->begin(); itr != packs->end(); itr++) {
+        __stats_pack(report, *packs, **itr);
+        // blobs' delta trees aren't read at all
+        (*itr)->for_each(*packs,
+                         [&graphs] (unsigned worker, sign_t &sign, object &obj) -> void {
+                             __stats_graph(graphs[worker], sign, obj);
+                         },
+                         this->_threads,
+                         false,
+                         (1 << obj_type::obj_type_tree) | (1 << obj_type::obj_type_commit));
+    }
+
+    std::vector<sign_t> loose_signs = this->_repo.loose_objects();
+    for (auto itr = loose_signs.begin(); itr != loose_signs.end(); itr++) {
+        obj_type type = __stats_loose(report, this->_repo, *itr);
+        if (type == obj_type::obj_type_tree || type == obj_type::obj_type_commit) {
+            object obj = this->_repo.get(*itr);
+            __stats_graph(graphs[0], *itr, obj);
+        }
+    }
+
+    std::vector<__stats_tree_s> trees;
+    std::vector<__stats_commit_s> commits;
+    for (auto itr = graphs.begin(); itr != graphs.end(); itr++) {
+        if (itr->widest_tree.size > report.widest_tree.size) {
+            report.widest_tree = itr->widest_tree;
+        }
+        std::move(itr->trees.begin(), itr->trees.end(), std::back_inserter(trees));
+        std::move(itr->commits.begin(), itr->commits.end(), std::back_inserter(commits));
+    }
+    std::sort(trees.begin(),
+              trees.end(),
+              [] (const __stats_tree_s &a, const __stats_tree_s &b) -> bool {
+                return a.sign < b.sign;
+              });
+    std::sort(commits.begin(),
+              commits.end(),
+              [] (const __stats_commit_s &a, const __stats_commit_s &b) -> bool {
+                return a.sign < b.sign;
+              });
+    __stats_paths(report, trees);
+    __stats_history(report, commits);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
+
+}
+}
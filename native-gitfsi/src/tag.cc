@@ -0,0 +1,87 @@
+#include "tag.h"
+#include <algorithm>
+#include <string>
+
+namespace gitter_kid {
+namespace fsi {
+
+tag_body::tag_body()
+    : _type(obj_type::obj_type_unknow) {}
+
+std::string &tag_body::obj_sign() {
+    return this->_obj_sign;
+}
+
+obj_type &tag_body::type() {
+    return this->_type;
+}
+
+std::string &tag_body::name() {
+    return this->_name;
+}
+
+commit_metadata &tag_body::tagger() {
+    return this->_tagger;
+}
+
+std::string &tag_body::message() {
+    return this->_message;
+}
+
+tag::tag(std::basic_string<byte>::iterator spliter,
+         std::basic_string<byte>::iterator end) {
+    for (std::basic_string<byte>::iterator ch = spliter; ch != end; ) {
+        std::basic_string<byte>::iterator end_line_iter = std::find(ch, end, byte('\n'));
+
+        if (end_line_iter == ch) {
+            this->_body.message().assign(ch + 1, end);
+            break;
+        }
+
+        std::basic_string<byte>::iterator space_iter = std::find(ch, end_line_iter, byte(' '));
+        std::string field(ch, space_iter);
+        std::basic_string<byte>::iterator value_iter =
+            space_iter == end_line_iter ? end_line_iter : space_iter + 1;
+
+        if (field.compare("object") == 0) {
+            this->_body.obj_sign().assign(value_iter, end_line_iter);
+        }
+        else if (field.compare("type") == 0) {
+            std::string type(value_iter, end_line_iter);
+            if (type.compare("commit") == 0) {
+                this->_body.type() = obj_type::obj_type_commit;
+            }
+            else if (type.compare("tree") == 0) {
+                this->_body.type() = obj_type::obj_type_tree;
+            }
+            else if (type.compare("blob") == 0) {
+                this->_body.type() = obj_type::obj_type_blob;
+            }
+            else if (type.compare("tag") == 0) {
+                this->_body.type() = obj_type::obj_type_tag;
+            }
+        }
+        else if (field.compare("tag") == 0) {
+            this->_body.name().assign(value_iter, end_line_iter);
+        }
+        else if (field.compare("tagger") == 0) {
+            this->_body.tagger() = commit_metadata(value_iter, end_line_iter);
+        }
+
+        if (end_line_iter == end) {
+            break;
+        }
+        ch = end_line_iter + 1;
+    }
+}
+
+obj_type tag::type() const {
+    return obj_type::obj_type_tag;
+}
+
+tag_body &tag::get() {
+    return this->_body;
+}
+
+}
+}
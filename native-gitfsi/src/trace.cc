@@ -0,0 +1,261 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <unistd.h>
+
+namespace gitter_kid {
+namespace fsi {
+
+/**
+ * fixed size ring of kept spans, the oldest is overwritten first
+ */
+struct __trace_ring_s {
+    std::vector<trace_event> events;
+    size_t next;
+
+    __trace_ring_s() : next(0) {}
+
+    void push(trace_event &event) {
+        if (this->events.size() < TRACE_RING_LEN) {
+            this->events.push_back(std::move(event));
+        }
+        else {
+            this->events[this->next] = std::move(event);
+        }
+        this->next = (this->next + 1) % TRACE_RING_LEN;
+    }
+};
+
+struct __trace_thread_s {
+    uint32_t tid;
+    // guards ring, taken by the owner only to keep a slow trace
+    std::mutex mutex;
+    __trace_ring_s ring;
+
+    // owner only
+    uint32_t depth;
+    bool sampled;
+    std::vector<trace_event> pending;
+};
+
+struct __trace_registry_s {
+    std::mutex mutex;
+    std::set<__trace_thread_s *> threads;
+    uint32_t next_tid;
+    // spans of exited threads
+    __trace_ring_s retired;
+};
+
+std::atomic<bool> __trace_enabled(false);
+std::atomic<size_t> __trace_sample_every(1);
+std::atomic<uint64_t> __trace_slow_ns(0);
+std::atomic<uint64_t> __trace_roots(0);
+
+/**
+ * registry is never freed, threads may exit after static destruction
+ */
+__trace_registry_s &__trace_registry() {
+    static __trace_registry_s *registry = new __trace_registry_s();
+    return *registry;
+}
+
+/**
+ * current thread's state, registered on first span and moved to the
+ * retired ring when the thread exits
+ */
+class __trace_thread {
+private:
+    __trace_thread_s *_state;
+public:
+    __trace_thread() : _state(new __trace_thread_s()) {
+        this->_state->depth = 0;
+        this->_state->sampled = false;
+
+        __trace_registry_s &registry = __trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        this->_state->tid = ++registry.next_tid;
+        registry.threads.insert(this->_state);
+    }
+
+    ~__trace_thread() {
+        __trace_registry_s &registry = __trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.erase(this->_state);
+        for (auto itr = this->_state->ring.events.begin();
+             itr != this->_state->ring.events.end();
+             itr++) {
+            registry.retired.push(*itr);
+        }
+        delete this->_state;
+    }
+
+    __trace_thread_s &state() {
+        return *this->_state;
+    }
+};
+
+thread_local __trace_thread __trace_current;
+
+inline uint64_t __inl_trace_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace::enable(size_t sample_every, uint64_t slow_ns) {
+    __trace_sample_every.store(std::max(sample_every, size_t(1)));
+    __trace_slow_ns.store(slow_ns);
+    __trace_enabled.store(true);
+}
+
+void trace::disable() {
+    __trace_enabled.store(false);
+}
+
+bool trace::enabled() {
+    return __trace_enabled.load(std::memory_order_relaxed);
+}
+
+void trace::clear() {
+    __trace_registry_s &registry = __trace_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired = __trace_ring_s();
+    for (auto itr = registry.threads.begin(); itr != registry.threads.end(); itr++) {
+        std::lock_guard<std::mutex> thread_lock((*itr)->mutex);
+        (*itr)->ring = __trace_ring_s();
+    }
+}
+
+/**
+ * append value as a JSON string
+ */
+void __trace_json_string(std::string &out, const std::string &value) {
+    out += '"';
+    for (auto itr = value.begin(); itr != value.end(); itr++) {
+        if (*itr == '"' || *itr == '\\') {
+            out += '\\';
+            out += *itr;
+        }
+        else if (uint8_t(*itr) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *itr);
+            out += escaped;
+        }
+        else {
+            out += *itr;
+        }
+    }
+    out += '"';
+}
+
+std::string trace::chrome_json() {
+    std::vector<trace_event> events;
+    {
+        __trace_registry_s &registry = __trace_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        events = registry.retired.events;
+        for (auto itr = registry.threads.begin(); itr != registry.threads.end(); itr++) {
+            std::lock_guard<std::mutex> thread_lock((*itr)->mutex);
+            events.insert(events.end(), (*itr)->ring.events.begin(), (*itr)->ring.events.end());
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const trace_event &a, const trace_event &b) {
+        return a.start_ns < b.start_ns;
+    });
+
+    std::string out = "{\"traceEvents\":[";
+    char buf[128];
+    for (auto itr = events.begin(); itr != events.end(); itr++) {
+        if (itr != events.begin()) {
+            out += ",";
+        }
+        out += "\n{\"name\":";
+        __trace_json_string(out, itr->name);
+        // timestamps are in microseconds
+        snprintf(buf, sizeof(buf),
+                 ",\"cat\":\"gitfsi\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u",
+                 itr->start_ns / 1000.0, itr->duration_ns / 1000.0, int(getpid()), itr->tid);
+        out += buf;
+        out += ",\"args\":{" + itr->args + "}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+trace_span::trace_span(const char *name)
+    : _name(name)
+    , _start(0)
+    , _entered(false)
+    , _active(false) {
+    if (!__trace_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    __trace_thread_s &state = __trace_current.state();
+    if (state.depth == 0) {
+        state.sampled = __trace_roots.fetch_add(1, std::memory_order_relaxed)
+                        % __trace_sample_every.load(std::memory_order_relaxed) == 0;
+    }
+    state.depth++;
+    this->_entered = true;
+    this->_active = state.sampled;
+    if (this->_active) {
+        this->_start = __inl_trace_now();
+    }
+}
+
+trace_span::~trace_span() {
+    if (!this->_entered) {
+        return;
+    }
+
+    __trace_thread_s &state = __trace_current.state();
+    state.depth--;
+    if (!this->_active) {
+        return;
+    }
+
+    uint64_t duration = __inl_trace_now() - this->_start;
+    state.pending.push_back({ this->_name, this->_start, duration, state.tid,
+                              state.depth, std::move(this->_args) });
+    if (state.depth != 0) {
+        return;
+    }
+
+    // outermost span ended, the whole trace is kept only if it was slow
+    if (duration >= __trace_slow_ns.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (auto itr = state.pending.begin(); itr != state.pending.end(); itr++) {
+            state.ring.push(*itr);
+        }
+    }
+    state.pending.clear();
+}
+
+bool trace_span::active() const {
+    return this->_active;
+}
+
+void trace_span::arg(const char *key, const std::string &value) {
+    if (!this->_args.empty()) {
+        this->_args += ",";
+    }
+    __trace_json_string(this->_args, key);
+    this->_args += ":";
+    __trace_json_string(this->_args, value);
+}
+
+void trace_span::arg(const char *key, uint64_t value) {
+    if (!this->_args.empty()) {
+        this->_args += ",";
+    }
+    __trace_json_string(this->_args, key);
+    this->_args += ":" + std::to_string(value);
+}
+
+}
+}
@@ -4,15 +4,16 @@
 #include <sstream>
 #include <iomanip>
 #include <cstdint>
+#include <utility>
 
 namespace gitter_kid {
 namespace fsi {
 
-tree_item::tree_item(sign_t sign,
-                     std::string name,
+tree_item::tree_item(sign_t &&sign,
+                     std::string &&name,
                      obj_type type)
-    : _sign(sign)
-    , _name(name)
+    : _sign(std::move(sign))
+    , _name(std::move(name))
     , _type(type) {}
 
 sign_t &tree_item::sign() {
@@ -27,29 +28,50 @@ obj_type &tree_item::type() {
     return this->_type;
 }
 
-tree::tree(std::vector<tree_item> &items,
-           std::basic_string<byte>::iterator spliter,
-           std::basic_string<byte>::iterator end)
-    : _items(items) {
-
+/**
+ * parse "<mode> <name>\0<id>" entries, the id width is a constant so the
+ * common SHA-1 case stays fully inlined
+ */
+template<size_t _T_Sign_Len> void tree::__parse(std::basic_string<byte>::iterator spliter,
+                                                std::basic_string<byte>::iterator end) {
     for(std::basic_string<byte>::iterator ch = spliter; ch != end;) {
         std::basic_string<byte>::iterator space_itr = std::find(ch, end, byte(' '));
 
         obj_type item_type = obj_type::obj_type_unknow;
-        if (std::string(ch, space_itr).compare("100644")) {
-            item_type = obj_type::obj_type_blob;
+        std::string mode(ch, space_itr);
+        if (mode.compare("40000") == 0) {
+            item_type = obj_type::obj_type_tree;
+        }
+        else if (mode.compare("160000") == 0) {
+            item_type = obj_type::obj_type_commit;
         }
         else {
-            item_type = obj_type::obj_type_tree;
+            item_type = obj_type::obj_type_blob;
         }
 
         std::basic_string<byte>::iterator end_itr = std::find(space_itr + 1, end, byte(0));
+        if (size_t(end - end_itr) < _T_Sign_Len + 1) {
+            break;
+        }
         std::string name(space_itr + 1, end_itr);
-        sign_t sign;
-        sign.bytes_assign(end_itr + 1, end_itr + 21);
+        // id bytes live in the request's arena along with the items
+        sign_t sign(arena::current());
+        sign.bytes_assign(end_itr + 1, end_itr + 1 + _T_Sign_Len);
 
-        ch = end_itr + 21;
-        this->_items.push_back(tree_item(sign, name, item_type));
+        ch = end_itr + 1 + _T_Sign_Len;
+        this->_items.emplace_back(std::move(sign), std::move(name), item_type);
+    }
+}
+
+tree::tree(std::basic_string<byte>::iterator spliter,
+           std::basic_string<byte>::iterator end,
+           size_t sign_len)
+    : _items(arena_allocator<tree_item>(arena::current())) {
+    if (sign_len == SIGN_SHA256_LEN) {
+        this->__parse<SIGN_SHA256_LEN>(spliter, end);
+    }
+    else {
+        this->__parse<SIGN_SHA1_LEN>(spliter, end);
     }
 }
 
@@ -57,7 +79,7 @@ obj_type tree::type() const {
     return obj_type::obj_type_tree;
 }
 
-std::vector<tree_item> &tree::items() {
+tree_items &tree::items() {
     return this->_items;
 }
 
@@ -0,0 +1,192 @@
+#include "tree_diff.h"
+#include <map>
+#include <algorithm>
+
+namespace gitter_kid {
+namespace fsi {
+
+tree_diff_item::tree_diff_item(diff_status status,
+                               std::string old_path,
+                               std::string new_path,
+                               sign_t old_sign,
+                               sign_t new_sign)
+    : _status(status)
+    , _old_path(old_path)
+    , _new_path(new_path)
+    , _old_sign(old_sign)
+    , _new_sign(new_sign)
+    , _similarity(0) {}
+
+diff_status &tree_diff_item::status() {
+    return this->_status;
+}
+
+std::string &tree_diff_item::old_path() {
+    return this->_old_path;
+}
+
+std::string &tree_diff_item::new_path() {
+    return this->_new_path;
+}
+
+sign_t &tree_diff_item::old_sign() {
+    return this->_old_sign;
+}
+
+sign_t &tree_diff_item::new_sign() {
+    return this->_new_sign;
+}
+
+int &tree_diff_item::similarity() {
+    return this->_similarity;
+}
+
+tree_diff::tree_diff(repository &repo, sign_t old_tree, sign_t new_tree)
+    : _repo(repo) {
+    this->__diff(old_tree, new_tree, std::string());
+}
+
+std::vector<tree_diff_item> &tree_diff::items() {
+    return this->_items;
+}
+
+/**
+ * read tree's items, an empty sign stands for an empty tree
+ * Args:
+ *      sign_t &sign: tree's sign
+ * Returns:
+ *      tree's items
+ */
+tree_items tree_diff::__tree_items(sign_t &sign) {
+    if (sign.bytes().empty()) {
+        return tree_items();
+    }
+
+    object obj = this->_repo.get(sign);
+    if (obj.type() != obj_type::obj_type_tree) {
+        return tree_items();
+    }
+    return obj.get<tree>().items();
+}
+
+/**
+ * record every leaf under a tree as added (or deleted)
+ * Args:
+ *      sign_t &sign: tree's sign
+ *      const std::string &path: tree's path
+ *      diff_status status: diff_status_added or diff_status_deleted
+ */
+void tree_diff::__expand(sign_t &sign, const std::string &path, diff_status status) {
+    tree_items items = this->__tree_items(sign);
+
+    for (auto itr = items.begin(); itr != items.end(); itr++) {
+        std::string item_path = path + itr->name();
+        if (itr->type() == obj_type::obj_type_tree) {
+            this->__expand(itr->sign(), item_path + '/', status);
+        }
+        else if (status == diff_status::diff_status_added) {
+            this->_items.push_back(tree_diff_item(status,
+                                                  std::string(),
+                                                  item_path,
+                                                  sign_t(),
+                                                  itr->sign()));
+        }
+        else {
+            this->_items.push_back(tree_diff_item(status,
+                                                  item_path,
+                                                  std::string(),
+                                                  itr->sign(),
+                                                  sign_t()));
+        }
+    }
+}
+
+/**
+ * compare two trees, identical subtrees are skipped without being read
+ * Args:
+ *      sign_t &old_tree: old tree's sign (empty sign for none)
+ *      sign_t &new_tree: new tree's sign (empty sign for none)
+ *      const std::string &prefix: path of both trees
+ */
+void tree_diff::__diff(sign_t &old_tree, sign_t &new_tree, const std::string &prefix) {
+    tree_items old_items = this->__tree_items(old_tree);
+    tree_items new_items = this->__tree_items(new_tree);
+
+    std::map<std::string, tree_item *> old_names;
+    for (auto itr = old_items.begin(); itr != old_items.end(); itr++) {
+        old_names.insert(std::make_pair(itr->name(), &*itr));
+    }
+
+    for (auto itr = new_items.begin(); itr != new_items.end(); itr++) {
+        std::string path = prefix + itr->name();
+        auto old_itr = old_names.find(itr->name());
+
+        if (old_itr == old_names.end()) {
+            if (itr->type() == obj_type::obj_type_tree) {
+                this->__expand(itr->sign(), path + '/', diff_status::diff_status_added);
+            }
+            else {
+                this->_items.push_back(tree_diff_item(diff_status::diff_status_added,
+                                                      std::string(),
+                                                      path,
+                                                      sign_t(),
+                                                      itr->sign()));
+            }
+            continue;
+        }
+
+        tree_item &old_item = *old_itr->second;
+        old_names.erase(old_itr);
+
+        if (old_item.sign().bytes() == itr->sign().bytes()
+            && old_item.type() == itr->type()) {
+            continue;
+        }
+
+        bool old_is_tree = old_item.type() == obj_type::obj_type_tree;
+        bool new_is_tree = itr->type() == obj_type::obj_type_tree;
+        if (old_is_tree && new_is_tree) {
+            this->__diff(old_item.sign(), itr->sign(), path + '/');
+        }
+        else if (old_is_tree) {
+            this->__expand(old_item.sign(), path + '/', diff_status::diff_status_deleted);
+            this->_items.push_back(tree_diff_item(diff_status::diff_status_added,
+                                                  std::string(),
+                                                  path,
+                                                  sign_t(),
+                                                  itr->sign()));
+        }
+        else if (new_is_tree) {
+            this->_items.push_back(tree_diff_item(diff_status::diff_status_deleted,
+                                                  path,
+                                                  std::string(),
+                                                  old_item.sign(),
+                                                  sign_t()));
+            this->__expand(itr->sign(), path + '/', diff_status::diff_status_added);
+        }
+        else {
+            this->_items.push_back(tree_diff_item(diff_status::diff_status_modified,
+                                                  path,
+                                                  path,
+                                                  old_item.sign(),
+                                                  itr->sign()));
+        }
+    }
+
+    for (auto itr = old_names.begin(); itr != old_names.end(); itr++) {
+        std::string path = prefix + itr->first;
+        if (itr->second->type() == obj_type::obj_type_tree) {
+            this->__expand(itr->second->sign(), path + '/', diff_status::diff_status_deleted);
+        }
+        else {
+            this->_items.push_back(tree_diff_item(diff_status::diff_status_deleted,
+                                                  path,
+                                                  std::string(),
+                                                  itr->second->sign(),
+                                                  sign_t()));
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+#include "repository.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+
+// loose objects are only listed by name until read
+void __touch_loose(const std::string &path, const std::string &hex) {
+    mkdir((path + "/objects/" + hex.substr(0, 2)).c_str(), 0755);
+    close(open((path + "/objects/" + hex.substr(0, 2) + "/" + hex.substr(2)).c_str(),
+               O_CREAT | O_WRONLY, 0644));
+}
+
+std::string __abbrev_repository() {
+    char base[] = "/tmp/gitfsi_abbrev_XXXXXX";
+    std::string path(mkdtemp(base));
+    mkdir((path + "/objects").c_str(), 0755);
+    mkdir((path + "/objects/pack").c_str(), 0755);
+    __touch_loose(path, "abcdef0123456789abcdef0123456789abcdef01");
+    __touch_loose(path, "abcdef0923456789abcdef0123456789abcdef01");
+    __touch_loose(path, "12345678abcdef0123456789abcdef0123456789");
+    return path;
+}
+
+TEST(abbrev, resolve) {
+    gitter_kid::fsi::repository repo(__abbrev_repository());
+    repo.initialize_packs();
+    gitter_kid::fsi::sign_t sign;
+
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_found, repo.resolve_abbrev("1234567", sign));
+    EXPECT_EQ("12345678abcdef0123456789abcdef0123456789", sign.str());
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_found, repo.resolve_abbrev("ABCDEF01", sign));
+    EXPECT_EQ("abcdef0123456789abcdef0123456789abcdef01", sign.str());
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_ambiguous, repo.resolve_abbrev("abcdef0", sign));
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_missing, repo.resolve_abbrev("12340", sign));
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_invalid, repo.resolve_abbrev("123", sign));
+    EXPECT_EQ(gitter_kid::fsi::abbrev_status_invalid, repo.resolve_abbrev("1234g", sign));
+}
+
+TEST(abbrev, shortest) {
+    std::string path = __abbrev_repository();
+    gitter_kid::fsi::repository repo(path);
+    repo.initialize_packs();
+
+    EXPECT_EQ("1234567", repo.abbrev(gitter_kid::fsi::sign_t(std::string("12345678abcdef0123456789abcdef0123456789"))));
+    EXPECT_EQ("1234", repo.abbrev(gitter_kid::fsi::sign_t(std::string("12345678abcdef0123456789abcdef0123456789")), 4));
+
+    std::vector<gitter_kid::fsi::sign_t> signs;
+    signs.push_back(gitter_kid::fsi::sign_t(std::string("abcdef0123456789abcdef0123456789abcdef01")));
+    signs.push_back(gitter_kid::fsi::sign_t(std::string("abcdef0923456789abcdef0123456789abcdef01")));
+    std::vector<std::string> abbrevs = repo.abbrev_many(signs);
+    ASSERT_EQ(2, abbrevs.size());
+    EXPECT_EQ("abcdef01", abbrevs[0]);
+    EXPECT_EQ("abcdef09", abbrevs[1]);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
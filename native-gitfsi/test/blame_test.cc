@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "blame.h"
+#include "test_repo.h"
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace gitter_kid::fsi;
+
+/**
+ *   c1 - c2 - c4 - merge
+ *     \           /
+ *      c3 -------
+ * c1 writes dir/f.txt, c2 modifies its second line, c3 inserts a line
+ * before the last one, c4 inserts a first line and the merge takes both
+ */
+class blame_fixture : public testing::Test {
+protected:
+    test_repo fixture;
+    std::map<std::string, std::string> names;
+    std::string merge;
+
+    std::string commit(const std::string &name,
+                       const std::string &content,
+                       const std::vector<std::string> &parents,
+                       uint64_t timestamp) {
+        std::string dir = this->fixture.write_loose(obj_type::obj_type_tree,
+                                                    __tree_entry("100644", "f.txt",
+                                                                 this->fixture.write_loose(obj_type::obj_type_blob,
+                                                                                           content)));
+        std::string root = this->fixture.write_loose(obj_type::obj_type_tree, __tree_entry("40000", "dir", dir));
+        std::string hex = this->fixture.write_loose(obj_type::obj_type_commit, __commit(root, parents, timestamp));
+        this->names[hex] = name;
+        return hex;
+    }
+
+    void SetUp() override {
+        std::string c1 = this->commit("c1", "a\nb\nc\nd\n", {}, 1);
+        std::string c2 = this->commit("c2", "a\nB\nc\nd\n", { c1 }, 2);
+        std::string c3 = this->commit("c3", "a\nb\nc\nx\nd\n", { c1 }, 3);
+        std::string c4 = this->commit("c4", "y\na\nB\nc\nd\n", { c2 }, 4);
+        this->merge = this->commit("merge", "y\na\nB\nc\nx\nd\n", { c4, c3 }, 5);
+    }
+
+    /**
+     * "<commit name> <line in that commit>" per final line
+     */
+    std::vector<std::string> describe(std::vector<blame_entry> &entries) {
+        std::vector<std::string> result;
+        for (auto itr = entries.begin(); itr != entries.end(); itr++) {
+            EXPECT_EQ(result.size() + 1, itr->final_start());
+            for (size_t i = 0; i < itr->count(); i++) {
+                result.push_back(this->names[itr->commit().str()] + " "
+                                 + std::to_string(itr->orig_start() + i));
+            }
+        }
+        return result;
+    }
+};
+
+TEST_F(blame_fixture, attribution) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    blame blamer(repo);
+
+    std::vector<std::string> expected = { "c4 1", "c1 1", "c2 2", "c1 3", "c3 4", "c1 4" };
+    EXPECT_EQ(expected, this->describe(blamer.run(sign_t(this->merge), "dir/f.txt")));
+    EXPECT_EQ(6, blamer.lines());
+
+    blamer.algorithm() = diff_algorithm::diff_algorithm_histogram;
+    EXPECT_EQ(expected, this->describe(blamer.run(sign_t(this->merge), "dir/f.txt")));
+}
+
+TEST_F(blame_fixture, callback) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    blame blamer(repo);
+
+    // entries come as soon as they're attributed, the newest commit first
+    std::vector<std::string> attributed;
+    size_t lines = 0;
+    blamer.run(sign_t(this->merge), "dir/f.txt", [&] (blame_entry &entry) {
+        attributed.push_back(this->names[entry.commit().str()]);
+        lines += entry.count();
+    });
+    EXPECT_EQ(6, lines);
+    ASSERT_FALSE(attributed.empty());
+    EXPECT_EQ("c4", attributed.front());
+    EXPECT_EQ("c1", attributed.back());
+    EXPECT_EQ(attributed.size(), blamer.entries().size());
+}
+
+TEST_F(blame_fixture, missing) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    blame blamer(repo);
+
+    EXPECT_TRUE(blamer.run(sign_t(this->merge), "dir/none.txt").empty());
+    EXPECT_EQ(0, blamer.lines());
+    EXPECT_TRUE(blamer.run(sign_t(this->merge), "dir").empty());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+#include "fsck.h"
+#include "test_repo.h"
+#include <string>
+
+using namespace gitter_kid::fsi;
+
+size_t __count(const fsck_report &report, fsck_issue_kind kind) {
+    size_t count = 0;
+    for (auto itr = report.issues.begin(); itr != report.issues.end(); itr++) {
+        count += itr->kind == kind;
+    }
+    return count;
+}
+
+TEST(fsck, clean) {
+    test_repo fixture;
+    std::string blob = fixture.write_loose(obj_type::obj_type_blob, "hello\n");
+    std::string tree = fixture.write_loose(obj_type::obj_type_tree,
+                                     __tree_entry("100644", "a.txt", blob)
+                                     + __tree_entry("40000", "a", blob));
+    fixture.set_ref("refs/heads/main", fixture.write_loose(obj_type::obj_type_commit, __commit(tree)));
+    fixture.write_loose(obj_type::obj_type_blob, "dangling\n");
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck checker(repo);
+    size_t progress_calls = 0;
+    checker.progress() = [&progress_calls] (const fsck_progress &) { progress_calls++; };
+    fsck_report report = checker.check();
+
+    EXPECT_TRUE(report.issues.empty());
+    EXPECT_TRUE(report.hashes_checked);
+    EXPECT_EQ(4, report.loose);
+    EXPECT_EQ(4, report.objects);
+    EXPECT_EQ(3, report.reachable);
+    EXPECT_EQ(1, report.unreachable);
+    EXPECT_LT(0, progress_calls);
+}
+
+TEST(fsck, corrupt_object) {
+    test_repo fixture;
+    std::string blob = fixture.write_loose(obj_type::obj_type_blob, "hello\n");
+    // stored under another object's id
+    fixture.write_loose(obj_type::obj_type_blob, "tampered\n", blob);
+    std::string tree = fixture.write_loose(obj_type::obj_type_tree,
+                                     __tree_entry("100644", "a.txt", blob));
+    fixture.set_ref("refs/heads/main", fixture.write_loose(obj_type::obj_type_commit, __commit(tree)));
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck_report report = fsck(repo).check();
+
+    ASSERT_EQ(1, report.issues.size());
+    EXPECT_EQ(fsck_issue_corrupt, report.issues[0].kind);
+    EXPECT_EQ(blob, report.issues[0].sign.str());
+}
+
+TEST(fsck, missing_objects) {
+    test_repo fixture;
+    const std::string absent = "b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0";
+    fixture.set_ref("refs/heads/main", fixture.write_loose(obj_type::obj_type_commit, __commit(absent)));
+    fixture.set_ref("refs/heads/gone", "c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0");
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck_report report = fsck(repo).check();
+
+    EXPECT_EQ(2, __count(report, fsck_issue_missing));
+    EXPECT_EQ(2, report.issues.size());
+    EXPECT_EQ(absent, report.issues[0].sign.str());
+
+    // links aren't followed without connectivity
+    fsck checker(repo);
+    checker.connectivity() = false;
+    EXPECT_TRUE(checker.check().issues.empty());
+}
+
+TEST(fsck, malformed) {
+    test_repo fixture;
+    std::string blob = fixture.write_loose(obj_type::obj_type_blob, "hello\n");
+    std::string unsorted = fixture.write_loose(obj_type::obj_type_tree,
+                                         __tree_entry("100644", "b", blob)
+                                         + __tree_entry("100644", "a", blob));
+    fixture.write_loose(obj_type::obj_type_tree,
+                  __tree_entry("100644", "a", blob)
+                  + __tree_entry("100644", "a", blob));
+    fixture.write_loose(obj_type::obj_type_commit, "tree " + unsorted + "\n\nno author\n");
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck checker(repo);
+    checker.connectivity() = false;
+    fsck_report report = checker.check();
+
+    EXPECT_EQ(4, __count(report, fsck_issue_malformed));
+    EXPECT_EQ(4, report.issues.size());
+}
+
+TEST(fsck, duplicate_entries) {
+    test_repo fixture;
+    std::string blob = fixture.write_loose(obj_type::obj_type_blob, "hello\n");
+    std::string subtree = fixture.write_loose(obj_type::obj_type_tree, __tree_entry("100644", "f", blob));
+    // sorted ("a" < "a-b" < "a/"), but "a" is both a file and a directory
+    fixture.write_loose(obj_type::obj_type_tree,
+                        __tree_entry("100644", "a", blob)
+                        + __tree_entry("100644", "a-b", blob)
+                        + __tree_entry("40000", "a", subtree));
+    // a directory sorting after a shorter file of the same prefix is fine
+    fixture.write_loose(obj_type::obj_type_tree,
+                        __tree_entry("100644", "a", blob)
+                        + __tree_entry("100644", "a-b", blob)
+                        + __tree_entry("40000", "a-b-c", subtree)
+                        + __tree_entry("40000", "a0", subtree));
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck checker(repo);
+    checker.connectivity() = false;
+    fsck_report report = checker.check();
+
+    ASSERT_EQ(1, report.issues.size());
+    EXPECT_EQ(fsck_issue_malformed, report.issues[0].kind);
+    EXPECT_EQ("tree: duplicate entry 'a'", report.issues[0].detail);
+}
+
+TEST(fsck, truncated_delta) {
+    test_repo fixture;
+    std::string base = "a base long enough to copy from\n";
+    // delta headers are base's size, then result's
+    std::string sizes = __test_varint(base.size()) + __test_varint(8);
+    fixture.write_pack({ { obj_type::obj_type_blob, base },
+                         // literal longer than the delta
+                         { obj_type::obj_type_blob, "literal\n", 0, false, sizes + char(0x10) + "lit" },
+                         // copy missing its offset and size bytes
+                         { obj_type::obj_type_blob, "copying\n", 0, false, sizes + char(0x91) },
+                         // cut in the result's size
+                         { obj_type::obj_type_blob, "header\n", 0, false, __test_varint(base.size()) + char(0x80) },
+                         // base's size doesn't match the base
+                         { obj_type::obj_type_blob, "based\n", 0, true, __test_varint(3) + __test_varint(3) + char(0x90) + char(3) } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck checker(repo);
+    checker.connectivity() = false;
+    fsck_report report = checker.check();
+
+    EXPECT_EQ(5, report.objects);
+    EXPECT_EQ(4, __count(report, fsck_issue_corrupt));
+    EXPECT_EQ(4, report.issues.size());
+    EXPECT_EQ(obj_type::obj_type_unknow,
+              repo.get(sign_t(__test_object_id(obj_type::obj_type_blob, "literal\n"))).type());
+    EXPECT_EQ(obj_type::obj_type_blob,
+              repo.get(sign_t(__test_object_id(obj_type::obj_type_blob, base))).type());
+}
+
+TEST(fsck, delta_cycles) {
+    test_repo fixture;
+    fixture.write_pack({ { obj_type::obj_type_blob, "plain\n" },
+                         // ofs delta whose base offset is 0, itself
+                         { obj_type::obj_type_blob, "itself\n", 1 },
+                         // ref deltas of each other
+                         { obj_type::obj_type_blob, "cycle a\n", 3, true },
+                         { obj_type::obj_type_blob, "cycle b\n", 2, true } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    fsck checker(repo);
+    checker.connectivity() = false;
+    fsck_report report = checker.check();
+
+    EXPECT_EQ(4, report.objects);
+    EXPECT_EQ(3, __count(report, fsck_issue_corrupt));
+    for (const char *content : { "itself\n", "cycle a\n", "cycle b\n" }) {
+        sign_t sign(__test_object_id(obj_type::obj_type_blob, content));
+        EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign).type());
+        obj_type type;
+        EXPECT_TRUE(repo.raw(sign, type).empty());
+    }
+    EXPECT_EQ(obj_type::obj_type_blob,
+              repo.get(sign_t(__test_object_id(obj_type::obj_type_blob, "plain\n"))).type());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
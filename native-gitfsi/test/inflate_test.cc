@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+#include "inflate.h"
+#include <string>
+
+using namespace gitter_kid::fsi;
+
+std::basic_string<byte> __deflate(const std::string &text) {
+    uLongf len = compressBound(text.size());
+    std::basic_string<byte> result(len, byte(0));
+    compress(const_cast<byte *>(result.data()), &len,
+             reinterpret_cast<const byte *>(text.data()), text.size());
+    result.resize(len);
+    return result;
+}
+
+std::string __text(const std::basic_string<byte> &bytes) {
+    return std::string(bytes.begin(), bytes.end());
+}
+
+std::string __sample() {
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+        text += "line " + std::to_string(i) + "\n";
+    }
+    return text;
+}
+
+TEST(inflate, exact_size) {
+    std::string text = __sample();
+    std::basic_string<byte> deflated = __deflate(text);
+
+    EXPECT_EQ(text, __text(__inflate(deflated, text.size())));
+}
+
+TEST(inflate, grows_past_hint) {
+    std::string text = __sample();
+    std::basic_string<byte> deflated = __deflate(text);
+
+    EXPECT_EQ(text, __text(__inflate(deflated, 0)));
+    EXPECT_EQ(text, __text(__inflate(deflated, 100)));
+    EXPECT_EQ(text, __text(__inflate(deflated, text.size() * 4)));
+}
+
+TEST(inflate, trailing_bytes) {
+    std::string text = __sample();
+    // pack segments are read with slack past the stream's end
+    std::basic_string<byte> deflated = __deflate(text) + __deflate("next object");
+
+    EXPECT_EQ(text, __text(__inflate(deflated, text.size())));
+}
+
+TEST(inflate, truncated) {
+    std::string text = __sample();
+    std::basic_string<byte> deflated = __deflate(text);
+    deflated.resize(deflated.size() / 2);
+
+    std::string inflated = __text(__inflate(deflated, text.size()));
+    EXPECT_LT(inflated.size(), text.size());
+    EXPECT_EQ(text.substr(0, inflated.size()), inflated);
+}
+
+TEST(inflate, prefix) {
+    std::string text = __sample();
+    std::basic_string<byte> deflated = __deflate(text);
+
+    EXPECT_EQ(text.substr(0, 32), __text(__inflate_prefix(deflated, 32)));
+    // streams reused across calls start over
+    EXPECT_EQ(text, __text(__inflate(deflated, text.size())));
+    EXPECT_EQ(text.substr(0, 8), __text(__inflate_prefix(deflated, 8)));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
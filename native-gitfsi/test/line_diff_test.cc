@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "line_diff.h"
+#include <string>
+
+std::basic_string<byte> __bytes(const std::string &str) {
+    return std::basic_string<byte>(str.begin(), str.end());
+}
+
+TEST(line_diff, split_lines) {
+    using namespace gitter_kid::fsi;
+
+    std::basic_string<byte> content = __bytes("first line\nsecond line which is longer than sixteen\n\nlast");
+    std::vector<line_span_s> lines = split_lines(content);
+
+    EXPECT_EQ(4, lines.size());
+    EXPECT_EQ(0, lines[0].off);
+    EXPECT_EQ(11, lines[0].len);
+    EXPECT_EQ(1, lines[2].len);
+    EXPECT_EQ(4, lines[3].len);
+}
+
+TEST(line_diff, myers) {
+    using namespace gitter_kid::fsi;
+
+    std::basic_string<byte> old_content = __bytes("a\nb\nc\nd\ne\nf\ng\n");
+    std::basic_string<byte> new_content = __bytes("a\nb\nx\nd\ne\nf\ng\ny\n");
+
+    line_diff diff;
+    diff.context() = 1;
+    diff.diff(old_content, new_content);
+
+    EXPECT_EQ(2, diff.hunks().size());
+    EXPECT_EQ("@@ -2,3 +2,3 @@", diff.hunks()[0].header());
+    EXPECT_EQ("@@ -7 +7,2 @@", diff.hunks()[1].header());
+    EXPECT_EQ("@@ -2,3 +2,3 @@\n b\n-c\n+x\n d\n@@ -7 +7,2 @@\n g\n+y\n", diff.unified());
+}
+
+TEST(line_diff, histogram) {
+    using namespace gitter_kid::fsi;
+
+    std::basic_string<byte> old_content = __bytes("}\nint a;\n}\nint b;\n}\n");
+    std::basic_string<byte> new_content = __bytes("}\nint b;\n}\n");
+
+    line_diff diff;
+    diff.algorithm() = diff_algorithm::diff_algorithm_histogram;
+    diff.diff(old_content, new_content);
+
+    EXPECT_EQ(1, diff.hunks().size());
+    EXPECT_EQ(3, diff.hunks()[0].new_count());
+    EXPECT_EQ(5, diff.hunks()[0].old_count());
+}
+
+TEST(line_diff, binary) {
+    using namespace gitter_kid::fsi;
+
+    std::basic_string<byte> old_content = __bytes("text\n");
+    std::basic_string<byte> new_content = __bytes("text\n");
+    new_content.push_back(0);
+
+    line_diff diff;
+    diff.diff(old_content, new_content);
+    EXPECT_TRUE(diff.binary());
+    EXPECT_TRUE(diff.hunks().empty());
+
+    diff.old_binary() = true;
+    diff.diff(old_content, old_content);
+    EXPECT_TRUE(diff.binary());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
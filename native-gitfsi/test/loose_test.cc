@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "repository.h"
+#include "test_repo.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gitter_kid::fsi;
+
+/**
+ * a blob content whose id shares hex's fan-out directory
+ */
+std::string __same_dir(const std::string &hex) {
+    for (int i = 0; ; i++) {
+        std::string content = "neighbour " + std::to_string(i) + "\n";
+        if (__test_object_id(obj_type::obj_type_blob, content).compare(0, 2, hex, 0, 2) == 0) {
+            return content;
+        }
+    }
+}
+
+std::string __body(object &obj) {
+    std::basic_string<byte> &content = obj.get<blob>().body();
+    return std::string(content.begin(), content.end());
+}
+
+TEST(loose_dir, written_after_cached) {
+    test_repo fixture;
+    std::string first = fixture.write_loose(obj_type::obj_type_blob, "first\n");
+    repository repo(fixture.path());
+    repo.initialize_packs();
+
+    // the lookup caches first's fan-out directory
+    ASSERT_EQ(obj_type::obj_type_blob, repo.get(sign_t(first)).type());
+
+    std::string content = __same_dir(first);
+    std::string second = fixture.write_loose(obj_type::obj_type_blob, content);
+    fixture.touch("objects/" + first.substr(0, 2));
+    object obj = repo.get(sign_t(second));
+    ASSERT_EQ(obj_type::obj_type_blob, obj.type());
+    EXPECT_EQ(content, __body(obj));
+
+    std::vector<sign_t> loose = repo.loose_objects();
+    EXPECT_EQ(2, loose.size());
+    EXPECT_NE(loose.end(), std::find(loose.begin(), loose.end(), sign_t(second)));
+}
+
+TEST(loose_dir, deleted_after_cached) {
+    test_repo fixture;
+    // packed and loose, like right after a repack that hasn't pruned yet
+    std::string packed = fixture.write_loose(obj_type::obj_type_blob, "packed\n");
+    fixture.write_pack({ { obj_type::obj_type_blob, "packed\n" } });
+    std::string gone = fixture.write_loose(obj_type::obj_type_blob, __same_dir(packed));
+    repository repo(fixture.path());
+    repo.initialize_packs();
+
+    ASSERT_EQ(obj_type::obj_type_blob, repo.get(sign_t(packed)).type());
+    ASSERT_EQ(obj_type::obj_type_blob, repo.get(sign_t(gone)).type());
+    ASSERT_EQ(2, repo.loose_objects().size());
+
+    // the cached names are stale: packed falls through to its pack, gone
+    // is missing, and neither is listed once the directory is reread
+    std::remove(repo.looseobj_path(sign_t(packed)).c_str());
+    std::remove(repo.looseobj_path(sign_t(gone)).c_str());
+    object obj = repo.get(sign_t(packed));
+    ASSERT_EQ(obj_type::obj_type_blob, obj.type());
+    EXPECT_EQ("packed\n", __body(obj));
+    EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign_t(gone)).type());
+
+    fixture.touch("objects/" + packed.substr(0, 2));
+    EXPECT_TRUE(repo.loose_objects().empty());
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(packed)).type());
+}
+
+TEST(loose_dir, concurrent_readers) {
+    test_repo fixture;
+    std::vector<std::string> written;
+    for (int i = 0; i < 64; i++) {
+        written.push_back(fixture.write_loose(obj_type::obj_type_blob, "blob " + std::to_string(i) + "\n"));
+    }
+    // an id's length, but not an object
+    fixture.write_file("objects/" + written[0].substr(0, 2) + "/" + std::string(38, 'x'), "");
+    repository repo(fixture.path());
+    repo.initialize_packs();
+
+    // the first reader touches directories the others may be reading
+    std::vector<std::thread> readers;
+    std::vector<size_t> found(4, 0);
+    for (size_t r = 0; r < found.size(); r++) {
+        readers.push_back(std::thread([&, r] () -> void {
+            for (size_t i = r; i < written.size(); i++) {
+                found[r] += repo.get(sign_t(written[i])).type() == obj_type::obj_type_blob;
+                if (r == 0) {
+                    fixture.touch("objects/" + written[i].substr(0, 2));
+                }
+            }
+        }));
+    }
+    for (auto itr = readers.begin(); itr != readers.end(); itr++) {
+        itr->join();
+    }
+    for (size_t r = 0; r < found.size(); r++) {
+        EXPECT_EQ(written.size() - r, found[r]);
+    }
+    EXPECT_EQ(written.size(), repo.loose_objects().size());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
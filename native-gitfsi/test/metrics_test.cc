@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include "metrics.h"
+#include <string>
+#include <thread>
+
+using namespace gitter_kid::fsi;
+
+TEST(metrics, counters) {
+    uint64_t before = metrics::snapshot().counters[metric_counter_pack_opens];
+    metrics::add(metric_counter_pack_opens, 3);
+    metrics::add(metric_counter_pack_opens, 2);
+
+    EXPECT_EQ(before + 5, metrics::snapshot().counters[metric_counter_pack_opens]);
+}
+
+TEST(metrics, exited_thread_kept) {
+    uint64_t before = metrics::snapshot().counters[metric_counter_pool_misses];
+    std::thread worker([]() {
+        metrics::add(metric_counter_pool_misses, 7);
+    });
+    worker.join();
+
+    EXPECT_EQ(before + 7, metrics::snapshot().counters[metric_counter_pool_misses]);
+}
+
+TEST(metrics, histogram_buckets) {
+    metrics_histogram before = metrics::snapshot().histograms[metric_histogram_delta_depth];
+    metrics::observe(metric_histogram_delta_depth, 0);
+    metrics::observe(metric_histogram_delta_depth, 1);
+    metrics::observe(metric_histogram_delta_depth, 5);
+    metrics::observe(metric_histogram_delta_depth, 7);
+
+    metrics_histogram after = metrics::snapshot().histograms[metric_histogram_delta_depth];
+    EXPECT_EQ(before.count + 4, after.count);
+    EXPECT_EQ(before.sum + 13, after.sum);
+    EXPECT_EQ(before.buckets[0] + 1, after.buckets[0]);
+    EXPECT_EQ(before.buckets[1] + 1, after.buckets[1]);
+    // [4, 8)
+    EXPECT_EQ(before.buckets[3] + 2, after.buckets[3]);
+}
+
+TEST(metrics, prometheus) {
+    metrics::observe(metric_histogram_get_ns, 1000);
+    std::string text = metrics::prometheus();
+
+    EXPECT_NE(std::string::npos, text.find("# TYPE gitfsi_lookups_loose_total counter\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE gitfsi_get_seconds histogram\n"));
+    EXPECT_NE(std::string::npos, text.find("gitfsi_get_seconds_bucket{le=\"+Inf\"} "));
+    EXPECT_NE(std::string::npos, text.find("gitfsi_get_seconds_count "));
+    // 1000ns falls in [512, 1024)
+    EXPECT_NE(std::string::npos, text.find("gitfsi_get_seconds_bucket{le=\"1.023e-06\"} "));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -3,6 +3,9 @@
 #include "blob.h"
 #include "tree.h"
 #include "inflate.h"
+#include "arena.h"
+#include "repository.h"
+#include "test_repo.h"
 #include <fstream>
 #include <cstring>
 #include <iomanip>
@@ -92,6 +95,174 @@ TEST(object, commit) {
     EXPECT_EQ(obj_type::obj_type_commit, obj.type());
 }
 
+TEST(object, tag) {
+    using namespace gitter_kid::fsi;
+
+    std::string raw("object 7c077eb4df6e3a9bdcdab9b2aaa2d460e81a32ba\n"
+                    "type commit\n"
+                    "tag v1.0\n"
+                    "tagger Release Bot <bot@example.com> 1500000000 +0800\n"
+                    "\n"
+                    "first release\n");
+    std::string header = "tag " + std::to_string(raw.size());
+    std::basic_string<byte> buffer(header.begin(), header.end());
+    buffer.push_back(0);
+    buffer.append(raw.begin(), raw.end());
+
+    object obj(buffer);
+
+    EXPECT_EQ(obj_type::obj_type_tag, obj.type());
+    EXPECT_EQ("7c077eb4df6e3a9bdcdab9b2aaa2d460e81a32ba", obj.get<tag>().get().obj_sign());
+    EXPECT_EQ(obj_type::obj_type_commit, obj.get<tag>().get().type());
+    EXPECT_EQ("v1.0", obj.get<tag>().get().name());
+    EXPECT_EQ("Release Bot", obj.get<tag>().get().tagger().name());
+    EXPECT_EQ(1500000000, obj.get<tag>().get().tagger().timestamp());
+    EXPECT_EQ("+0800", obj.get<tag>().get().tagger().timezone());
+    EXPECT_EQ("first release\n", obj.get<tag>().get().message());
+}
+
+TEST(object, move) {
+    using namespace gitter_kid::fsi;
+
+    std::string raw("blob 5");
+    std::basic_string<byte> buffer(raw.begin(), raw.end());
+    buffer.push_back(0);
+    buffer.append(reinterpret_cast<const byte *>("hello"), 5);
+
+    object obj(std::move(buffer));
+    object moved(std::move(obj));
+
+    EXPECT_EQ(obj_type::obj_type_unknow, obj.type());
+    EXPECT_EQ(obj_type::obj_type_blob, moved.type());
+    EXPECT_EQ(5, moved.get<blob>().body().size());
+
+    obj = std::move(moved);
+    EXPECT_EQ(obj_type::obj_type_blob, obj.type());
+    EXPECT_EQ(obj_type::obj_type_unknow, moved.type());
+}
+
+TEST(object, arena) {
+    using namespace gitter_kid::fsi;
+
+    std::string entry("100644 a.txt");
+    entry.push_back(0);
+    entry.append(20, '\x11');
+    std::string raw = "tree " + std::to_string(entry.size());
+    raw.push_back(0);
+    raw += entry;
+
+    arena request_arena;
+    sign_t copied;
+    {
+        arena_scope scope(request_arena);
+        object obj(std::basic_string<byte>(raw.begin(), raw.end()));
+
+        ASSERT_EQ(obj_type::obj_type_tree, obj.type());
+        EXPECT_EQ(1, obj.get<tree>().items().size());
+        // entries' ids are in the arena too, copies of them aren't
+        sign_t &sign = obj.get<tree>().items()[0].sign();
+        EXPECT_TRUE(sign.bytes().get_allocator() == arena_allocator<byte>(&request_arena));
+        copied = sign;
+        EXPECT_TRUE(copied.bytes().get_allocator() == arena_allocator<byte>());
+    }
+    EXPECT_LT(0, request_arena.allocated());
+    EXPECT_EQ(nullptr, arena::current());
+
+    request_arena.release();
+    EXPECT_EQ(std::string(40, '1'), copied.str());
+}
+
+TEST(object, arena_pack_refresh) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    repository repo(fixture.path());
+    repo.initialize_packs();
+
+    std::string content = "packed later\n";
+    std::string blob_hex = __test_object_id(obj_type::obj_type_blob, content);
+    std::string tree_content = __tree_entry("100644", "a.txt", blob_hex);
+    std::string tree_hex = __test_object_id(obj_type::obj_type_tree, tree_content);
+    fixture.write_pack({ { obj_type::obj_type_blob, content }, { obj_type::obj_type_tree, tree_content } });
+
+    arena request_arena;
+    {
+        // the miss refreshes packs under the request's arena
+        object obj = repo.get(sign_t(tree_hex), request_arena);
+        ASSERT_EQ(obj_type::obj_type_tree, obj.type());
+        EXPECT_EQ(1, obj.get<tree>().items().size());
+    }
+    EXPECT_LT(0, request_arena.allocated());
+
+    // indexes outlive the request, they're on the heap
+    std::vector<__pack_idx_s> &indexes = repo.packs()->front()->off_index();
+    ASSERT_EQ(2, indexes.size());
+    for (auto itr = indexes.begin(); itr != indexes.end(); itr++) {
+        EXPECT_TRUE(itr->sign.bytes().get_allocator() == arena_allocator<byte>());
+    }
+
+    request_arena.release();
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(blob_hex)).type());
+    EXPECT_EQ(obj_type::obj_type_tree, repo.get(sign_t(tree_hex)).type());
+}
+
+TEST(object, tree_sha256) {
+    using namespace gitter_kid::fsi;
+
+    std::string entries;
+    for (const char *name : { "a.txt", "dir" }) {
+        entries += std::string(name[0] == 'd' ? "40000 " : "100644 ") + name;
+        entries.push_back(0);
+        entries.append(SIGN_SHA256_LEN, name[0]);
+    }
+    std::string raw = "tree " + std::to_string(entries.size());
+    raw.push_back(0);
+    raw += entries;
+
+    object obj(std::basic_string<byte>(raw.begin(), raw.end()), SIGN_SHA256_LEN);
+    ASSERT_EQ(obj_type::obj_type_tree, obj.type());
+    tree_items &items = obj.get<tree>().items();
+    ASSERT_EQ(2, items.size());
+    EXPECT_EQ("a.txt", items[0].name());
+    std::string a_hex;
+    for (size_t i = 0; i < SIGN_SHA256_LEN; i++) {
+        a_hex += "61";
+    }
+    EXPECT_EQ(a_hex, items[0].sign().str());
+    EXPECT_EQ(SIGN_SHA256_LEN, items[1].sign().bytes().size());
+    EXPECT_EQ(obj_type::obj_type_tree, items[1].type());
+
+    // a truncated entry is dropped instead of read past the end
+    object truncated(std::basic_string<byte>(raw.begin(), raw.end() - 1), SIGN_SHA256_LEN);
+    ASSERT_EQ(obj_type::obj_type_tree, truncated.type());
+    EXPECT_EQ(1, truncated.get<tree>().items().size());
+}
+
+TEST(blob, classify_content) {
+    using namespace gitter_kid::fsi;
+
+    std::string text("plain text\twith tabs\r\nand lines\n");
+    EXPECT_EQ(blob_class::blob_class_text,
+              classify_content(reinterpret_cast<const byte *>(text.data()),
+                               reinterpret_cast<const byte *>(text.data() + text.size())));
+
+    std::basic_string<byte> nul(4096, byte('a'));
+    nul[4000] = 0;
+    EXPECT_EQ(blob_class::blob_class_binary,
+              classify_content(nul.data(), nul.data() + nul.size()));
+
+    // NUL after the sniffed bytes is ignored
+    std::basic_string<byte> tail(BLOB_SNIFF_LEN + 16, byte('a'));
+    tail.back() = 0;
+    EXPECT_EQ(blob_class::blob_class_text,
+              classify_content(tail.data(), tail.data() + tail.size()));
+
+    std::basic_string<byte> control(64, byte('a'));
+    control[3] = 0x01;
+    EXPECT_EQ(blob_class::blob_class_binary,
+              classify_content(control.data(), control.data() + control.size()));
+}
+
 int main(int, char **argv) {
     size_t size = strlen(argv[1]);
     path.assign(argv[1], argv[1] + size);
@@ -0,0 +1,328 @@
+#include "gtest/gtest.h"
+#include "repository.h"
+#include "pack.h"
+#include "test_repo.h"
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace gitter_kid::fsi;
+
+class pack_fixture : public testing::Test {
+protected:
+    test_repo fixture;
+    // blob contents by id, in pack order
+    std::vector<std::pair<std::string, std::string>> blobs;
+
+    /**
+     * pack: a, b (ofs delta of a), c (ofs delta of b), d (ref delta of a), e
+     */
+    void SetUp() override {
+        std::string a;
+        for (int i = 0; i < 20; i++) {
+            a += "base line " + std::to_string(i) + "\n";
+        }
+        std::string b = a.substr(0, 100) + "b\n";
+        std::string c = b.substr(0, 50) + "c\n";
+        std::string d = a.substr(0, 150) + "d\n";
+        std::string e = "solo\n";
+
+        this->fixture.write_pack({ { obj_type::obj_type_blob, a },
+                                   { obj_type::obj_type_blob, b, 0 },
+                                   { obj_type::obj_type_blob, c, 1 },
+                                   { obj_type::obj_type_blob, d, 0, true },
+                                   { obj_type::obj_type_blob, e } });
+        for (const std::string &content : { a, b, c, d, e }) {
+            this->blobs.push_back(std::make_pair(__test_raw_sign(__test_object_id(obj_type::obj_type_blob, content)),
+                                                 content));
+        }
+    }
+};
+
+/**
+ * contents delivered by get_many, by raw id; every id must come once
+ */
+std::map<std::string, std::string> __get_many(repository &repo, const std::vector<sign_t> &signs) {
+    std::map<std::string, std::string> delivered;
+    repo.get_many(signs, [&delivered] (sign_t &sign, object &obj) {
+        std::string id(sign.bytes().begin(), sign.bytes().end());
+        EXPECT_EQ(0, delivered.count(id));
+        if (obj.type() != obj_type::obj_type_blob) {
+            delivered[id] = "<missing>";
+            return;
+        }
+        std::basic_string<byte> &content = obj.get<blob>().body();
+        delivered[id] = std::string(content.begin(), content.end());
+    });
+    return delivered;
+}
+
+TEST_F(pack_fixture, scan) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    std::vector<__pack_node_s> nodes;
+    repo.packs()->front()->scan(nodes);
+
+    ASSERT_EQ(5, nodes.size());
+    EXPECT_EQ(3, nodes[0].type);
+    EXPECT_EQ(PACK_NODE_ROOT, nodes[0].base);
+    EXPECT_EQ(6, nodes[1].type);
+    EXPECT_EQ(0, nodes[1].base);
+    EXPECT_EQ(6, nodes[2].type);
+    EXPECT_EQ(1, nodes[2].base);
+    EXPECT_EQ(7, nodes[3].type);
+    EXPECT_EQ(0, nodes[3].base);
+    EXPECT_EQ(PACK_NODE_ROOT, nodes[4].base);
+    EXPECT_EQ(this->blobs[4].second.size(), nodes[4].size);
+}
+
+TEST_F(pack_fixture, scan_sizes) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    std::vector<__pack_node_s> nodes;
+    repo.packs()->front()->scan(nodes, true);
+
+    // deltas' sizes are their results', in offset order as packed
+    ASSERT_EQ(5, nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        EXPECT_EQ(this->blobs[i].second.size(), nodes[i].size);
+    }
+    EXPECT_EQ(1, nodes[2].base);
+}
+
+TEST_F(pack_fixture, for_each) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    std::shared_ptr<const pack_list> packs = repo.packs();
+
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        std::map<std::string, std::string> delivered;
+        std::mutex delivered_mutex;
+        packs->front()->for_each(*packs, [&] (unsigned worker, sign_t &sign, object &obj) {
+            EXPECT_LT(worker, threads);
+            ASSERT_EQ(obj_type::obj_type_blob, obj.type());
+            std::basic_string<byte> &content = obj.get<blob>().body();
+            std::lock_guard<std::mutex> lock(delivered_mutex);
+            std::string id(sign.bytes().begin(), sign.bytes().end());
+            EXPECT_EQ(0, delivered.count(id));
+            delivered[id] = std::string(content.begin(), content.end());
+        }, threads, true);
+
+        ASSERT_EQ(this->blobs.size(), delivered.size());
+        for (auto itr = this->blobs.begin(); itr != this->blobs.end(); itr++) {
+            EXPECT_EQ(itr->second, delivered[itr->first]);
+        }
+    }
+}
+
+TEST_F(pack_fixture, for_each_types) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+    std::shared_ptr<const pack_list> packs = repo.packs();
+
+    std::atomic<size_t> delivered(0);
+    packs->front()->for_each(*packs, [&delivered] (unsigned, sign_t &, object &) {
+        delivered++;
+    }, 2, false, (1 << obj_type::obj_type_tree) | (1 << obj_type::obj_type_commit));
+    EXPECT_EQ(0, delivered.load());
+
+    packs->front()->for_each(*packs, [&delivered] (unsigned, sign_t &, object &) {
+        delivered++;
+    }, 2, false, 1 << obj_type::obj_type_blob);
+    EXPECT_EQ(this->blobs.size(), delivered.load());
+}
+
+TEST_F(pack_fixture, get_many) {
+    std::string loose = this->fixture.write_loose(obj_type::obj_type_blob, "loose\n");
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    // b, c and d are deltas sharing a, which isn't asked for: bases
+    // resolved within the batch give the same bytes as get
+    std::vector<sign_t> signs;
+    for (size_t i : { 2, 3, 1 }) {
+        signs.push_back(sign_t());
+        signs.back().bytes_assign(this->blobs[i].first.begin(), this->blobs[i].first.end());
+    }
+    signs.push_back(sign_t(loose));
+    std::map<std::string, std::string> delivered = __get_many(repo, signs);
+
+    ASSERT_EQ(signs.size(), delivered.size());
+    for (auto itr = signs.begin(); itr != signs.end(); itr++) {
+        object obj = repo.get(*itr);
+        ASSERT_EQ(obj_type::obj_type_blob, obj.type());
+        std::basic_string<byte> &content = obj.get<blob>().body();
+        EXPECT_EQ(std::string(content.begin(), content.end()),
+                  delivered[std::string(itr->bytes().begin(), itr->bytes().end())]);
+    }
+    EXPECT_EQ(this->blobs[2].second, delivered[this->blobs[2].first]);
+    EXPECT_EQ("loose\n", delivered[__test_raw_sign(loose)]);
+}
+
+TEST_F(pack_fixture, get_many_all) {
+    std::string loose = this->fixture.write_loose(obj_type::obj_type_blob, "loose\n");
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    // the whole pack along with a loose object, in reverse pack order
+    std::vector<sign_t> signs = { sign_t(loose) };
+    for (auto itr = this->blobs.rbegin(); itr != this->blobs.rend(); itr++) {
+        signs.push_back(sign_t());
+        signs.back().bytes_assign(itr->first.begin(), itr->first.end());
+    }
+    std::map<std::string, std::string> delivered = __get_many(repo, signs);
+
+    ASSERT_EQ(this->blobs.size() + 1, delivered.size());
+    for (auto itr = this->blobs.begin(); itr != this->blobs.end(); itr++) {
+        EXPECT_EQ(itr->second, delivered[itr->first]);
+    }
+    EXPECT_EQ("loose\n", delivered[__test_raw_sign(loose)]);
+}
+
+TEST_F(pack_fixture, get_many_duplicates) {
+    std::string loose = this->fixture.write_loose(obj_type::obj_type_blob, "loose\n");
+    std::string missing(40, 'e');
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    sign_t c;
+    c.bytes_assign(this->blobs[2].first.begin(), this->blobs[2].first.end());
+    sign_t a;
+    a.bytes_assign(this->blobs[0].first.begin(), this->blobs[0].first.end());
+
+    // each distinct id comes exactly once, missing ones as obj_type_unknow
+    std::map<std::string, std::string> delivered = __get_many(repo, { c, sign_t(missing), c, a, sign_t(loose),
+                                                                      sign_t(missing), sign_t(loose), c });
+    ASSERT_EQ(4, delivered.size());
+    EXPECT_EQ(this->blobs[2].second, delivered[this->blobs[2].first]);
+    EXPECT_EQ(this->blobs[0].second, delivered[this->blobs[0].first]);
+    EXPECT_EQ("loose\n", delivered[__test_raw_sign(loose)]);
+    EXPECT_EQ("<missing>", delivered[__test_raw_sign(missing)]);
+
+    EXPECT_TRUE(__get_many(repo, {}).empty());
+}
+
+TEST(pack_refresh, add_remove_while_held) {
+    test_repo fixture;
+    std::string first = fixture.write_pack({ { obj_type::obj_type_blob, "first\n" } });
+    std::string first_hex = __test_object_id(obj_type::obj_type_blob, "first\n");
+    std::string second_hex = __test_object_id(obj_type::obj_type_blob, "second\n");
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    ASSERT_EQ(1, repo.pack_count());
+
+    // a reader holds the first snapshot through both refreshes
+    std::atomic<int> phase(0);
+    std::atomic<size_t> bad_reads(0);
+    std::thread holder([&] () {
+        std::shared_ptr<const pack_list> snapshot = repo.packs();
+        phase = 1;
+        int seen;
+        do {
+            seen = phase.load();
+            object obj = snapshot->front()->get(*snapshot, sign_t(first_hex));
+            if (snapshot->size() != 1 || obj.type() != obj_type::obj_type_blob
+                || obj.get<blob>().body() != std::basic_string<byte>(reinterpret_cast<const byte *>("first\n"))) {
+                bad_reads++;
+            }
+        } while (seen != 3);
+    });
+    while (phase.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    // added after open: the lookup miss picks it up
+    fixture.write_pack({ { obj_type::obj_type_blob, "second\n" } });
+    fixture.touch("objects/pack");
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(second_hex)).type());
+    EXPECT_EQ(2, repo.pack_count());
+    phase = 2;
+
+    // removed: retired on the next miss, its objects are gone
+    std::remove((first + ".pack").c_str());
+    std::remove((first + ".idx").c_str());
+    fixture.touch("objects/pack");
+    EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign_t(std::string(40, 'e'))).type());
+    EXPECT_EQ(1, repo.pack_count());
+    EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign_t(first_hex)).type());
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(second_hex)).type());
+    phase = 3;
+
+    // the retired pack stayed readable until its last reader let it go
+    holder.join();
+    EXPECT_EQ(0, bad_reads.load());
+}
+
+TEST(pack_refresh, empty_and_incomplete) {
+    test_repo fixture;
+    // git pack-objects with no input writes a valid empty pack
+    fixture.write_pack({});
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    ASSERT_EQ(1, repo.pack_count());
+    EXPECT_TRUE(repo.packs()->front()->off_index().empty());
+    EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign_t(std::string(40, 'e'))).type());
+
+    // an idx whose pack is gone (removed by a repack mid-scan) is left out
+    std::string removed = fixture.write_pack({ { obj_type::obj_type_blob, "removed\n" } });
+    std::remove((removed + ".pack").c_str());
+    repo.refresh_packs();
+    EXPECT_EQ(1, repo.pack_count());
+    EXPECT_EQ(obj_type::obj_type_unknow,
+              repo.get(sign_t(__test_object_id(obj_type::obj_type_blob, "removed\n"))).type());
+}
+
+TEST(pack, for_each_broken_root) {
+    test_repo fixture;
+    // an ofs delta whose base offset is 0 has no base in the pack
+    fixture.write_pack({ { obj_type::obj_type_blob, "plain\n" },
+                         { obj_type::obj_type_blob, "itself\n", 1 },
+                         { obj_type::obj_type_blob, "child\n", 1 } });
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    std::shared_ptr<const pack_list> packs = repo.packs();
+
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        std::map<std::string, obj_type> delivered;
+        std::mutex delivered_mutex;
+        packs->front()->for_each(*packs, [&] (unsigned, sign_t &sign, object &obj) {
+            std::lock_guard<std::mutex> lock(delivered_mutex);
+            EXPECT_EQ(0, delivered.count(sign.str()));
+            delivered[sign.str()] = obj.type();
+        }, threads);
+
+        ASSERT_EQ(3, delivered.size());
+        EXPECT_EQ(obj_type::obj_type_blob, delivered[__test_object_id(obj_type::obj_type_blob, "plain\n")]);
+        EXPECT_EQ(obj_type::obj_type_unknow, delivered[__test_object_id(obj_type::obj_type_blob, "itself\n")]);
+        EXPECT_EQ(obj_type::obj_type_unknow, delivered[__test_object_id(obj_type::obj_type_blob, "child\n")]);
+    }
+}
+
+TEST_F(pack_fixture, header) {
+    std::string commit_content = __commit(std::string(40, '1'));
+    std::string loose = this->fixture.write_loose(obj_type::obj_type_commit, commit_content);
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    // deltas' sizes and types come from their headers and chains
+    for (auto itr = this->blobs.begin(); itr != this->blobs.end(); itr++) {
+        sign_t sign;
+        sign.bytes_assign(itr->first.begin(), itr->first.end());
+        obj_type type;
+        EXPECT_EQ(itr->second.size(), repo.header(sign, type));
+        EXPECT_EQ(obj_type::obj_type_blob, type);
+    }
+
+    obj_type type;
+    EXPECT_EQ(commit_content.size(), repo.header(sign_t(loose), type));
+    EXPECT_EQ(obj_type::obj_type_commit, type);
+    EXPECT_EQ(0, repo.header(sign_t(std::string(40, 'e')), type));
+    EXPECT_EQ(obj_type::obj_type_unknow, type);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+#include "rename.h"
+#include "test_repo.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::string __content(int from, int to) {
+    std::string content;
+    for (int i = from; i < to; i++) {
+        content += "line " + std::to_string(i) + " of similarity content\n";
+    }
+    return content;
+}
+
+std::basic_string<byte> __lines(int from, int to) {
+    std::string content = __content(from, to);
+    return std::basic_string<byte>(content.begin(), content.end());
+}
+
+/**
+ * write a tree of files (name, content) or subtrees (name ending in '/',
+ * tree id), entries in the given order
+ */
+std::string __tree(test_repo &fixture, const std::vector<std::pair<std::string, std::string>> &entries) {
+    using namespace gitter_kid::fsi;
+
+    std::string content;
+    for (auto itr = entries.begin(); itr != entries.end(); itr++) {
+        if (itr->first.back() == '/') {
+            content += __tree_entry("40000", itr->first.substr(0, itr->first.size() - 1), itr->second);
+        }
+        else {
+            content += __tree_entry("100644", itr->first, fixture.write_loose(obj_type::obj_type_blob, itr->second));
+        }
+    }
+    return fixture.write_loose(obj_type::obj_type_tree, content);
+}
+
+/**
+ * "<status> <old path> <new path>" per item, sorted
+ */
+std::vector<std::string> __describe(std::vector<gitter_kid::fsi::tree_diff_item> &items) {
+    const char codes[] = "ADMRC";
+    std::vector<std::string> result;
+    for (auto itr = items.begin(); itr != items.end(); itr++) {
+        result.push_back(std::string(1, codes[itr->status()]) + " " + itr->old_path() + " " + itr->new_path());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+gitter_kid::fsi::tree_diff_item *__find(std::vector<gitter_kid::fsi::tree_diff_item> &items,
+                                        const std::string &new_path) {
+    for (auto itr = items.begin(); itr != items.end(); itr++) {
+        if (itr->new_path() == new_path) {
+            return &*itr;
+        }
+    }
+    return nullptr;
+}
+
+TEST(similarity_fingerprint, identical) {
+    using namespace gitter_kid::fsi;
+
+    similarity_fingerprint a(__lines(0, 100));
+    similarity_fingerprint b(__lines(0, 100));
+
+    EXPECT_EQ(100, a.score(b));
+}
+
+TEST(similarity_fingerprint, partial) {
+    using namespace gitter_kid::fsi;
+
+    similarity_fingerprint a(__lines(0, 100));
+    similarity_fingerprint b(__lines(0, 75));
+    similarity_fingerprint c(__lines(100, 200));
+
+    EXPECT_NEAR(75, a.score(b), 2);
+    EXPECT_EQ(a.score(b), b.score(a));
+    EXPECT_EQ(0, a.score(c));
+}
+
+TEST(similarity_fingerprint, empty) {
+    using namespace gitter_kid::fsi;
+
+    similarity_fingerprint a;
+    similarity_fingerprint b(__lines(0, 10));
+
+    EXPECT_EQ(0, a.score(b));
+}
+
+TEST(tree_diff, changes) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    std::string old_dir = __tree(fixture, { { "b.txt", "b\n" } });
+    std::string new_dir = __tree(fixture, { { "b.txt", "b\n" }, { "c.txt", "c\n" } });
+    std::string gone_dir = __tree(fixture, { { "x.txt", "x\n" } });
+    std::string old_tree = __tree(fixture, { { "a.txt", "a\n" },
+                                             { "dir/", old_dir },
+                                             { "gone.txt", "gone\n" },
+                                             { "old/", gone_dir },
+                                             { "same.txt", "same\n" } });
+    std::string new_tree = __tree(fixture, { { "a.txt", "a2\n" },
+                                             { "dir/", new_dir },
+                                             { "new.txt", "new\n" },
+                                             { "same.txt", "same\n" } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    tree_diff diff(repo, sign_t(old_tree), sign_t(new_tree));
+
+    std::vector<std::string> expected = { "A  dir/c.txt",
+                                          "A  new.txt",
+                                          "D gone.txt ",
+                                          "D old/x.txt ",
+                                          "M a.txt a.txt" };
+    EXPECT_EQ(expected, __describe(diff.items()));
+}
+
+TEST(rename_detector, exact) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    std::string old_tree = __tree(fixture, { { "a.txt", __content(0, 10) }, { "b.txt", "b\n" } });
+    std::string new_tree = __tree(fixture, { { "b.txt", "b\n" }, { "moved.txt", __content(0, 10) }, { "n.txt", "n\n" } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    tree_diff diff(repo, sign_t(old_tree), sign_t(new_tree));
+    rename_detector(repo).detect(diff.items());
+
+    std::vector<std::string> expected = { "A  n.txt", "R a.txt moved.txt" };
+    EXPECT_EQ(expected, __describe(diff.items()));
+    EXPECT_EQ(100, __find(diff.items(), "moved.txt")->similarity());
+}
+
+TEST(rename_detector, similarity) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    // 90 of 100 lines kept, then 40 of 100
+    std::string old_tree = __tree(fixture, { { "close.txt", __content(0, 100) },
+                                             { "far.txt", __content(200, 300) } });
+    std::string new_tree = __tree(fixture, { { "close2.txt", __content(0, 90) + __content(1000, 1010) },
+                                             { "far2.txt", __content(200, 240) + __content(2000, 2060) } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    tree_diff diff(repo, sign_t(old_tree), sign_t(new_tree));
+    rename_detector detector(repo);
+    detector.detect(diff.items());
+
+    std::vector<std::string> expected = { "A  far2.txt", "D far.txt ", "R close.txt close2.txt" };
+    EXPECT_EQ(expected, __describe(diff.items()));
+    EXPECT_NEAR(90, __find(diff.items(), "close2.txt")->similarity(), 3);
+
+    // below a lower threshold the far pair is a rename too
+    tree_diff lowered(repo, sign_t(old_tree), sign_t(new_tree));
+    detector.min_score() = 30;
+    detector.detect(lowered.items());
+    expected = { "R close.txt close2.txt", "R far.txt far2.txt" };
+    EXPECT_EQ(expected, __describe(lowered.items()));
+}
+
+TEST(rename_detector, copies) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    std::string old_tree = __tree(fixture, { { "kept.txt", __content(0, 50) },
+                                             { "m.txt", __content(100, 150) } });
+    // m.txt is modified and copied, kept.txt is copied but unmodified
+    std::string new_tree = __tree(fixture, { { "copy.txt", __content(100, 150) },
+                                             { "kept.txt", __content(0, 50) },
+                                             { "kept_copy.txt", __content(0, 50) },
+                                             { "m.txt", __content(100, 150) + "more\n" },
+                                             { "near.txt", __content(100, 145) + __content(3000, 3005) } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    tree_diff diff(repo, sign_t(old_tree), sign_t(new_tree));
+    rename_detector detector(repo);
+    detector.detect(diff.items());
+    std::vector<std::string> expected = { "A  copy.txt", "A  kept_copy.txt", "A  near.txt", "M m.txt m.txt" };
+    EXPECT_EQ(expected, __describe(diff.items()));
+
+    // only modified files are copy sources
+    tree_diff copies(repo, sign_t(old_tree), sign_t(new_tree));
+    detector.find_copies() = true;
+    detector.detect(copies.items());
+    expected = { "A  kept_copy.txt", "C m.txt copy.txt", "C m.txt near.txt", "M m.txt m.txt" };
+    EXPECT_EQ(expected, __describe(copies.items()));
+    EXPECT_EQ(100, __find(copies.items(), "copy.txt")->similarity());
+    EXPECT_NEAR(90, __find(copies.items(), "near.txt")->similarity(), 3);
+}
+
+TEST(rename_detector, rename_limit) {
+    using namespace gitter_kid::fsi;
+
+    test_repo fixture;
+    std::string old_tree = __tree(fixture, { { "exact.txt", "exact\n" },
+                                             { "p1.txt", __content(0, 100) },
+                                             { "p2.txt", __content(500, 600) } });
+    std::string new_tree = __tree(fixture, { { "moved.txt", "exact\n" },
+                                             { "q1.txt", __content(0, 95) + "q1\n" },
+                                             { "q2.txt", __content(500, 595) + "q2\n" } });
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    rename_detector detector(repo);
+    tree_diff diff(repo, sign_t(old_tree), sign_t(new_tree));
+    detector.detect(diff.items());
+    std::vector<std::string> expected = { "R exact.txt moved.txt", "R p1.txt q1.txt", "R p2.txt q2.txt" };
+    EXPECT_EQ(expected, __describe(diff.items()));
+
+    // 2 x 2 candidates over the limit: exact renames only
+    tree_diff limited(repo, sign_t(old_tree), sign_t(new_tree));
+    detector.rename_limit() = 1;
+    detector.detect(limited.items());
+    expected = { "A  q1.txt", "A  q2.txt", "D p1.txt ", "D p2.txt ", "R exact.txt moved.txt" };
+    EXPECT_EQ(expected, __describe(limited.items()));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "repository_pool.h"
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+
+std::string __empty_repository() {
+    char base[] = "/tmp/gitfsi_pool_XXXXXX";
+    std::string path(mkdtemp(base));
+    mkdir((path + "/objects").c_str(), 0755);
+    mkdir((path + "/objects/pack").c_str(), 0755);
+    return path;
+}
+
+TEST(repository_pool, reuse) {
+    gitter_kid::fsi::repository_pool pool;
+    std::string path = __empty_repository();
+
+    auto repo = pool.get(path);
+    ASSERT_NE(nullptr, repo);
+    EXPECT_EQ(repo, pool.get(path));
+    EXPECT_EQ(1, pool.size());
+    EXPECT_EQ(nullptr, pool.get(path + "/missing"));
+}
+
+TEST(repository_pool, evict_lru) {
+    gitter_kid::fsi::repository_pool pool;
+    pool.max_repositories() = 2;
+
+    std::string a = __empty_repository();
+    std::string b = __empty_repository();
+    std::string c = __empty_repository();
+
+    auto repo_a = pool.get(a);
+    auto repo_b = pool.get(b);
+    pool.get(a);
+    pool.get(c);
+
+    EXPECT_EQ(2, pool.size());
+    // b was the least recently used
+    EXPECT_EQ(repo_a, pool.get(a));
+    EXPECT_NE(repo_b, pool.get(b));
+    // evicted handle is still usable
+    EXPECT_EQ(b, repo_b->path());
+}
+
+TEST(repository_pool, remove) {
+    gitter_kid::fsi::repository_pool pool;
+    std::string path = __empty_repository();
+
+    auto repo = pool.get(path);
+    pool.remove(path);
+    EXPECT_EQ(0, pool.size());
+    EXPECT_EQ(0, pool.memory());
+    EXPECT_NE(repo, pool.get(path));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+#include "revparse.h"
+#include "test_repo.h"
+#include <string>
+
+using gitter_kid::fsi::obj_type;
+
+// ids are made up, objects are only found by file name
+const std::string __BLOB = "b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0";
+const std::string __TREE = "7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e";
+const std::string __ROOT = "c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0";
+const std::string __CHILD = "c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1c1";
+const std::string __TAG = "7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a7a";
+
+void __revparse_repository(test_repo &fixture) {
+    fixture.write_loose(obj_type::obj_type_blob, "content\n", __BLOB);
+    fixture.write_loose(obj_type::obj_type_tree, __tree_entry("100644", "f.txt", __BLOB), __TREE);
+    fixture.write_loose(obj_type::obj_type_commit, __commit(__TREE, {}, 0), __ROOT);
+    fixture.write_loose(obj_type::obj_type_commit, __commit(__TREE, { __ROOT }, 0), __CHILD);
+    fixture.write_loose(obj_type::obj_type_tag, "object " + __CHILD + "\ntype commit\ntag v1\n"
+                        "tagger a <a@b> 0 +0000\n\nv1\n", __TAG);
+
+    fixture.set_ref("refs/heads/main", __CHILD);
+    fixture.write_file("packed-refs", "# pack-refs with: peeled fully-peeled sorted\n"
+                       + __ROOT + " refs/heads/main\n"
+                       + __TAG + " refs/tags/v1\n^" + __CHILD + "\n");
+}
+
+TEST(revparse, refs) {
+    test_repo fixture;
+    __revparse_repository(fixture);
+    gitter_kid::fsi::repository repo(fixture.path());
+    repo.initialize_packs();
+
+    // loose refs take precedence over packed ones
+    EXPECT_EQ(__CHILD, repo.resolve_ref("HEAD").str());
+    EXPECT_EQ(__CHILD, repo.resolve_ref("refs/heads/main").str());
+    EXPECT_EQ(__TAG, repo.resolve_ref("refs/tags/v1").str());
+    EXPECT_TRUE(repo.resolve_ref("refs/tags/v2").bytes().empty());
+    EXPECT_TRUE(repo.resolve_ref("refs/../config").bytes().empty());
+    EXPECT_TRUE(repo.resolve_ref("config").bytes().empty());
+}
+
+TEST(revparse, resolve) {
+    test_repo fixture;
+    __revparse_repository(fixture);
+    gitter_kid::fsi::repository repo(fixture.path());
+    repo.initialize_packs();
+    gitter_kid::fsi::revparse parser(repo);
+    obj_type type;
+
+    EXPECT_EQ(__CHILD, parser.resolve("main", type).str());
+    EXPECT_EQ(obj_type::obj_type_commit, type);
+    EXPECT_EQ(__ROOT, parser.resolve("HEAD~", type).str());
+    EXPECT_EQ(__ROOT, parser.resolve("c1c1c1c^1", type).str());
+    EXPECT_EQ(__CHILD, parser.resolve("v1^0", type).str());
+    EXPECT_EQ(__TAG, parser.resolve("v1", type).str());
+    EXPECT_EQ(obj_type::obj_type_tag, type);
+    EXPECT_EQ(__TREE, parser.resolve("v1^{tree}", type).str());
+    EXPECT_EQ(obj_type::obj_type_tree, type);
+    EXPECT_EQ(__BLOB, parser.resolve("main:f.txt", type).str());
+    EXPECT_EQ(obj_type::obj_type_blob, type);
+    EXPECT_EQ(__BLOB, parser.resolve("v1~1:f.txt", type).str());
+
+    EXPECT_TRUE(parser.resolve("main~2", type).bytes().empty());
+    EXPECT_EQ(obj_type::obj_type_unknow, type);
+    EXPECT_TRUE(parser.resolve("main^2", type).bytes().empty());
+    EXPECT_TRUE(parser.resolve("main:g.txt", type).bytes().empty());
+    EXPECT_TRUE(parser.resolve("main^{blob}", type).bytes().empty());
+    EXPECT_TRUE(parser.resolve("main^{bogus}", type).bytes().empty());
+    EXPECT_TRUE(parser.resolve(":f.txt", type).bytes().empty());
+}
+
+TEST(revparse, claimed_types) {
+    test_repo fixture;
+    __revparse_repository(fixture);
+    // a tag claiming a commit and a commit claiming a parent, both blobs
+    const std::string liar = "1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a1a";
+    const std::string orphan = "0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a0a";
+    fixture.write_loose(obj_type::obj_type_tag, "object " + __BLOB + "\ntype commit\ntag liar\n"
+                        "tagger a <a@b> 0 +0000\n\nliar\n", liar);
+    fixture.write_loose(obj_type::obj_type_commit, __commit(__TREE, { __BLOB }, 0), orphan);
+    fixture.set_ref("refs/tags/liar", liar);
+    gitter_kid::fsi::repository repo(fixture.path());
+    repo.initialize_packs();
+    gitter_kid::fsi::revparse parser(repo);
+    obj_type type;
+
+    for (const char *rev : { "liar^", "liar~1", "liar^{tree}", "liar~1:f.txt",
+                             "0a0a0a0^^", "0a0a0a0~2", "0a0a0a0^^{tree}" }) {
+        EXPECT_TRUE(parser.resolve(rev, type).bytes().empty()) << rev;
+        EXPECT_EQ(obj_type::obj_type_unknow, type) << rev;
+    }
+    EXPECT_EQ(__BLOB, parser.resolve("0a0a0a0^", type).str());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
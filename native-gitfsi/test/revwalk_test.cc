@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "revwalk.h"
+#include "test_repo.h"
+#include <string>
+#include <vector>
+
+using namespace gitter_kid::fsi;
+
+/**
+ * root tree: dir/f.txt and g.txt
+ */
+std::string __root(test_repo &fixture, const std::string &f, const std::string &g) {
+    std::string dir = fixture.write_loose(obj_type::obj_type_tree,
+                                          __tree_entry("100644", "f.txt",
+                                                       fixture.write_loose(obj_type::obj_type_blob, f)));
+    return fixture.write_loose(obj_type::obj_type_tree,
+                               __tree_entry("40000", "dir", dir)
+                               + __tree_entry("100644", "g.txt",
+                                              fixture.write_loose(obj_type::obj_type_blob, g)));
+}
+
+/**
+ * every commit left in the walk
+ */
+std::vector<std::string> __walk(revwalk &walk) {
+    std::vector<std::string> result;
+    sign_t sign;
+    commit_body body;
+    while (walk.next(sign, body)) {
+        result.push_back(sign.str());
+    }
+    return result;
+}
+
+/**
+ *   c1 - c2 - c4 - merge
+ *     \           /
+ *      c3 -------
+ * c2 only changes g.txt, c3 and c4 change dir/f.txt differently
+ */
+class revwalk_fixture : public testing::Test {
+protected:
+    test_repo fixture;
+    std::string c1;
+    std::string c2;
+    std::string c3;
+    std::string c4;
+
+    void SetUp() override {
+        this->c1 = this->commit(__root(this->fixture, "f1\n", "g1\n"), {}, 1);
+        this->c2 = this->commit(__root(this->fixture, "f1\n", "g2\n"), { this->c1 }, 2);
+        this->c3 = this->commit(__root(this->fixture, "f3\n", "g1\n"), { this->c1 }, 3);
+        this->c4 = this->commit(__root(this->fixture, "f4\n", "g2\n"), { this->c2 }, 4);
+    }
+
+    std::string commit(const std::string &tree_hex, const std::vector<std::string> &parents, uint64_t timestamp) {
+        return this->fixture.write_loose(obj_type::obj_type_commit, __commit(tree_hex, parents, timestamp));
+    }
+};
+
+TEST_F(revwalk_fixture, order) {
+    std::string merge = this->commit(__root(this->fixture, "f4\n", "g2\n"), { this->c4, this->c3 }, 5);
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    // newest committer date first, c1 reached from both sides comes once
+    revwalk walk(repo);
+    walk.push(sign_t(merge));
+    std::vector<std::string> expected = { merge, this->c4, this->c3, this->c2, this->c1 };
+    EXPECT_EQ(expected, __walk(walk));
+}
+
+TEST_F(revwalk_fixture, stop) {
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    // commits are pulled one at a time, the walk resumes where it stopped
+    revwalk walk(repo);
+    walk.push(sign_t(this->c4));
+    sign_t sign;
+    commit_body body;
+    ASSERT_TRUE(walk.next(sign, body));
+    EXPECT_EQ(this->c4, sign.str());
+    EXPECT_EQ(4, body.committer().timestamp());
+    std::vector<std::string> expected = { this->c2, this->c1 };
+    EXPECT_EQ(expected, __walk(walk));
+
+    // over at root commits, and stays over
+    EXPECT_FALSE(walk.next(sign, body));
+
+    revwalk missing(repo);
+    missing.push(sign_t(std::string(40, 'd')));
+    EXPECT_FALSE(missing.next(sign, body));
+}
+
+TEST_F(revwalk_fixture, path_first_parent) {
+    // the merge keeps c4's dir/f.txt: c4's side is followed, c3 pruned
+    std::string merge = this->commit(__root(this->fixture, "f4\n", "g2\n"), { this->c4, this->c3 }, 5);
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    revwalk walk(repo);
+    walk.path("dir/f.txt");
+    walk.push(sign_t(merge));
+    std::vector<std::string> expected = { this->c4, this->c1 };
+    EXPECT_EQ(expected, __walk(walk));
+
+    revwalk other_path(repo);
+    other_path.path("g.txt");
+    other_path.push(sign_t(merge));
+    expected = { this->c2, this->c1 };
+    EXPECT_EQ(expected, __walk(other_path));
+}
+
+TEST_F(revwalk_fixture, path_second_parent) {
+    // the merge takes c3's dir/f.txt: only c3's side is followed
+    std::string merge = this->commit(__root(this->fixture, "f3\n", "g2\n"), { this->c4, this->c3 }, 5);
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    revwalk walk(repo);
+    walk.path("dir/f.txt");
+    walk.push(sign_t(merge));
+    std::vector<std::string> expected = { this->c3, this->c1 };
+    EXPECT_EQ(expected, __walk(walk));
+}
+
+TEST_F(revwalk_fixture, path_merge_changed) {
+    // the merge differs from both sides, both are followed
+    std::string merge = this->commit(__root(this->fixture, "f5\n", "g2\n"), { this->c4, this->c3 }, 5);
+    repository repo(this->fixture.path());
+    repo.initialize_packs();
+
+    revwalk walk(repo);
+    walk.path("dir/f.txt");
+    walk.push(sign_t(merge));
+    std::vector<std::string> expected = { merge, this->c4, this->c3, this->c1 };
+    EXPECT_EQ(expected, __walk(walk));
+
+    revwalk absent(repo);
+    absent.path("dir/none.txt");
+    absent.push(sign_t(merge));
+    EXPECT_TRUE(__walk(absent).empty());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+#include "server.h"
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string>
+
+std::string __frame(const std::string &payload) {
+    uint32_t len = htonl(uint32_t(payload.size()));
+    return std::string(reinterpret_cast<char *>(&len), 4) + payload;
+}
+
+std::string __serve(gitter_kid::fsi::server &srv, const std::string &input) {
+    int in_fds[2];
+    int out_fds[2];
+    pipe(in_fds);
+    pipe(out_fds);
+    write(in_fds[1], input.data(), input.size());
+    close(in_fds[1]);
+
+    srv.serve(in_fds[0], out_fds[1]);
+    close(in_fds[0]);
+    close(out_fds[1]);
+
+    std::string output;
+    char chunk[1024];
+    ssize_t nread;
+    while ((nread = read(out_fds[0], chunk, sizeof(chunk))) > 0) {
+        output.append(chunk, nread);
+    }
+    close(out_fds[0]);
+    return output;
+}
+
+TEST(server, handle) {
+    gitter_kid::fsi::server srv;
+
+    EXPECT_EQ("error unknown repository\n", srv.handle("info 00"));
+    EXPECT_EQ("error unknown repository\n", srv.handle("@none info 00"));
+    EXPECT_EQ("error bad request\n", srv.handle("@none"));
+}
+
+TEST(server, pipelined) {
+    gitter_kid::fsi::server srv;
+
+    std::string output = __serve(srv, __frame("@a info 00") + __frame("@") + __frame("info"));
+    EXPECT_EQ(__frame("error unknown repository\n")
+              + __frame("error bad request\n")
+              + __frame("error unknown repository\n"),
+              output);
+}
+
+TEST(server, oversized) {
+    gitter_kid::fsi::server srv;
+
+    std::string input = __frame("@a info 00");
+    uint32_t len = htonl(uint32_t(gitter_kid::fsi::SERVER_REQUEST_MAX + 1));
+    input.append(reinterpret_cast<char *>(&len), 4);
+    input += __frame("@a info 00");
+
+    EXPECT_EQ(__frame("error unknown repository\n"), __serve(srv, input));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
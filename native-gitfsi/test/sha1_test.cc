@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "sha1.h"
+#include "repository.h"
+#include "test_repo.h"
+#include <string>
+
+using namespace gitter_kid::fsi;
+
+std::string __digest(const std::string &data) {
+    sha1 hasher;
+    hasher.update(data);
+    sign_t sign;
+    EXPECT_TRUE(hasher.final(sign));
+    return sign.str();
+}
+
+/**
+ * run check once per compressor this CPU has (once with sha1dc, which
+ * can't be forced), the CPU's pick restored after
+ */
+template <typename _T_Fn>
+void __each_compressor(_T_Fn check) {
+    bool forced = false;
+    for (__sha1_impl impl : { __sha1_impl::__sha1_impl_portable, __sha1_impl::__sha1_impl_shani }) {
+        if (!__sha1_force(impl)) {
+            continue;
+        }
+        forced = true;
+        SCOPED_TRACE(impl == __sha1_impl::__sha1_impl_portable ? "portable" : "shani");
+        EXPECT_EQ(impl == __sha1_impl::__sha1_impl_shani, sha1::accelerated());
+        check();
+    }
+    __sha1_force(__sha1_impl::__sha1_impl_auto);
+    if (!forced) {
+        check();
+    }
+}
+
+TEST(sha1, vectors) {
+    __each_compressor([] () -> void {
+        EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", __digest(""));
+        EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", __digest("abc"));
+        EXPECT_EQ("84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+                  __digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+        EXPECT_EQ("34aa973cd4c4daa4f61eeb2bdbad27316534016f", __digest(std::string(1000000, 'a')));
+    });
+}
+
+TEST(sha1, streaming) {
+    std::string data;
+    for (int i = 0; i < 1000; i++) {
+        data += std::to_string(i * 7919);
+    }
+
+    // every split point around block boundaries gives the portable digest
+    __sha1_force(__sha1_impl::__sha1_impl_portable);
+    std::string expected = __digest(data);
+    __each_compressor([&] () -> void {
+        EXPECT_EQ(expected, __digest(data));
+        for (size_t split = 0; split < 200; split++) {
+            sha1 hasher;
+            hasher.update(data.substr(0, split));
+            hasher.update(data.substr(split, 70));
+            hasher.update(data.substr(split + 70));
+            sign_t sign;
+            hasher.final(sign);
+            EXPECT_EQ(expected, sign.str());
+        }
+    });
+}
+
+TEST(sha1, hash_object) {
+    std::string content = "hello\n";
+    sign_t sign;
+    ASSERT_TRUE(hash_object(obj_type::obj_type_blob,
+                            reinterpret_cast<const byte *>(content.data()),
+                            content.size(),
+                            sign));
+    EXPECT_EQ("ce013625030ba8dba906f756967f9e9ca394464a", sign.str());
+    EXPECT_FALSE(hash_object(obj_type::obj_type_unknow, nullptr, 0, sign));
+}
+
+TEST(sha1, verify_on_read) {
+    test_repo fixture;
+    const std::string good = "ce013625030ba8dba906f756967f9e9ca394464a";
+    const std::string bad = "b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0";
+    fixture.write_loose(obj_type::obj_type_blob, "hello\n", good);
+    fixture.write_loose(obj_type::obj_type_blob, "hello\n", bad);
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(good)).type());
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(bad)).type());
+
+    repo.verify() = true;
+    EXPECT_EQ(obj_type::obj_type_blob, repo.get(sign_t(good)).type());
+    EXPECT_EQ(obj_type::obj_type_unknow, repo.get(sign_t(bad)).type());
+
+    obj_type type;
+    EXPECT_TRUE(repo.raw(sign_t(bad), type).empty());
+    EXPECT_EQ(obj_type::obj_type_unknow, type);
+
+    size_t found = 0;
+    repo.get_many({ sign_t(good), sign_t(bad) }, [&found](sign_t &, object &obj) {
+        found += obj.type() == obj_type::obj_type_blob;
+    });
+    EXPECT_EQ(1, found);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+#include "stats.h"
+#include "test_repo.h"
+#include <string>
+
+using namespace gitter_kid::fsi;
+
+TEST(stats, report) {
+    test_repo fixture;
+    std::string small = fixture.write_loose(obj_type::obj_type_blob, "hello\n");
+    std::string large = fixture.write_loose(obj_type::obj_type_blob, std::string(100, 'x'));
+    // a/b/c.txt, y.txt, z.txt
+    std::string b = fixture.write_loose(obj_type::obj_type_tree, __tree_entry("100644", "c.txt", small));
+    std::string a = fixture.write_loose(obj_type::obj_type_tree, __tree_entry("40000", "b", b));
+    std::string root = fixture.write_loose(obj_type::obj_type_tree,
+                                     __tree_entry("40000", "a", a)
+                                     + __tree_entry("100644", "y.txt", large)
+                                     + __tree_entry("100644", "z.txt", small));
+    std::string first = fixture.write_loose(obj_type::obj_type_commit, __commit(root));
+    std::string second = fixture.write_loose(obj_type::obj_type_commit, __commit(root, { first }));
+    std::string third = fixture.write_loose(obj_type::obj_type_commit, __commit(root, { second }));
+
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    stats_report report = stats(repo).collect();
+
+    EXPECT_EQ(3, report.commits.count);
+    EXPECT_EQ(3, report.trees.count);
+    EXPECT_EQ(2, report.blobs.count);
+    EXPECT_EQ(0, report.tags.count);
+    EXPECT_EQ(106, report.blobs.size);
+
+    ASSERT_EQ(2, report.largest_blobs.size());
+    EXPECT_EQ(large, report.largest_blobs[0].sign.str());
+    EXPECT_EQ(100, report.largest_blobs[0].size);
+    EXPECT_EQ(small, report.largest_blobs[1].sign.str());
+    ASSERT_EQ(3, report.largest_trees.size());
+    EXPECT_EQ(root, report.largest_trees[0].sign.str());
+
+    // loose objects aren't deltified
+    ASSERT_EQ(1, report.delta_depths.size());
+    EXPECT_EQ(8, report.delta_depths[0]);
+
+    EXPECT_EQ(root, report.widest_tree.sign.str());
+    EXPECT_EQ(3, report.widest_tree.size);
+    EXPECT_EQ(3, report.max_path_depth);
+    EXPECT_EQ("a/b", report.deepest_path);
+    EXPECT_EQ(3, report.history_length);
+    EXPECT_EQ(third, report.history_tip.str());
+}
+
+TEST(stats, empty) {
+    test_repo fixture;
+    repository repo(fixture.path());
+    repo.initialize_packs();
+    stats_report report = stats(repo).collect();
+
+    EXPECT_EQ(0, report.commits.count + report.trees.count + report.blobs.count + report.tags.count);
+    EXPECT_TRUE(report.largest_blobs.empty());
+    EXPECT_TRUE(report.delta_depths.empty());
+    EXPECT_EQ(0, report.widest_tree.size);
+    EXPECT_EQ(0, report.max_path_depth);
+    EXPECT_EQ(0, report.history_length);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,319 @@
+#ifndef _GIT_FSI_TEST_REPO_
+#define _GIT_FSI_TEST_REPO_
+
+#include "repository.h"
+#include "sha1.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// entry without a delta base
+const size_t TEST_PACK_NO_BASE = size_t(-1);
+
+/**
+ * pack entry written by test_repo::write_pack. With a base (an earlier
+ * entry's position) the entry is stored as a delta of it: an ofs delta,
+ * or a ref delta if ref_delta is set. A non empty delta is written as is,
+ * so a corrupt delta can be packed
+ */
+struct test_pack_entry {
+    gitter_kid::fsi::obj_type type;
+    std::string content;
+    size_t base;
+    bool ref_delta;
+    std::string delta;
+
+    test_pack_entry(gitter_kid::fsi::obj_type type,
+                    const std::string &content,
+                    size_t base = TEST_PACK_NO_BASE,
+                    bool ref_delta = false,
+                    const std::string &delta = "")
+        : type(type)
+        , content(content)
+        , base(base)
+        , ref_delta(ref_delta)
+        , delta(delta) {}
+};
+
+inline const char *__test_type_name(gitter_kid::fsi::obj_type type) {
+    switch (type) {
+    case gitter_kid::fsi::obj_type::obj_type_commit:
+        return "commit";
+    case gitter_kid::fsi::obj_type::obj_type_tree:
+        return "tree";
+    case gitter_kid::fsi::obj_type::obj_type_tag:
+        return "tag";
+    default:
+        return "blob";
+    }
+}
+
+/**
+ * type in a pack item's header
+ */
+inline int __test_pack_type(gitter_kid::fsi::obj_type type) {
+    switch (type) {
+    case gitter_kid::fsi::obj_type::obj_type_commit:
+        return 1;
+    case gitter_kid::fsi::obj_type::obj_type_tree:
+        return 2;
+    case gitter_kid::fsi::obj_type::obj_type_tag:
+        return 4;
+    default:
+        return 3;
+    }
+}
+
+inline std::string __test_uint32_be(uint32_t value) {
+    return { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+}
+
+inline std::string __test_varint(size_t value) {
+    std::string result;
+    while (value >= 0x80) {
+        result += char(0x80 | (value & 0x7F));
+        value >>= 7;
+    }
+    return result + char(value);
+}
+
+inline std::string __test_deflate(const std::string &data) {
+    uLongf len = compressBound(data.size());
+    std::string result(len, 0);
+    compress(reinterpret_cast<Bytef *>(&result[0]), &len,
+             reinterpret_cast<const Bytef *>(data.data()), data.size());
+    result.resize(len);
+    return result;
+}
+
+/**
+ * raw SHA-1 digest of data
+ */
+inline std::string __test_digest(const std::string &data) {
+    gitter_kid::fsi::sha1 hasher;
+    hasher.update(data);
+    gitter_kid::fsi::sign_t sign;
+    hasher.final(sign);
+    return std::string(sign.bytes().begin(), sign.bytes().end());
+}
+
+inline std::string __test_raw_sign(const std::string &hex) {
+    gitter_kid::fsi::sign_t sign(hex);
+    return std::string(sign.bytes().begin(), sign.bytes().end());
+}
+
+inline std::string __test_hex(const std::string &raw) {
+    gitter_kid::fsi::sign_t sign;
+    sign.bytes_assign(raw.begin(), raw.end());
+    return sign.str();
+}
+
+inline std::string __test_object_id(gitter_kid::fsi::obj_type type, const std::string &content) {
+    gitter_kid::fsi::sign_t sign;
+    gitter_kid::fsi::hash_object(type,
+                                 reinterpret_cast<const byte *>(content.data()),
+                                 content.size(),
+                                 sign);
+    return sign.str();
+}
+
+/**
+ * pack item header: type and size
+ */
+inline std::string __test_item_header(int type, size_t size) {
+    std::string result;
+    uint8_t ch = (type << 4) | (size & 0x0F);
+    for (size >>= 4; size != 0; size >>= 7) {
+        result += char(ch | 0x80);
+        ch = size & 0x7F;
+    }
+    return result + char(ch);
+}
+
+inline std::string __test_ofs(size_t negative_off) {
+    std::string result(1, char(negative_off & 0x7F));
+    while (negative_off >>= 7) {
+        result.insert(result.begin(), char(0x80 | (--negative_off & 0x7F)));
+    }
+    return result;
+}
+
+/**
+ * delta copying the prefix content shares with base, then inserting the rest
+ */
+inline std::string __test_delta(const std::string &base, const std::string &content) {
+    size_t copied = std::mismatch(base.begin(),
+                                  base.begin() + std::min(base.size(), content.size()),
+                                  content.begin()).first - base.begin();
+    std::string result = __test_varint(base.size()) + __test_varint(content.size());
+    if (copied != 0) {
+        std::string size_bytes;
+        uint8_t cmd = 0x80;
+        for (int i = 0; i < 3; i++) {
+            if ((copied >> (8 * i)) & 0xFF) {
+                cmd |= 0x10 << i;
+                size_bytes += char((copied >> (8 * i)) & 0xFF);
+            }
+        }
+        result += char(cmd) + size_bytes;
+    }
+    for (size_t pos = copied; pos < content.size(); pos += 0x7F) {
+        std::string inserted = content.substr(pos, 0x7F);
+        result += char(inserted.size()) + inserted;
+    }
+    return result;
+}
+
+inline std::string __tree_entry(const std::string &mode, const std::string &name, const std::string &hex) {
+    return mode + " " + name + '\0' + __test_raw_sign(hex);
+}
+
+inline std::string __commit(const std::string &tree_hex,
+                            const std::vector<std::string> &parent_hexes = {},
+                            uint64_t timestamp = 1700000000) {
+    std::string content = "tree " + tree_hex + "\n";
+    for (auto itr = parent_hexes.begin(); itr != parent_hexes.end(); itr++) {
+        content += "parent " + *itr + "\n";
+    }
+    std::string stamp = std::to_string(timestamp) + " +0000\n";
+    return content + "author a <a@b> " + stamp + "committer a <a@b> " + stamp + "\nmessage\n";
+}
+
+inline int __test_remove(const char *path, const struct stat *, int, struct FTW *) {
+    return remove(path);
+}
+
+/**
+ * bare repository in a temporary directory, removed with the object
+ */
+class test_repo {
+private:
+    std::string _path;
+    // touches so far, each gives a distinct mtime
+    time_t _touches = 0;
+public:
+    test_repo() {
+        char base[] = "/tmp/gitfsi_test_XXXXXX";
+        this->_path = mkdtemp(base);
+        for (const char *dir : { "/objects", "/objects/pack", "/refs", "/refs/heads", "/refs/tags" }) {
+            mkdir((this->_path + dir).c_str(), 0755);
+        }
+        this->write_file("HEAD", "ref: refs/heads/main\n");
+    }
+
+    test_repo(const test_repo &) = delete;
+    test_repo &operator=(const test_repo &) = delete;
+
+    ~test_repo() {
+        nftw(this->_path.c_str(), __test_remove, 16, FTW_DEPTH | FTW_PHYS);
+    }
+
+    const std::string &path() const {
+        return this->_path;
+    }
+
+    void write_file(const std::string &name, const std::string &content) {
+        std::ofstream file(this->_path + "/" + name, std::ios::binary);
+        file.write(content.data(), content.size());
+    }
+
+    /**
+     * give a file or directory an mtime no earlier touch or real change
+     * had, so a cache keyed on mtime sees the change whatever the file
+     * system's timestamp granularity
+     */
+    void touch(const std::string &name) {
+        timespec times[2] = { { 0, UTIME_OMIT }, { 1000000000 + ++this->_touches, 0 } };
+        utimensat(AT_FDCWD, (this->_path + "/" + name).c_str(), times, 0);
+    }
+
+    void set_ref(const std::string &name, const std::string &hex) {
+        this->write_file(name, hex + "\n");
+    }
+
+    /**
+     * write a loose object, its id is computed unless forced
+     * Returns:
+     *      object's id
+     */
+    std::string write_loose(gitter_kid::fsi::obj_type type,
+                            const std::string &content,
+                            std::string hex = "") {
+        if (hex.empty()) {
+            hex = __test_object_id(type, content);
+        }
+
+        std::string raw = std::string(__test_type_name(type)) + " "
+            + std::to_string(content.size()) + '\0' + content;
+        mkdir((this->_path + "/objects/" + hex.substr(0, 2)).c_str(), 0755);
+        this->write_file("objects/" + hex.substr(0, 2) + "/" + hex.substr(2), __test_deflate(raw));
+        return hex;
+    }
+
+    /**
+     * write a pack and its idx (v2, CRCs left zero)
+     * Returns:
+     *      pack's path without extension
+     */
+    std::string write_pack(const std::vector<test_pack_entry> &entries) {
+        std::string pack_data = "PACK" + __test_uint32_be(2) + __test_uint32_be(entries.size());
+        std::vector<std::pair<std::string, size_t>> ids;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const test_pack_entry &entry = entries[i];
+            ids.push_back(std::make_pair(__test_raw_sign(__test_object_id(entry.type, entry.content)),
+                                         pack_data.size()));
+            if (entry.base == TEST_PACK_NO_BASE) {
+                pack_data += __test_item_header(__test_pack_type(entry.type), entry.content.size())
+                    + __test_deflate(entry.content);
+                continue;
+            }
+
+            const test_pack_entry &base = entries[entry.base];
+            std::string delta = entry.delta.empty() ? __test_delta(base.content, entry.content) : entry.delta;
+            if (entry.ref_delta) {
+                pack_data += __test_item_header(7, delta.size())
+                    + __test_raw_sign(__test_object_id(base.type, base.content));
+            }
+            else {
+                pack_data += __test_item_header(6, delta.size()) + __test_ofs(ids.back().second - ids[entry.base].second);
+            }
+            pack_data += __test_deflate(delta);
+        }
+        std::string pack_sum = __test_digest(pack_data);
+        pack_data += pack_sum;
+        std::sort(ids.begin(), ids.end());
+
+        // fan-out, ids, crcs, offsets, checksums
+        std::string idx_data = "\377tOc" + __test_uint32_be(2);
+        for (int i = 0; i < 256; i++) {
+            idx_data += __test_uint32_be(std::count_if(ids.begin(), ids.end(),
+                                                       [i] (const std::pair<std::string, size_t> &id) -> bool {
+                                                           return uint8_t(id.first[0]) <= i;
+                                                       }));
+        }
+        for (auto itr = ids.begin(); itr != ids.end(); itr++) {
+            idx_data += itr->first;
+        }
+        idx_data += std::string(4 * ids.size(), 0);
+        for (auto itr = ids.begin(); itr != ids.end(); itr++) {
+            idx_data += __test_uint32_be(itr->second);
+        }
+        idx_data += pack_sum;
+        idx_data += __test_digest(idx_data);
+
+        std::string prefix = "objects/pack/pack-" + __test_hex(pack_sum);
+        this->write_file(prefix + ".pack", pack_data);
+        this->write_file(prefix + ".idx", idx_data);
+        return this->_path + "/" + prefix;
+    }
+};
+
+#endif
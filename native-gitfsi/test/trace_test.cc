@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "trace.h"
+#include <string>
+#include <unistd.h>
+
+using namespace gitter_kid::fsi;
+
+size_t __count(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(trace, disabled) {
+    trace::disable();
+    trace::clear();
+    {
+        trace_span span("outer");
+        EXPECT_FALSE(span.active());
+    }
+    EXPECT_EQ(0, __count(trace::chrome_json(), "\"name\""));
+}
+
+TEST(trace, nested_spans) {
+    trace::clear();
+    trace::enable();
+    {
+        trace_span outer("outer");
+        outer.arg("sign", "ab\"c");
+        {
+            trace_span inner("inner");
+            inner.arg("off", uint64_t(12));
+        }
+    }
+    trace::disable();
+
+    std::string json = trace::chrome_json();
+    EXPECT_EQ(0, json.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"outer\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"inner\""));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"sign\":\"ab\\\"c\"}"));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"off\":12}"));
+    // sorted by start, outer span first
+    EXPECT_LT(json.find("\"outer\""), json.find("\"inner\""));
+}
+
+TEST(trace, slow_threshold) {
+    trace::clear();
+    // 50ms
+    trace::enable(1, 50000000);
+    {
+        trace_span fast("fast");
+        trace_span child("fast_child");
+    }
+    {
+        trace_span slow("slow");
+        trace_span child("slow_child");
+        usleep(60000);
+    }
+    trace::disable();
+
+    std::string json = trace::chrome_json();
+    EXPECT_EQ(std::string::npos, json.find("\"fast"));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"slow\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"slow_child\""));
+}
+
+TEST(trace, sampling) {
+    trace::clear();
+    trace::enable(4);
+    for (int i = 0; i < 40; i++) {
+        trace_span span("sampled");
+    }
+    trace::disable();
+
+    EXPECT_EQ(10, __count(trace::chrome_json(), "\"name\":\"sampled\""));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,518 @@
+#include "repository.h"
+#include "revparse.h"
+#include "revwalk.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace gitter_kid::fsi;
+
+// bumped whenever generated repositories change, older ones are rebuilt
+const int __BENCH_GENERATOR_VERSION = 1;
+
+// fixed dates and seeds make every generated id the same on every machine
+const uint64_t __BENCH_EPOCH = 1500000000;
+
+/**
+ * deterministic pseudo random numbers (64-bit LCG)
+ */
+class __bench_random {
+private:
+    uint64_t _state;
+public:
+    __bench_random(uint64_t seed) : _state(seed) {}
+
+    uint64_t next() {
+        this->_state = this->_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return this->_state >> 17;
+    }
+};
+
+/**
+ * writes a git fast-import stream into a bare repository
+ */
+class __bench_import {
+private:
+    FILE *_pipe;
+    uint64_t _time;
+    int _marks;
+public:
+    __bench_import(const std::string &path) : _time(__BENCH_EPOCH), _marks(0) {
+        this->_pipe = popen(("git init -q --bare " + path
+                             + " && git -C " + path + " symbolic-ref HEAD refs/heads/main"
+                             // small packs would be exploded into loose objects
+                             + " && git -C " + path + " -c fastimport.unpackLimit=0"
+                             + " fast-import --quiet").c_str(), "w");
+    }
+
+    bool close() {
+        return pclose(this->_pipe) == 0;
+    }
+
+    void data(const std::string &content) {
+        fprintf(this->_pipe, "data %zu\n", content.size());
+        fwrite(content.data(), 1, content.size(), this->_pipe);
+        fputc('\n', this->_pipe);
+    }
+
+    /**
+     * start a commit on main
+     * Returns:
+     *      commit's mark
+     */
+    int commit(int from, int merge) {
+        int mark = ++this->_marks;
+        fprintf(this->_pipe, "commit refs/heads/main\nmark :%d\n", mark);
+        fprintf(this->_pipe, "committer bench <bench@gitfsi> %llu +0000\n",
+                static_cast<unsigned long long>(this->_time++));
+        this->data("commit " + std::to_string(mark));
+        if (from != 0) {
+            fprintf(this->_pipe, "from :%d\n", from);
+        }
+        if (merge != 0) {
+            fprintf(this->_pipe, "merge :%d\n", merge);
+        }
+        return mark;
+    }
+
+    void modify(const std::string &path, const std::string &content) {
+        fprintf(this->_pipe, "M 100644 inline %s\n", path.c_str());
+        this->data(content);
+    }
+
+    // finish current pack, later objects go to a new one
+    void checkpoint() {
+        fputs("checkpoint\n", this->_pipe);
+    }
+};
+
+/**
+ * text file of `lines` pseudo random lines
+ */
+std::vector<std::string> __bench_text(__bench_random &random, size_t lines) {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < lines; i++) {
+        result.push_back("line " + std::to_string(i) + " " + std::to_string(random.next()) + "\n");
+    }
+    return result;
+}
+
+std::string __bench_join(const std::vector<std::string> &lines) {
+    std::string result;
+    for (auto itr = lines.begin(); itr != lines.end(); itr++) {
+        result += *itr;
+    }
+    return result;
+}
+
+/**
+ * 2000 commits, each editing one line of one of 64 files in 8 directories
+ */
+void __bench_gen_linear(__bench_import &import) {
+    __bench_random random(1);
+    std::vector<std::vector<std::string>> files;
+    int head = import.commit(0, 0);
+    for (int i = 0; i < 64; i++) {
+        files.push_back(__bench_text(random, 200));
+        import.modify("d" + std::to_string(i % 8) + "/f" + std::to_string(i) + ".txt",
+                      __bench_join(files.back()));
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        size_t file = random.next() % files.size();
+        files[file][random.next() % files[file].size()] = "edit " + std::to_string(i) + "\n";
+        head = import.commit(head, 0);
+        import.modify("d" + std::to_string(file % 8) + "/f" + std::to_string(file) + ".txt",
+                      __bench_join(files[file]));
+    }
+}
+
+/**
+ * 300 topic branches of 3 commits, each merged back into main
+ */
+void __bench_gen_merges(__bench_import &import) {
+    __bench_random random(2);
+    std::vector<std::vector<std::string>> files;
+    int main_head = import.commit(0, 0);
+    for (int i = 0; i < 32; i++) {
+        files.push_back(__bench_text(random, 100));
+        import.modify("f" + std::to_string(i) + ".txt", __bench_join(files.back()));
+    }
+
+    for (int i = 0; i < 300; i++) {
+        int topic = main_head;
+        for (int j = 0; j < 3; j++) {
+            size_t file = random.next() % files.size();
+            files[file][random.next() % files[file].size()] = "topic " + std::to_string(i) + "\n";
+            topic = import.commit(topic, 0);
+            import.modify("f" + std::to_string(file) + ".txt", __bench_join(files[file]));
+        }
+
+        size_t file = random.next() % files.size();
+        files[file][random.next() % files[file].size()] = "main " + std::to_string(i) + "\n";
+        main_head = import.commit(main_head, topic);
+        import.modify("f" + std::to_string(file) + ".txt", __bench_join(files[file]));
+    }
+}
+
+/**
+ * 600 versions of one file, repacked into delta chains up to 250 deep
+ */
+void __bench_gen_deltas(__bench_import &import) {
+    __bench_random random(3);
+    std::vector<std::string> file = __bench_text(random, 2000);
+    int head = 0;
+    for (int i = 0; i < 600; i++) {
+        for (int j = 0; j < 4; j++) {
+            file[random.next() % file.size()] = "edit " + std::to_string(i) + "\n";
+        }
+        head = import.commit(head, 0);
+        import.modify("file.txt", __bench_join(file));
+    }
+}
+
+/**
+ * a flat directory of 10000 files and 100 directories of 100 files
+ */
+void __bench_gen_wide(__bench_import &import) {
+    __bench_random random(4);
+    int head = import.commit(0, 0);
+    for (int i = 0; i < 10000; i++) {
+        import.modify("flat/f" + std::to_string(i) + ".txt", std::to_string(random.next()) + "\n");
+    }
+    for (int i = 0; i < 10000; i++) {
+        import.modify("d" + std::to_string(i / 100) + "/f" + std::to_string(i % 100) + ".txt",
+                      std::to_string(random.next()) + "\n");
+    }
+
+    for (int i = 0; i < 3; i++) {
+        head = import.commit(head, 0);
+        import.modify("flat/f" + std::to_string(i) + ".txt", "edit\n");
+    }
+}
+
+/**
+ * two text and two binary blobs of 16MB
+ */
+void __bench_gen_blobs(__bench_import &import) {
+    __bench_random random(5);
+    int head = 0;
+    for (int i = 0; i < 2; i++) {
+        head = import.commit(head, 0);
+        std::string text = __bench_join(__bench_text(random, 16 * 1024 * 1024 / 32));
+        import.modify("text" + std::to_string(i) + ".txt", text);
+
+        std::string binary(16 * 1024 * 1024, 0);
+        for (size_t j = 0; j < binary.size(); j += 8) {
+            uint64_t value = random.next();
+            memcpy(&binary[j], &value, 8);
+        }
+        import.modify("binary" + std::to_string(i) + ".dat", binary);
+    }
+}
+
+/**
+ * 64 packs of 20 commits each
+ */
+void __bench_gen_packs(__bench_import &import) {
+    __bench_random random(6);
+    std::vector<std::string> file = __bench_text(random, 100);
+    int head = 0;
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 20; j++) {
+            file[random.next() % file.size()] = "edit " + std::to_string(i * 20 + j) + "\n";
+            head = import.commit(head, 0);
+            import.modify("p" + std::to_string(i) + ".txt", __bench_join(file));
+        }
+        import.checkpoint();
+    }
+}
+
+struct __bench_repo_s {
+    const char *name;
+    std::function<void(__bench_import &)> generate;
+    // run after importing, empty for none
+    const char *repack;
+};
+
+const std::vector<__bench_repo_s> __BENCH_REPOS = {
+    { "linear", __bench_gen_linear, "" },
+    { "merges", __bench_gen_merges, "" },
+    { "deltas", __bench_gen_deltas, "-c pack.threads=1 repack -q -adf --depth=250 --window=50" },
+    { "wide", __bench_gen_wide, "" },
+    { "blobs", __bench_gen_blobs, "" },
+    { "packs", __bench_gen_packs, "" }
+};
+
+/**
+ * generate a repository unless an up to date one exists
+ * Returns:
+ *      false if generating failed
+ */
+bool __bench_generate(const __bench_repo_s &bench_repo, const std::string &path) {
+    std::string stamp_path = path + "/gitfsi-bench";
+    std::ifstream stamp_file(stamp_path);
+    int version = 0;
+    if (stamp_file >> version && version == __BENCH_GENERATOR_VERSION) {
+        return true;
+    }
+
+    std::cerr << "generating " << path << std::endl;
+    if (system(("rm -rf " + path).c_str()) != 0) {
+        return false;
+    }
+    __bench_import import(path);
+    bench_repo.generate(import);
+    if (!import.close()) {
+        return false;
+    }
+    if (strlen(bench_repo.repack) != 0
+        && system(("git -C " + path + " " + bench_repo.repack).c_str()) != 0) {
+        return false;
+    }
+
+    std::ofstream(stamp_path) << __BENCH_GENERATOR_VERSION << std::endl;
+    return true;
+}
+
+/**
+ * latency samples of one measured operation
+ */
+struct __bench_result_s {
+    std::string name;
+    std::string repo;
+    std::string kind;
+    std::vector<uint64_t> samples;
+};
+
+uint64_t __bench_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * time op `iterations` times
+ */
+__bench_result_s __bench_measure(const std::string &name,
+                                 const std::string &repo,
+                                 const std::string &kind,
+                                 int iterations,
+                                 std::function<void()> op) {
+    __bench_result_s result = { name, repo, kind, std::vector<uint64_t>() };
+    for (int i = 0; i < iterations; i++) {
+        uint64_t begin = __bench_now();
+        op();
+        result.samples.push_back(__bench_now() - begin);
+    }
+    return result;
+}
+
+const char *__bench_type_name(obj_type type) {
+    switch (type) {
+    case obj_type::obj_type_blob:
+        return "blob";
+    case obj_type::obj_type_tree:
+        return "tree";
+    case obj_type::obj_type_commit:
+        return "commit";
+    case obj_type::obj_type_tag:
+        return "tag";
+    default:
+        return "unknow";
+    }
+}
+
+/**
+ * run every benchmark against one repository
+ */
+void __bench_repo(const std::string &name,
+                  const std::string &path,
+                  int iterations,
+                  std::vector<__bench_result_s> &results) {
+    results.push_back(__bench_measure("open", name, "", iterations, [&] () -> void {
+        repository repo(path);
+        repo.initialize_packs();
+    }));
+
+    repository repo(path);
+    repo.initialize_packs();
+
+    // every object, grouped by type (reading them once also warms the page cache)
+    std::map<obj_type, std::vector<sign_t>> signs;
+    std::vector<sign_t> all_signs;
+    std::shared_ptr<const pack_list> packs = repo.packs();
+    for (auto pack_itr = packs->begin(); pack_itr != packs->end(); pack_itr++) {
+        std::vector<__pack_idx_s> &indexes = (*pack_itr)->off_index();
+        for (auto itr = indexes.begin(); itr != indexes.end(); itr++) {
+            signs[repo.get(itr->sign).type()].push_back(itr->sign);
+            all_signs.push_back(itr->sign);
+        }
+    }
+
+    for (auto kind_itr = signs.begin(); kind_itr != signs.end(); kind_itr++) {
+        __bench_result_s result = { "get", name, __bench_type_name(kind_itr->first),
+                                    std::vector<uint64_t>() };
+        for (int i = 0; i < iterations; i++) {
+            for (auto itr = kind_itr->second.begin(); itr != kind_itr->second.end(); itr++) {
+                uint64_t begin = __bench_now();
+                repo.get(*itr);
+                result.samples.push_back(__bench_now() - begin);
+            }
+        }
+        results.push_back(result);
+    }
+
+    results.push_back(__bench_measure("get_many", name, "", iterations, [&] () -> void {
+        repo.get_many(all_signs, [] (sign_t &, object &) -> void {});
+    }));
+
+    obj_type type;
+    sign_t head = revparse(repo).resolve("HEAD", type);
+    results.push_back(__bench_measure("walk", name, "", iterations, [&] () -> void {
+        revwalk walk(repo);
+        walk.push(head);
+        sign_t sign;
+        commit_body body;
+        while (walk.next(sign, body)) {}
+    }));
+
+    // first path of HEAD's tree, descending into directories
+    std::string path_limit;
+    sign_t tree_sign = revparse(repo).resolve("HEAD^{tree}", type);
+    while (type == obj_type::obj_type_tree) {
+        object obj = repo.get(tree_sign);
+        tree_items &items = obj.get<tree>().items();
+        if (items.empty()) {
+            break;
+        }
+        path_limit += (path_limit.empty() ? "" : "/") + items.front().name();
+        type = items.front().type();
+        tree_sign = items.front().sign();
+    }
+    results.push_back(__bench_measure("walk_path", name, path_limit, iterations, [&] () -> void {
+        revwalk walk(repo);
+        walk.path(path_limit);
+        walk.push(head);
+        sign_t sign;
+        commit_body body;
+        while (walk.next(sign, body)) {}
+    }));
+
+    results.push_back(__bench_measure("resolve", name, "HEAD:" + path_limit, iterations * 100, [&] () -> void {
+        revparse(repo).resolve("HEAD:" + path_limit, type);
+    }));
+}
+
+/**
+ * one JSON object per result: operations count, mean and percentiles in ns
+ */
+void __bench_report(std::ostream &out, std::vector<__bench_result_s> &results) {
+    out << "[\n";
+    for (auto itr = results.begin(); itr != results.end(); itr++) {
+        std::vector<uint64_t> &samples = itr->samples;
+        std::sort(samples.begin(), samples.end());
+        uint64_t total = 0;
+        for (auto sample = samples.begin(); sample != samples.end(); sample++) {
+            total += *sample;
+        }
+        size_t count = std::max(samples.size(), size_t(1));
+        out << "  {\"name\": \"" << itr->name << "\", \"repo\": \"" << itr->repo
+            << "\", \"kind\": \"" << itr->kind << "\", \"ops\": " << samples.size()
+            << ", \"mean_ns\": " << total / count
+            << ", \"p50_ns\": " << (samples.empty() ? 0 : samples[samples.size() / 2])
+            << ", \"p99_ns\": " << (samples.empty() ? 0 : samples[samples.size() * 99 / 100])
+            << ", \"max_ns\": " << (samples.empty() ? 0 : samples.back())
+            << "}" << (itr + 1 == results.end() ? "\n" : ",\n");
+    }
+    out << "]\n";
+}
+
+/**
+ * gitfsi-bench [--iterations <n>] [--output <path>] [--only <repo>]
+ *              [--trace <path> [--trace-slow <us>]] <work directory>
+ * generates the synthetic repositories into the work directory (kept for
+ * later runs), then prints results as a JSON array. With --trace, reads
+ * slower than --trace-slow are written as Chrome trace events (the library
+ * must be built with `make TRACE=1`)
+ */
+int main(int argc, char **argv) {
+    int iterations = 3;
+    std::string output_path;
+    std::string only;
+    std::string work_dir;
+    std::string trace_path;
+    uint64_t trace_slow_us = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace-slow") == 0 && i + 1 < argc) {
+            trace_slow_us = strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            work_dir = argv[i];
+        }
+    }
+
+    if (work_dir.empty()) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--iterations <n>] [--output <path>] [--only <repo>]"
+                  << " [--trace <path> [--trace-slow <us>]] <work directory>"
+                  << std::endl;
+        return 1;
+    }
+    mkdir(work_dir.c_str(), 0755);
+
+    if (!trace_path.empty()) {
+        trace::enable(1, trace_slow_us * 1000);
+    }
+
+    std::vector<__bench_result_s> results;
+    for (auto itr = __BENCH_REPOS.begin(); itr != __BENCH_REPOS.end(); itr++) {
+        if (!only.empty() && only != itr->name) {
+            continue;
+        }
+        std::string path = work_dir + "/" + itr->name + ".git";
+        if (!__bench_generate(*itr, path)) {
+            std::cerr << "can't generate " << path << std::endl;
+            return 1;
+        }
+        std::cerr << "measuring " << itr->name << std::endl;
+        __bench_repo(itr->name, path, iterations, results);
+    }
+
+    if (output_path.empty()) {
+        __bench_report(std::cout, results);
+    }
+    else {
+        std::ofstream output_file(output_path);
+        __bench_report(output_file, results);
+    }
+
+    if (!trace_path.empty()) {
+        trace::disable();
+        std::ofstream trace_file(trace_path);
+        trace_file << trace::chrome_json();
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "fsck.h"
+#include "repository.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * gitfsi-fsck [--threads <n>] [--no-connectivity] [--progress] <repository path>
+ * checks a repository's packs and objects, exits with 1 if anything is wrong
+ */
+const char *__issue_kind_name(gitter_kid::fsi::fsck_issue_kind kind) {
+    switch (kind) {
+    case gitter_kid::fsi::fsck_issue_checksum:
+        return "checksum";
+    case gitter_kid::fsi::fsck_issue_corrupt:
+        return "corrupt";
+    case gitter_kid::fsi::fsck_issue_malformed:
+        return "malformed";
+    default:
+        return "missing";
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string repo_path;
+    unsigned threads = 0;
+    bool connectivity = true;
+    bool progress = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = unsigned(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--no-connectivity") == 0) {
+            connectivity = false;
+        }
+        else if (strcmp(argv[i], "--progress") == 0) {
+            progress = true;
+        }
+        else {
+            repo_path = argv[i];
+        }
+    }
+
+    if (repo_path.empty()) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--threads <n>] [--no-connectivity] [--progress] <repository path>" << std::endl;
+        return 1;
+    }
+
+    gitter_kid::fsi::repository repo(repo_path);
+    repo.initialize_packs();
+
+    gitter_kid::fsi::fsck checker(repo);
+    checker.threads() = threads;
+    checker.connectivity() = connectivity;
+    if (progress) {
+        checker.progress() = [] (const gitter_kid::fsi::fsck_progress &state) -> void {
+            std::cerr << "\r" << state.stage << ": " << state.done << "/" << state.total
+                      << std::fixed << std::setprecision(1)
+                      << " (" << state.bytes / (1024.0 * 1024.0) / std::max(state.seconds, 1e-6)
+                      << " MiB/s)" << std::flush;
+            if (state.done == state.total) {
+                std::cerr << std::endl;
+            }
+        };
+    }
+
+    gitter_kid::fsi::fsck_report report = checker.check();
+    for (auto itr = report.issues.begin(); itr != report.issues.end(); itr++) {
+        std::cout << "error: " << __issue_kind_name(itr->kind);
+        if (!itr->sign.bytes().empty()) {
+            std::cout << " " << itr->sign.str();
+        }
+        std::cout << ": " << itr->detail << std::endl;
+    }
+
+    double seconds = std::max(report.seconds, 1e-6);
+    std::cerr << std::fixed << std::setprecision(2)
+              << report.objects << " objects (" << report.loose << " loose) in "
+              << report.packs << " packs checked in " << report.seconds << "s, "
+              << report.objects / seconds << " objects/s, "
+              << report.bytes / (1024.0 * 1024.0) / seconds << " MiB/s" << std::endl;
+    if (connectivity) {
+        std::cerr << report.reachable << " reachable, " << report.unreachable << " unreachable" << std::endl;
+    }
+    if (!report.hashes_checked) {
+        std::cerr << "checksums and ids not checked (SHA-256 repository)" << std::endl;
+    }
+    return report.issues.empty() ? 0 : 1;
+}
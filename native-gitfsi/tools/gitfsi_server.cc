@@ -0,0 +1,52 @@
+#include "server.h"
+#include <iostream>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * gitfsi-server [--socket <path>] [<name>=]<repository path>...
+ * serves stdin/stdout unless a unix socket is given, a repository's name
+ * defaults to its path
+ */
+int main(int argc, char **argv) {
+    gitter_kid::fsi::server srv;
+    std::string socket_path;
+    int repositories = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+            continue;
+        }
+
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            srv.add(arg, arg);
+        }
+        else {
+            srv.add(arg.substr(0, eq), arg.substr(eq + 1));
+        }
+        repositories++;
+    }
+
+    if (repositories == 0) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--socket <path>] [<name>=]<repository path>..." << std::endl;
+        return 1;
+    }
+
+    // a client going away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    if (socket_path.empty()) {
+        srv.serve(STDIN_FILENO, STDOUT_FILENO);
+        return 0;
+    }
+    if (srv.listen(socket_path) == -1) {
+        std::cerr << "can't listen on " << socket_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "stats.h"
+#include "repository.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * gitfsi-stats [--threads <n>] <repository path>
+ * prints a repository's object counts and sizes, largest objects, delta
+ * chains, widest tree, deepest path and history length
+ */
+void __print_type(const char *name, const gitter_kid::fsi::stats_type &counters) {
+    std::cout << std::left << std::setw(8) << name << std::right
+              << std::setw(12) << counters.count
+              << std::setw(16) << counters.size
+              << std::setw(16) << counters.disk_size << std::endl;
+}
+
+void __print_largest(const char *name, std::vector<gitter_kid::fsi::stats_object> &largest) {
+    std::cout << "largest " << name << ":" << std::endl;
+    for (auto itr = largest.begin(); itr != largest.end(); itr++) {
+        std::cout << "  " << itr->sign.str() << std::setw(14) << itr->size << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string repo_path;
+    unsigned threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = unsigned(atoi(argv[++i]));
+        }
+        else {
+            repo_path = argv[i];
+        }
+    }
+
+    if (repo_path.empty()) {
+        std::cerr << "usage: " << argv[0] << " [--threads <n>] <repository path>" << std::endl;
+        return 1;
+    }
+
+    gitter_kid::fsi::repository repo(repo_path);
+    repo.initialize_packs();
+
+    gitter_kid::fsi::stats collector(repo);
+    collector.threads() = threads;
+    gitter_kid::fsi::stats_report report = collector.collect();
+
+    std::cout << std::left << std::setw(8) << "type" << std::right
+              << std::setw(12) << "count"
+              << std::setw(16) << "size"
+              << std::setw(16) << "disk size" << std::endl;
+    __print_type("commit", report.commits);
+    __print_type("tree", report.trees);
+    __print_type("blob", report.blobs);
+    __print_type("tag", report.tags);
+
+    __print_largest("blobs", report.largest_blobs);
+    __print_largest("trees", report.largest_trees);
+
+    std::cout << "delta chain lengths:" << std::endl;
+    for (size_t depth = 0; depth < report.delta_depths.size(); depth++) {
+        if (report.delta_depths[depth] != 0) {
+            std::cout << "  " << std::setw(4) << depth << std::setw(12) << report.delta_depths[depth] << std::endl;
+        }
+    }
+
+    if (report.widest_tree.size != 0) {
+        std::cout << "widest tree: " << report.widest_tree.sign.str()
+                  << " (" << report.widest_tree.size << " entries)" << std::endl;
+    }
+    std::cout << "deepest path: " << report.max_path_depth;
+    if (!report.deepest_path.empty()) {
+        std::cout << " (" << report.deepest_path << ")";
+    }
+    std::cout << std::endl;
+    std::cout << "history length: " << report.history_length;
+    if (report.history_length != 0) {
+        std::cout << " (" << report.history_tip.str() << ")";
+    }
+    std::cout << std::endl;
+
+    std::cerr << std::fixed << std::setprecision(2) << "collected in " << report.seconds << "s" << std::endl;
+    return 0;
+}